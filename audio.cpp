@@ -0,0 +1,156 @@
+#include "audio.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr unsigned int FRAMES_PER_SECOND = 60;
+constexpr unsigned int PATTERN_BITS = AUDIO_PATTERN_SIZE * 8;
+
+void PutU16(std::FILE* file, uint16_t value) {
+    const uint8_t bytes[2] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8)};
+    std::fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+void PutU32(std::FILE* file, uint32_t value) {
+    PutU16(file, value & 0xFFFF);
+    PutU16(file, value >> 16);
+}
+
+}
+
+AudioSynth::AudioSynth(unsigned int sample_rate, double tone_hz, int16_t amplitude)
+    : sample_rate(std::min(sample_rate, AUDIO_MAX_SAMPLE_RATE)),
+      tone_hz(tone_hz), amplitude(amplitude) {}
+
+void AudioSynth::RenderFrame(const Chip8::AudioState& state, AudioBlock& block) {
+    // sample_rate / 60 rarely divides evenly; carry the remainder so the
+    // long-run rate is exact
+    sample_remainder += sample_rate;
+    const uint32_t count = sample_remainder / FRAMES_PER_SECOND;
+    sample_remainder %= FRAMES_PER_SECOND;
+    block.count = count;
+
+    if (!state.active) {
+        std::fill_n(block.samples, count, int16_t{0});
+        return;
+    }
+
+    if (!state.pattern_loaded) {
+        // high for the first half of each cycle
+        const double step = tone_hz / sample_rate;
+        for (uint32_t i = 0; i < count; ++i) {
+            block.samples[i] = tone_phase < 0.5 ? amplitude : static_cast<int16_t>(-amplitude);
+            tone_phase += step;
+            tone_phase -= std::floor(tone_phase);
+        }
+        return;
+    }
+
+    const double rate = 4000.0 * std::exp2((state.pitch - 64) / 48.0);
+    const double step = rate / sample_rate;
+    for (uint32_t i = 0; i < count; ++i) {
+        const unsigned int bit = static_cast<unsigned int>(pattern_phase);
+        const bool high = state.pattern[bit / 8] & (0x80u >> (bit % 8));
+        block.samples[i] = high ? amplitude : static_cast<int16_t>(-amplitude);
+        pattern_phase = std::fmod(pattern_phase + step, PATTERN_BITS);
+    }
+}
+
+WavAudioSink::WavAudioSink(const char* path, unsigned int sample_rate)
+    : sample_rate(std::min(sample_rate, AUDIO_MAX_SAMPLE_RATE)) {
+    file = std::fopen(path, "wb");
+    if (file) {
+        WriteHeader();
+    }
+}
+
+WavAudioSink::~WavAudioSink() {
+    if (!file) {
+        return;
+    }
+    std::fseek(file, 0, SEEK_SET);
+    WriteHeader();
+    std::fclose(file);
+}
+
+void WavAudioSink::Write(const int16_t* samples, std::size_t count) {
+    if (!file) {
+        return;
+    }
+    uint8_t bytes[AUDIO_MAX_BLOCK * 2];
+    while (count > 0) {
+        const std::size_t chunk = std::min(count, AUDIO_MAX_BLOCK);
+        for (std::size_t i = 0; i < chunk; ++i) {
+            bytes[i * 2] = static_cast<uint16_t>(samples[i]) & 0xFF;
+            bytes[i * 2 + 1] = static_cast<uint16_t>(samples[i]) >> 8;
+        }
+        std::fwrite(bytes, 1, chunk * 2, file);
+        data_bytes += chunk * 2;
+        samples += chunk;
+        count -= chunk;
+    }
+}
+
+void WavAudioSink::WriteHeader() {
+    const auto data_size = static_cast<uint32_t>(std::min<uint64_t>(data_bytes, UINT32_MAX - 36));
+
+    std::fwrite("RIFF", 1, 4, file);
+    PutU32(file, 36 + data_size);
+    std::fwrite("WAVEfmt ", 1, 8, file);
+    PutU32(file, 16);
+    PutU16(file, 1);                // PCM
+    PutU16(file, 1);                // mono
+    PutU32(file, sample_rate);
+    PutU32(file, sample_rate * 2);  // byte rate
+    PutU16(file, 2);                // block align
+    PutU16(file, 16);               // bits per sample
+    std::fwrite("data", 1, 4, file);
+    PutU32(file, data_size);
+}
+
+AudioPipeline::AudioPipeline(unsigned int sample_rate, std::unique_ptr<AudioSink> sink, bool lossless)
+    : synth(sample_rate), sink(std::move(sink)), lossless(lossless), thread(&AudioPipeline::ConsumeLoop, this) {}
+
+AudioPipeline::~AudioPipeline() {
+    running.store(false, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_one();
+    thread.join();
+}
+
+void AudioPipeline::Frame(const Chip8::AudioState& state) {
+    synth.RenderFrame(state, block);
+
+    while (!ring.Push(block)) {
+        if (!lossless) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_one();
+}
+
+void AudioPipeline::ConsumeLoop() {
+    uint32_t seen = 0;
+
+    for (;;) {
+        const bool draining = !running.load(std::memory_order_relaxed);
+
+        for (const AudioBlock* front = ring.Front(); front; front = ring.Front()) {
+            sink->Write(front->samples, front->count);
+            ring.Pop();
+        }
+
+        if (draining) {
+            break;
+        }
+
+        generation.wait(seen, std::memory_order_acquire);
+        seen = generation.load(std::memory_order_acquire);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef CHIP_8_AUDIO_H
+#define CHIP_8_AUDIO_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include "chip8.h"
+#include "spsc_ring.h"
+
+// Largest block one frame can produce: 60 fps at up to 192 kHz.
+constexpr std::size_t AUDIO_MAX_BLOCK = 3200;
+constexpr unsigned int AUDIO_MAX_SAMPLE_RATE = AUDIO_MAX_BLOCK * 60;
+
+struct AudioBlock {
+    uint32_t count;
+    int16_t samples[AUDIO_MAX_BLOCK];
+};
+
+// Turns the per-frame sound state into mono 16-bit PCM. Without an XO-CHIP
+// pattern the buzzer is a square wave at `tone_hz`; once F002 has loaded a
+// pattern its 128 bits are played at 4000 * 2^((pitch - 64) / 48) bits/s.
+// Each mode keeps its own phase across frames, so blocks join without clicks
+// and switching modes picks a waveform up where it left off.
+class AudioSynth {
+public:
+    explicit AudioSynth(unsigned int sample_rate, double tone_hz = 440.0, int16_t amplitude = 8000);
+
+    // Writes one 60 Hz frame worth of samples to `block`.
+    void RenderFrame(const Chip8::AudioState& state, AudioBlock& block);
+
+    unsigned int SampleRate() const { return sample_rate; }
+
+private:
+    unsigned int sample_rate;
+    double tone_hz;
+    int16_t amplitude;
+    double tone_phase{};    // in cycles
+    double pattern_phase{}; // in pattern bits
+    uint64_t sample_remainder{};
+};
+
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+    virtual void Write(const int16_t* samples, std::size_t count) = 0;
+};
+
+class NullAudioSink : public AudioSink {
+public:
+    void Write(const int16_t*, std::size_t) override {}
+};
+
+// Mono 16-bit PCM WAV; sizes are patched into the header on destruction.
+// The rate is clamped like AudioSynth's, so the header matches the samples.
+class WavAudioSink : public AudioSink {
+public:
+    WavAudioSink(const char* path, unsigned int sample_rate);
+    ~WavAudioSink() override;
+
+    bool IsOpen() const { return file != nullptr; }
+    void Write(const int16_t* samples, std::size_t count) override;
+
+private:
+    void WriteHeader();
+
+    std::FILE* file{};
+    unsigned int sample_rate;
+    uint64_t data_bytes{};
+};
+
+// Synthesises one block per frame on the emulation thread and hands it to a
+// consumer thread through an SPSC ring of blocks. In real-time use a full ring
+// drops the block (counted in Dropped()) so audio never stalls emulation.
+// Headless runs that outpace the sink can ask for `lossless`, which waits for
+// space instead, like Recorder does.
+class AudioPipeline {
+public:
+    AudioPipeline(unsigned int sample_rate, std::unique_ptr<AudioSink> sink, bool lossless = false);
+    ~AudioPipeline();
+
+    AudioPipeline(const AudioPipeline&) = delete;
+    AudioPipeline& operator=(const AudioPipeline&) = delete;
+
+    // Emulation thread, once per frame.
+    void Frame(const Chip8::AudioState& state);
+
+    // safe to read from any thread
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t RING_SIZE = 16;
+
+    void ConsumeLoop();
+
+    AudioSynth synth;
+    AudioBlock block{};
+    SpscRing<AudioBlock, RING_SIZE> ring;
+    std::unique_ptr<AudioSink> sink;
+    std::atomic<uint32_t> generation{0};
+    std::atomic<bool> running{true};
+    bool lossless;
+    std::atomic<uint64_t> dropped{0};
+    std::thread thread;
+};
+
+#endif //CHIP_8_AUDIO_H
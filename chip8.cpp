@@ -0,0 +1,534 @@
+#include "chip8.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+constexpr unsigned int FONTSET_SIZE = 80;
+
+constexpr uint8_t fontset[FONTSET_SIZE] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+}
+
+Chip8::Chip8() {
+    std::memcpy(memory + FONTSET_START_ADDRESS, fontset, FONTSET_SIZE);
+}
+
+Chip8::Chip8(uint64_t job_seed, uint64_t instance_id) : Chip8() {
+    rng.key = CounterRng::key_for(job_seed, instance_id);
+}
+
+void Chip8::Restore(const Chip8& snapshot) {
+    // copy around observe_lock so the live sequence is never rewound
+    constexpr std::size_t lock_begin = offsetof(Chip8, observe_lock);
+    constexpr std::size_t lock_end = lock_begin + sizeof(SeqLock);
+
+    observe_lock.BeginWrite();
+    std::memcpy(reinterpret_cast<char*>(this), reinterpret_cast<const char*>(&snapshot), lock_begin);
+    std::memcpy(reinterpret_cast<char*>(this) + lock_end, reinterpret_cast<const char*>(&snapshot) + lock_end,
+                sizeof(Chip8) - lock_end);
+    observe_lock.EndWrite();
+}
+
+void Chip8::Reseed(uint64_t job_seed, uint64_t instance_id) {
+    rng.key = CounterRng::key_for(job_seed, instance_id);
+    rng.counter = 0;
+}
+
+bool Chip8::LoadROM(const char* filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    LoadROM(buffer.data(), buffer.size());
+    return true;
+}
+
+void Chip8::LoadROM(const uint8_t* data, std::size_t size) {
+    size = std::min<std::size_t>(size, sizeof(memory) - START_ADDRESS);
+    std::memcpy(memory + START_ADDRESS, data, size);
+}
+
+void Chip8::Cycle() {
+    opcode = (memory[program_counter & 0xFFFu] << 8u) | memory[(program_counter + 1u) & 0xFFFu];
+    program_counter += 2;
+
+    switch (opcode >> 12u) {
+        case 0x0:
+            switch (opcode) {
+                case 0x00E0: OP_00e0(); break;
+                case 0x00EE: OP_00ee(); break;
+                default: OP_0nnn(); break;
+            }
+            break;
+        case 0x1: OP_1nnn(); break;
+        case 0x2: OP_2nnn(); break;
+        case 0x3: OP_3xnn(); break;
+        case 0x4: OP_4xnn(); break;
+        case 0x5:
+            switch (opcode & 0x000Fu) {
+                case 0x0: OP_5xy0(); break;
+                case 0x2: OP_5xy2(); break;
+                case 0x3: OP_5xy3(); break;
+                default: OP_invalid(); break;
+            }
+            break;
+        case 0x6: OP_6xnn(); break;
+        case 0x7: OP_7xnn(); break;
+        case 0x8:
+            switch (opcode & 0x000Fu) {
+                case 0x0: OP_8xy0(); break;
+                case 0x1: OP_8xy1(); break;
+                case 0x2: OP_8xy2(); break;
+                case 0x3: OP_8xy3(); break;
+                case 0x4: OP_8xy4(); break;
+                case 0x5: OP_8xy5(); break;
+                case 0x6: OP_8xy6(); break;
+                case 0x7: OP_8xy7(); break;
+                case 0xE: OP_8xye(); break;
+                default: OP_invalid(); break;
+            }
+            break;
+        case 0x9:
+            if (opcode & 0x000Fu) {
+                OP_invalid();
+            } else {
+                OP_9xy0();
+            }
+            break;
+        case 0xA: OP_annn(); break;
+        case 0xB: OP_bnnn(); break;
+        case 0xC: OP_cxnn(); break;
+        case 0xD: OP_dxyn(); break;
+        case 0xE:
+            switch (opcode & 0x00FFu) {
+                case 0x9E: OP_ex9e(); break;
+                case 0xA1: OP_exa1(); break;
+                default: OP_invalid(); break;
+            }
+            break;
+        case 0xF:
+            switch (opcode & 0x00FFu) {
+                case 0x02:
+                    if (opcode == 0xF002) {
+                        OP_f002();
+                    } else {
+                        OP_invalid();
+                    }
+                    break;
+                case 0x07: OP_fx07(); break;
+                case 0x0A: OP_fx0a(); break;
+                case 0x15: OP_fx15(); break;
+                case 0x18: OP_fx18(); break;
+                case 0x1E: OP_fx1e(); break;
+                case 0x29: OP_fx29(); break;
+                case 0x33: OP_fx33(); break;
+                case 0x3A: OP_fx3a(); break;
+                case 0x55: OP_fx55(); break;
+                case 0x65: OP_fx65(); break;
+                default: OP_invalid(); break;
+            }
+            break;
+    }
+}
+
+void Chip8::RunFrame(unsigned int instructions) {
+    unsigned int executed = 0;
+    RunFrame(instructions, executed, [](const Chip8&) { return HookAction::Run; });
+}
+
+void Chip8::TickTimers() {
+    delayTimer = delayTimer > 0 ? delayTimer - 1 : 0;
+    soundTimer = soundTimer > 0 ? soundTimer - 1 : 0;
+}
+
+void Chip8::AdvanceTimers(uint64_t frames) {
+    observe_lock.BeginWrite();
+    delayTimer = static_cast<uint8_t>(delayTimer > frames ? delayTimer - frames : 0);
+    soundTimer = static_cast<uint8_t>(soundTimer > frames ? soundTimer - frames : 0);
+    observe_lock.EndWrite();
+}
+
+Chip8::AudioState Chip8::Audio() const {
+    AudioState state{soundTimer > 0, pattern_loaded, pitch, {}};
+    std::memcpy(state.pattern, audio_pattern, sizeof(audio_pattern));
+    return state;
+}
+
+void Chip8::SetKey(uint8_t key, bool pressed) {
+    key &= 0xFu;
+    keypad[key] = pressed;
+
+    if (pressed && WaitingForKey()) {
+        observe_lock.BeginWrite();
+        registers[key_wait] = key;
+        key_wait = NO_KEY_WAIT;
+        observe_lock.EndWrite();
+    }
+}
+
+void Chip8::CopyArchState(ArchState& state) const {
+    std::memcpy(state.registers, registers, sizeof(registers));
+    std::memcpy(state.stack, stack, sizeof(stack));
+    state.index = index;
+    state.program_counter = program_counter;
+    state.sp = sp;
+    state.delay_timer = delayTimer;
+    state.sound_timer = soundTimer;
+}
+
+void Chip8::OP_0nnn() {
+    // machine code routines are not supported
+    OP_invalid();
+}
+
+void Chip8::OP_invalid() {
+    faults |= FAULT_INVALID_OPCODE;
+}
+
+void Chip8::CheckIndexRange(unsigned int length) {
+    if (index + length > sizeof(memory)) {
+        faults |= FAULT_INDEX_RANGE;
+    }
+}
+
+void Chip8::OP_00e0() {
+    std::memset(video, 0, sizeof(video));
+}
+
+void Chip8::OP_dxyn() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+    const uint8_t height = opcode & 0x000Fu;
+    CheckIndexRange(height);
+
+    const uint8_t x_pos = registers[x] % VIDEO_WIDTH;
+    const uint8_t y_pos = registers[y] % VIDEO_HEIGHT;
+
+    registers[0xF] = 0;
+
+    for (unsigned int row = 0; row < height; ++row) {
+        const uint8_t sprite_byte = memory[(index + row) & 0xFFFu];
+
+        for (unsigned int col = 0; col < 8; ++col) {
+            if (!(sprite_byte & (0x80u >> col))) {
+                continue;
+            }
+
+            uint32_t* screen_pixel = &video[((y_pos + row) % VIDEO_HEIGHT) * VIDEO_WIDTH + (x_pos + col) % VIDEO_WIDTH];
+            if (*screen_pixel == 0xFFFFFFFF) {
+                registers[0xF] = 1;
+            }
+            *screen_pixel ^= 0xFFFFFFFF;
+        }
+    }
+}
+
+void Chip8::OP_00ee() {
+    if (sp == 0) {
+        // nothing to return to; carry on after the RET
+        faults |= FAULT_STACK_UNDERFLOW;
+        return;
+    }
+    --sp;
+    program_counter = stack[sp & 0xFu];
+}
+
+void Chip8::OP_1nnn() {
+    program_counter = opcode & 0x0FFFu;
+}
+
+void Chip8::OP_2nnn() {
+    if (sp >= 16) {
+        faults |= FAULT_STACK_OVERFLOW;
+    }
+    stack[sp & 0xFu] = program_counter;
+    ++sp;
+    program_counter = opcode & 0x0FFFu;
+}
+
+void Chip8::OP_bnnn() {
+    program_counter = registers[0] + (opcode & 0x0FFFu);
+}
+
+void Chip8::OP_3xnn() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t nn = opcode & 0x00FFu;
+
+    if (registers[x] == nn) {
+        program_counter += 2;
+    }
+}
+
+void Chip8::OP_4xnn() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t nn = opcode & 0x00FFu;
+
+    if (registers[x] != nn) {
+        program_counter += 2;
+    }
+}
+
+void Chip8::OP_5xy0() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    if (registers[x] == registers[y]) {
+        program_counter += 2;
+    }
+}
+
+void Chip8::OP_9xy0() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    if (registers[x] != registers[y]) {
+        program_counter += 2;
+    }
+}
+
+void Chip8::OP_6xnn() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    registers[x] = opcode & 0x00FFu;
+}
+
+void Chip8::OP_7xnn() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    registers[x] += opcode & 0x00FFu;
+}
+
+void Chip8::OP_8xy0() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    registers[x] = registers[y];
+}
+
+void Chip8::OP_8xy1() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    registers[x] |= registers[y];
+}
+
+void Chip8::OP_8xy2() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    registers[x] &= registers[y];
+}
+
+void Chip8::OP_8xy3() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    registers[x] ^= registers[y];
+}
+
+void Chip8::OP_8xy6() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    const uint8_t flag = registers[x] & 0x1u;
+    registers[x] >>= 1;
+    registers[0xF] = flag;
+}
+
+void Chip8::OP_8xye() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    const uint8_t flag = (registers[x] & 0x80u) >> 7u;
+    registers[x] <<= 1;
+    registers[0xF] = flag;
+}
+
+void Chip8::OP_8xy4() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    const uint16_t sum = registers[x] + registers[y];
+    registers[x] = sum & 0xFFu;
+    registers[0xF] = sum > 0xFFu;
+}
+
+void Chip8::OP_8xy5() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    const uint8_t flag = registers[x] >= registers[y];
+    registers[x] -= registers[y];
+    registers[0xF] = flag;
+}
+
+void Chip8::OP_8xy7() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+
+    const uint8_t flag = registers[y] >= registers[x];
+    registers[x] = registers[y] - registers[x];
+    registers[0xF] = flag;
+}
+
+void Chip8::OP_annn() {
+    index = opcode & 0x0FFFu;
+}
+
+void Chip8::OP_fx1e() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    index += registers[x];
+}
+
+void Chip8::OP_fx29() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    index = FONTSET_START_ADDRESS + 5 * (registers[x] & 0xFu);
+}
+
+void Chip8::OP_fx55() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    CheckIndexRange(x + 1u);
+
+    for (uint8_t i = 0; i <= x; ++i) {
+        memory[(index + i) & 0xFFFu] = registers[i];
+    }
+}
+
+void Chip8::OP_fx65() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    CheckIndexRange(x + 1u);
+
+    for (uint8_t i = 0; i <= x; ++i) {
+        registers[i] = memory[(index + i) & 0xFFFu];
+    }
+}
+
+// Vx..Vy to and from memory at I, counting down when x > y; I is unchanged
+void Chip8::OP_5xy2() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+    const uint8_t count = (x <= y ? y - x : x - y) + 1u;
+    CheckIndexRange(count);
+
+    for (uint8_t i = 0; i < count; ++i) {
+        memory[(index + i) & 0xFFFu] = registers[x <= y ? x + i : x - i];
+    }
+}
+
+void Chip8::OP_5xy3() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t y = (opcode & 0x00F0u) >> 4u;
+    const uint8_t count = (x <= y ? y - x : x - y) + 1u;
+    CheckIndexRange(count);
+
+    for (uint8_t i = 0; i < count; ++i) {
+        registers[x <= y ? x + i : x - i] = memory[(index + i) & 0xFFFu];
+    }
+}
+
+void Chip8::OP_cxnn() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    const uint8_t nn = opcode & 0x00FFu;
+
+    registers[x] = rng.next_byte() & nn;
+}
+
+void Chip8::OP_ex9e() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    if (keypad[registers[x] & 0xFu]) {
+        program_counter += 2;
+    }
+}
+
+void Chip8::OP_exa1() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    if (!keypad[registers[x] & 0xFu]) {
+        program_counter += 2;
+    }
+}
+
+void Chip8::OP_fx0a() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    for (uint8_t key = 0; key < 16; ++key) {
+        if (keypad[key]) {
+            registers[x] = key;
+            return;
+        }
+    }
+
+    // No key is down: rather than re-executing this instruction every cycle,
+    // register the wait and let the scheduler park the instance until SetKey.
+    key_wait = x;
+}
+
+void Chip8::OP_fx07() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    registers[x] = delayTimer;
+}
+
+void Chip8::OP_fx15() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    delayTimer = registers[x];
+}
+
+void Chip8::OP_fx18() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    soundTimer = registers[x];
+}
+
+void Chip8::OP_f002() {
+    CheckIndexRange(AUDIO_PATTERN_SIZE);
+    for (unsigned int i = 0; i < AUDIO_PATTERN_SIZE; ++i) {
+        audio_pattern[i] = memory[(index + i) & 0xFFFu];
+    }
+    pattern_loaded = true;
+}
+
+void Chip8::OP_fx3a() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+
+    pitch = registers[x];
+}
+
+void Chip8::OP_fx33() {
+    const uint8_t x = (opcode & 0x0F00u) >> 8u;
+    CheckIndexRange(3);
+    uint8_t value = registers[x];
+
+    memory[(index + 2) & 0xFFFu] = value % 10;
+    value /= 10;
+    memory[(index + 1) & 0xFFFu] = value % 10;
+    value /= 10;
+    memory[index & 0xFFFu] = value % 10;
+}
@@ -0,0 +1,315 @@
+#ifndef CHIP_8_CHIP8_H
+#define CHIP_8_CHIP8_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "seqlock.h"
+
+constexpr unsigned int START_ADDRESS = 0x200;
+constexpr unsigned int FONTSET_START_ADDRESS = 0x50;
+constexpr unsigned int VIDEO_WIDTH = 64;
+constexpr unsigned int VIDEO_HEIGHT = 32;
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+constexpr unsigned int AUDIO_PATTERN_SIZE = 16;
+constexpr std::size_t VIDEO_PACKED_SIZE = VIDEO_WIDTH * VIDEO_HEIGHT / 8;
+
+// Counter-based generator: every draw is the SplitMix64 finalizer applied to
+// (key, counter), so a stream depends only on its seed and on how many values
+// it has produced, never on the thread or batch that produced them.
+struct CounterRng {
+    uint64_t key{};
+    uint64_t counter{};
+
+    static constexpr uint64_t GOLDEN_GAMMA = 0x9e3779b97f4a7c15ULL;
+
+    static constexpr uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    static constexpr uint64_t key_for(uint64_t job_seed, uint64_t instance_id) {
+        return mix(job_seed ^ mix(instance_id + GOLDEN_GAMMA));
+    }
+
+    static constexpr uint8_t byte_at(uint64_t key, uint64_t counter) {
+        return static_cast<uint8_t>(mix(key + counter * GOLDEN_GAMMA) >> 56);
+    }
+
+    uint8_t next_byte() { return byte_at(key, counter++); }
+};
+
+// Batched form for multi-instance engines, laid out as structure-of-arrays.
+// Lanes are independent so the loop vectorises, and lane i yields exactly what
+// its scalar stream would.
+inline void counter_rng_bytes(const uint64_t* keys, uint64_t* counters, uint8_t* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = CounterRng::byte_at(keys[i], counters[i]++);
+    }
+}
+
+// One bit per pixel, most significant bit first, row-major: the form frames
+// take in recordings and in packed observation tensors.
+inline void pack_video_bits(const uint32_t* video, uint8_t* out) {
+    for (std::size_t byte = 0; byte < VIDEO_PACKED_SIZE; ++byte) {
+        uint8_t bits = 0;
+        for (unsigned int bit = 0; bit < 8; ++bit) {
+            bits |= (video[byte * 8 + bit] != 0) << (7 - bit);
+        }
+        out[byte] = bits;
+    }
+}
+
+// Aligned to a cache line so that sizeof(Chip8) is padded to a whole number of
+// lines: instances packed in a std::vector never share a line between workers.
+struct alignas(CACHE_LINE_SIZE) Chip8 {
+
+private:
+    // hot: touched by nearly every instruction, kept together in one line
+    alignas(CACHE_LINE_SIZE) uint8_t registers[16]{};
+    uint16_t stack[16]{};
+    uint16_t index{};
+    uint16_t program_counter{START_ADDRESS};
+    uint16_t opcode{};
+    uint8_t sp{};
+    uint8_t delayTimer{};
+    uint8_t soundTimer{};
+    uint8_t key_wait{NO_KEY_WAIT};
+
+    // bumped around every frame and every between-frame update, for observers
+    SeqLock observe_lock;
+
+    // updated between frames from the input queue, kept off the hot line
+    alignas(CACHE_LINE_SIZE) uint8_t keypad[16]{};
+
+    // warm: touched by a few instructions only
+    alignas(CACHE_LINE_SIZE) CounterRng rng{};
+    uint8_t audio_pattern[AUDIO_PATTERN_SIZE]{};
+    uint8_t pitch{64};
+    bool pattern_loaded{};
+    uint8_t faults{};
+
+    // cold: large arrays, each starting on its own line
+    alignas(CACHE_LINE_SIZE) uint8_t memory[4096]{};
+    alignas(CACHE_LINE_SIZE) uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT]{};
+
+    static_assert(sizeof(registers) + sizeof(stack) + sizeof(index) + sizeof(program_counter) +
+                  sizeof(opcode) + sizeof(sp) + sizeof(delayTimer) + sizeof(soundTimer) +
+                  sizeof(key_wait) + sizeof(observe_lock) <= CACHE_LINE_SIZE,
+                  "hot state must fit in a single cache line");
+
+public:
+    // key_wait holds the Fx0A target register while the instance is suspended
+    static constexpr uint8_t NO_KEY_WAIT = 0xFF;
+
+    // Sticky fault flags; they report that a ROM misbehaved without stopping
+    // it. An invalid opcode and a RET on an empty stack do nothing but move on
+    // to the next instruction. A CALL on a full stack still pushes, wrapping
+    // onto the oldest entry, and an I-relative access past the end of memory
+    // wraps back to address 0.
+    static constexpr uint8_t FAULT_INVALID_OPCODE = 0x1;
+    static constexpr uint8_t FAULT_STACK_OVERFLOW = 0x2;
+    static constexpr uint8_t FAULT_STACK_UNDERFLOW = 0x4;
+    static constexpr uint8_t FAULT_INDEX_RANGE = 0x8;
+
+    Chip8();
+    Chip8(uint64_t job_seed, uint64_t instance_id);
+
+    // Replaces this instance's state with a snapshot taken by copying a
+    // Chip8, as one observable update.
+    void Restore(const Chip8& snapshot);
+
+    // Restarts the CXNN stream as if constructed with these ids; used to give
+    // each episode restored from a shared snapshot its own randomness.
+    void Reseed(uint64_t job_seed, uint64_t instance_id);
+
+    bool LoadROM(const char* filename);
+    void LoadROM(const uint8_t* data, std::size_t size);
+
+    void Cycle();
+
+    // Executes up to `instructions` instructions, stopping early if Fx0A
+    // suspends the instance, then ticks the 60 Hz timers once.
+    void RunFrame(unsigned int instructions);
+
+    // What a RunFrame hook wants done with the instruction at the pc.
+    enum class HookAction : uint8_t { Run, RunThenStop, Stop };
+
+    // The same frame with hook(*this) asked before every instruction, for
+    // tools that watch execution (Debugger, LatencyProbe); being a template,
+    // the plain RunFrame above compiles to the bare loop. `executed` counts
+    // the frame's instructions so far. A hook that stops leaves the frame
+    // unfinished, timers unticked, and the next call resumes it. Returns true
+    // once the frame is done, with `executed` back at 0.
+    template <typename Hook>
+    bool RunFrame(unsigned int instructions, unsigned int& executed, Hook&& hook) {
+        observe_lock.BeginWrite();
+        bool done = true;
+        while (executed < instructions && !WaitingForKey()) {
+            const HookAction action = hook(static_cast<const Chip8&>(*this));
+            if (action == HookAction::Stop) {
+                done = false;
+                break;
+            }
+            Cycle();
+            ++executed;
+            if (action == HookAction::RunThenStop) {
+                done = false;
+                break;
+            }
+        }
+        if (done) {
+            TickTimers();
+            executed = 0;
+        }
+        observe_lock.EndWrite();
+        return done;
+    }
+
+    // Ticks the 60 Hz timers `frames` times in one step; used to catch up an
+    // instance that was parked while waiting for a key.
+    void AdvanceTimers(uint64_t frames);
+
+    // Sound state the audio pipeline samples once per frame.
+    struct AudioState {
+        bool active;
+        bool pattern_loaded;
+        uint8_t pitch;
+        uint8_t pattern[AUDIO_PATTERN_SIZE];
+    };
+
+    AudioState Audio() const;
+
+    // Architectural state as seen by an observer thread.
+    struct ArchState {
+        uint8_t registers[16];
+        uint16_t stack[16];
+        uint16_t index;
+        uint16_t program_counter;
+        uint8_t sp;
+        uint8_t delay_timer;
+        uint8_t sound_timer;
+    };
+
+    // Safe to call from any thread while the emulation thread runs. Copies the
+    // state as of the last frame boundary, retrying if a frame was in flight,
+    // and passes the copy to fn. The emulation thread takes no lock for this.
+    template <typename Fn>
+    void ReadConsistent(Fn&& fn) const {
+        ArchState state;
+        observe_lock.Read([&] { CopyArchState(state); });
+        fn(static_cast<const ArchState&>(state));
+    }
+
+    // Updates the keypad; a press completes a pending Fx0A wait. Only the
+    // emulation thread calls this, between frames (see DrainKeys).
+    void SetKey(uint8_t key, bool pressed);
+
+    bool WaitingForKey() const { return key_wait != NO_KEY_WAIT; }
+
+    uint8_t Faults() const { return faults; }
+    void ClearFaults() { faults = 0; }
+
+    const uint32_t* Video() const { return video; }
+    const uint8_t* Registers() const { return registers; }
+    uint16_t ProgramCounter() const { return program_counter; }
+    uint16_t Index() const { return index; }
+    uint8_t DelayTimer() const { return delayTimer; }
+    uint8_t SoundTimer() const { return soundTimer; }
+
+    const uint8_t* Memory() const { return memory; }
+    const uint16_t* Stack() const { return stack; }
+    uint8_t StackPointer() const { return sp; }
+
+private:
+    friend class Debugger;
+    friend class LatencyProbe;
+    friend class RamSearch;
+
+    void CopyArchState(ArchState& state) const;
+    void TickTimers();
+    void CheckIndexRange(unsigned int length);
+    void OP_invalid();
+
+public:
+    // call
+    void OP_0nnn();
+
+    // display
+    void OP_00e0();
+    void OP_dxyn();
+
+    // flow
+    void OP_00ee();
+    void OP_1nnn();
+    void OP_2nnn();
+    void OP_bnnn();
+
+    // cond
+    void OP_3xnn();
+    void OP_4xnn();
+    void OP_5xy0();
+    void OP_9xy0();
+
+    //const
+    void OP_6xnn();
+    void OP_7xnn();
+
+    // assign
+    void OP_8xy0();
+
+    // bit op
+    void OP_8xy1();
+    void OP_8xy2();
+    void OP_8xy3();
+    void OP_8xy6();
+    void OP_8xye();
+
+    // math
+    void OP_8xy4();
+    void OP_8xy5();
+    void OP_8xy7();
+
+    // memory
+    void OP_annn();
+    void OP_fx1e();
+    void OP_fx29();
+    void OP_fx55();
+    void OP_fx65();
+
+    // XO-CHIP register ranges
+    void OP_5xy2();
+    void OP_5xy3();
+
+    // rand
+    void OP_cxnn();
+
+    // key op
+    void OP_ex9e();
+    void OP_exa1();
+    void OP_fx0a();
+
+    // timer
+    void OP_fx07();
+    void OP_fx15();
+
+    // sound
+    void OP_fx18();
+
+    // XO-CHIP audio
+    void OP_f002();
+    void OP_fx3a();
+
+    // bcd
+    void OP_fx33();
+
+};
+
+static_assert(alignof(Chip8) == CACHE_LINE_SIZE);
+static_assert(sizeof(Chip8) % CACHE_LINE_SIZE == 0);
+// snapshots are plain copies
+static_assert(std::is_trivially_copyable_v<Chip8>);
+
+#endif //CHIP_8_CHIP8_H
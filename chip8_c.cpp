@@ -0,0 +1,286 @@
+#include "chip8_c.h"
+
+#include <new>
+#include <system_error>
+
+#include "chip8.h"
+#include "vector_env.h"
+
+static_assert(CHIP8_VIDEO_WIDTH == VIDEO_WIDTH && CHIP8_VIDEO_HEIGHT == VIDEO_HEIGHT);
+
+struct chip8_instance {
+    Chip8 chip8;
+    // host-owned keypad, and what the instance was last told about it
+    uint8_t keypad[CHIP8_KEY_COUNT]{};
+    uint8_t applied[CHIP8_KEY_COUNT]{};
+    unsigned int instructions_per_frame{CHIP8_DEFAULT_INSTRUCTIONS_PER_FRAME};
+
+    chip8_instance() = default;
+    chip8_instance(uint64_t seed, uint64_t instance_id) : chip8(seed, instance_id) {}
+
+    // forwards keypad edges through SetKey, so a press still completes FX0A
+    void ApplyKeys() {
+        for (uint8_t key = 0; key < CHIP8_KEY_COUNT; ++key) {
+            uint8_t held = keypad[key] != 0;
+            if (held != applied[key]) {
+                applied[key] = held;
+                chip8.SetKey(key, held);
+            }
+        }
+    }
+};
+
+namespace {
+
+thread_local chip8_error last_error = CHIP8_OK;
+
+// Records the outcome of the current call for chip8_last_error().
+template <typename T>
+T Finish(chip8_error error, T result) {
+    last_error = error;
+    return result;
+}
+
+void Finish(chip8_error error) {
+    last_error = error;
+}
+
+// The error for the exception being handled; call only inside a catch block.
+chip8_error Caught() {
+    try {
+        throw;
+    } catch (const std::bad_alloc&) {
+        return CHIP8_ERROR_OUT_OF_MEMORY;
+    } catch (const std::system_error&) {
+        return CHIP8_ERROR_SYSTEM;
+    } catch (...) {
+        return CHIP8_ERROR_INTERNAL;
+    }
+}
+
+}
+
+uint32_t chip8_abi_version(void) {
+    return CHIP8_ABI_VERSION;
+}
+
+chip8_error chip8_last_error(void) {
+    return last_error;
+}
+
+const char* chip8_error_message(chip8_error error) {
+    switch (error) {
+        case CHIP8_OK: return "no error";
+        case CHIP8_ERROR_NULL_ARGUMENT: return "a required pointer was NULL";
+        case CHIP8_ERROR_INVALID_ARGUMENT: return "invalid argument";
+        case CHIP8_ERROR_OUT_OF_MEMORY: return "out of memory";
+        case CHIP8_ERROR_IO: return "cannot read file";
+        case CHIP8_ERROR_SYSTEM: return "system resource unavailable";
+        case CHIP8_ERROR_INTERNAL: return "internal error";
+    }
+    return "unknown error";
+}
+
+// No C++ exception may cross the C ABI: every entry point that runs code
+// which can throw catches everything and records it as an error instead.
+
+chip8_instance* chip8_create(void) {
+    try {
+        return Finish(CHIP8_OK, new chip8_instance());
+    } catch (...) {
+        return Finish(Caught(), nullptr);
+    }
+}
+
+chip8_instance* chip8_create_seeded(uint64_t seed, uint64_t instance_id) {
+    try {
+        return Finish(CHIP8_OK, new chip8_instance(seed, instance_id));
+    } catch (...) {
+        return Finish(Caught(), nullptr);
+    }
+}
+
+void chip8_destroy(chip8_instance* instance) {
+    delete instance;
+    Finish(CHIP8_OK);
+}
+
+int chip8_load_rom(chip8_instance* instance, const uint8_t* data, size_t size) {
+    if (!instance || (!data && size)) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, 0);
+    }
+    try {
+        instance->chip8.LoadROM(data, size);
+        return Finish(CHIP8_OK, 1);
+    } catch (...) {
+        return Finish(Caught(), 0);
+    }
+}
+
+int chip8_load_rom_file(chip8_instance* instance, const char* path) {
+    if (!instance || !path) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, 0);
+    }
+    try {
+        return instance->chip8.LoadROM(path) ? Finish(CHIP8_OK, 1) : Finish(CHIP8_ERROR_IO, 0);
+    } catch (...) {
+        return Finish(Caught(), 0);
+    }
+}
+
+void chip8_set_instructions_per_frame(chip8_instance* instance, uint32_t instructions) {
+    if (!instance) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT);
+    }
+    instance->instructions_per_frame = instructions;
+    Finish(CHIP8_OK);
+}
+
+void chip8_step_frames(chip8_instance* const* instances, size_t n, uint32_t frames) {
+    if (!instances && n) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT);
+    }
+    try {
+        // instance-major, so each instance stays in cache for all of its frames
+        for (size_t i = 0; i < n; ++i) {
+            chip8_instance* instance = instances[i];
+            if (!instance) {
+                continue;
+            }
+            for (uint32_t frame = 0; frame < frames; ++frame) {
+                instance->ApplyKeys();
+                instance->chip8.RunFrame(instance->instructions_per_frame);
+            }
+        }
+        Finish(CHIP8_OK);
+    } catch (...) {
+        Finish(Caught());
+    }
+}
+
+const uint32_t* chip8_framebuffer(const chip8_instance* instance) {
+    if (!instance) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, nullptr);
+    }
+    return Finish(CHIP8_OK, instance->chip8.Video());
+}
+
+uint8_t* chip8_keypad(chip8_instance* instance) {
+    if (!instance) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, nullptr);
+    }
+    return Finish(CHIP8_OK, instance->keypad);
+}
+
+int chip8_waiting_for_key(const chip8_instance* instance) {
+    if (!instance) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, 0);
+    }
+    return Finish(CHIP8_OK, static_cast<int>(instance->chip8.WaitingForKey()));
+}
+
+struct chip8_vec_env {
+    VectorEnv env;
+};
+
+void chip8_vec_env_config_init(chip8_vec_env_config* config) {
+    if (!config) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT);
+    }
+    *config = chip8_vec_env_config{};
+    config->instances = 1;
+    config->threads = 1;
+    config->instructions_per_frame = CHIP8_DEFAULT_INSTRUCTIONS_PER_FRAME;
+    config->frame_skip = 1;
+    config->reward_address = CHIP8_NO_ADDRESS;
+    config->reward_bytes = 1;
+    config->done_address = CHIP8_NO_ADDRESS;
+    config->done_mask = 0xFF;
+    Finish(CHIP8_OK);
+}
+
+chip8_vec_env* chip8_vec_env_create(const chip8_vec_env_config* config, const chip8_instance* start) {
+    if (!config || !start || (config->action_count && !config->action_keys)) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, nullptr);
+    }
+    if (!config->instances) {
+        return Finish(CHIP8_ERROR_INVALID_ARGUMENT, nullptr);
+    }
+
+    try {
+        VectorEnvConfig env_config;
+        env_config.instances = config->instances;
+        env_config.threads = config->threads;
+        env_config.instructions_per_frame = config->instructions_per_frame;
+        env_config.frame_skip = config->frame_skip;
+        env_config.format = config->expanded_observations ? ObservationFormat::Expanded : ObservationFormat::Packed;
+        env_config.action_keys.assign(config->action_keys, config->action_keys + config->action_count);
+        env_config.reward_address = config->reward_address;
+        env_config.reward_bytes = config->reward_bytes;
+        env_config.done_address = config->done_address;
+        env_config.done_mask = config->done_mask;
+        env_config.done_value = config->done_value;
+        env_config.max_episode_frames = config->max_episode_frames;
+        env_config.seed = config->seed;
+        return Finish(CHIP8_OK, new chip8_vec_env{{env_config, start->chip8}});
+    } catch (...) {
+        return Finish(Caught(), nullptr);
+    }
+}
+
+void chip8_vec_env_destroy(chip8_vec_env* env) {
+    delete env;
+    Finish(CHIP8_OK);
+}
+
+void chip8_vec_env_reset(chip8_vec_env* env) {
+    if (!env) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT);
+    }
+    try {
+        env->env.Reset();
+        Finish(CHIP8_OK);
+    } catch (...) {
+        Finish(Caught());
+    }
+}
+
+void chip8_vec_env_step(chip8_vec_env* env, const int32_t* actions) {
+    if (!env || !actions) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT);
+    }
+    try {
+        env->env.Step(actions);
+        Finish(CHIP8_OK);
+    } catch (...) {
+        Finish(Caught());
+    }
+}
+
+const uint8_t* chip8_vec_env_observations(const chip8_vec_env* env) {
+    if (!env) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, nullptr);
+    }
+    return Finish(CHIP8_OK, env->env.Observations());
+}
+
+size_t chip8_vec_env_observation_size(const chip8_vec_env* env) {
+    if (!env) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, size_t{0});
+    }
+    return Finish(CHIP8_OK, env->env.ObservationSize());
+}
+
+const float* chip8_vec_env_rewards(const chip8_vec_env* env) {
+    if (!env) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, nullptr);
+    }
+    return Finish(CHIP8_OK, env->env.Rewards());
+}
+
+const uint8_t* chip8_vec_env_dones(const chip8_vec_env* env) {
+    if (!env) {
+        return Finish(CHIP8_ERROR_NULL_ARGUMENT, nullptr);
+    }
+    return Finish(CHIP8_OK, env->env.Dones());
+}
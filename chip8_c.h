@@ -0,0 +1,147 @@
+#ifndef CHIP_8_CHIP8_C_H
+#define CHIP_8_CHIP8_C_H
+
+/*
+ * Stable C ABI of libchip8, for embedding the interpreter in other languages.
+ *
+ * Instances are opaque handles. chip8_step_frames() advances any number of
+ * instances by any number of frames in one call, so a host whose calls are
+ * expensive pays that cost once per batch rather than once per instance.
+ *
+ * The framebuffer and keypad pointers stay valid for the life of the handle.
+ * The framebuffer is VIDEO_WIDTH x VIDEO_HEIGHT pixels, row-major, each
+ * 0x00000000 or 0xFFFFFFFF; it changes only inside chip8_step_frames(). The
+ * keypad is 16 bytes, nonzero meaning held, written by the host between
+ * calls and applied at the start of every frame.
+ *
+ * A handle may be used by one thread at a time; distinct handles are
+ * independent.
+ *
+ * Every function other than the three below that report versions and errors
+ * records its outcome, which chip8_last_error() returns until the next call
+ * on the same thread. A NULL handle or required pointer is
+ * CHIP8_ERROR_NULL_ARGUMENT everywhere; the call then does nothing and
+ * returns 0 or NULL. chip8_destroy() and chip8_vec_env_destroy() accept NULL,
+ * like free().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(CHIP8_SHARED)
+#ifdef CHIP8_BUILD
+#define CHIP8_API __declspec(dllexport)
+#else
+#define CHIP8_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define CHIP8_API __attribute__((visibility("default")))
+#else
+#define CHIP8_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bumped on any incompatible change to the functions below */
+#define CHIP8_ABI_VERSION 1
+
+#define CHIP8_VIDEO_WIDTH 64
+#define CHIP8_VIDEO_HEIGHT 32
+#define CHIP8_KEY_COUNT 16
+#define CHIP8_DEFAULT_INSTRUCTIONS_PER_FRAME 11
+
+typedef struct chip8_instance chip8_instance;
+
+typedef enum chip8_error {
+    CHIP8_OK = 0,
+    CHIP8_ERROR_NULL_ARGUMENT = 1,
+    CHIP8_ERROR_INVALID_ARGUMENT = 2,
+    CHIP8_ERROR_OUT_OF_MEMORY = 3,
+    CHIP8_ERROR_IO = 4,     /* a ROM file could not be read */
+    CHIP8_ERROR_SYSTEM = 5, /* the OS refused a thread or other resource */
+    CHIP8_ERROR_INTERNAL = 6,
+} chip8_error;
+
+CHIP8_API uint32_t chip8_abi_version(void);
+
+/* outcome of the calling thread's previous libchip8 call */
+CHIP8_API chip8_error chip8_last_error(void);
+/* static English description; never NULL */
+CHIP8_API const char* chip8_error_message(chip8_error error);
+
+/* NULL if out of memory */
+CHIP8_API chip8_instance* chip8_create(void);
+/* CXNN draws from a stream fixed by (seed, instance_id), for reproducible runs */
+CHIP8_API chip8_instance* chip8_create_seeded(uint64_t seed, uint64_t instance_id);
+CHIP8_API void chip8_destroy(chip8_instance* instance);
+
+/* copies the ROM to 0x200, truncating what does not fit; 0 on failure */
+CHIP8_API int chip8_load_rom(chip8_instance* instance, const uint8_t* data, size_t size);
+CHIP8_API int chip8_load_rom_file(chip8_instance* instance, const char* path);
+
+CHIP8_API void chip8_set_instructions_per_frame(chip8_instance* instance, uint32_t instructions);
+
+/*
+ * Runs `frames` frames on each of the n instances. A frame applies keypad
+ * changes, executes up to the instance's instructions per frame (fewer if
+ * it waits for a key) and ticks the timers once. NULL handles are skipped.
+ */
+CHIP8_API void chip8_step_frames(chip8_instance* const* instances, size_t n, uint32_t frames);
+
+CHIP8_API const uint32_t* chip8_framebuffer(const chip8_instance* instance);
+CHIP8_API uint8_t* chip8_keypad(chip8_instance* instance);
+
+/* nonzero while suspended on FX0A */
+CHIP8_API int chip8_waiting_for_key(const chip8_instance* instance);
+
+/*
+ * Vector environment for reinforcement learning: many copies of one
+ * instance stepped together on a thread pool. Every copy starts from the
+ * state `start` had at creation and is restored to it when its episode
+ * ends. The observation, reward and done buffers are allocated at creation
+ * and rewritten in place by every step; their pointers never change.
+ */
+typedef struct chip8_vec_env chip8_vec_env;
+
+#define CHIP8_NO_ADDRESS (-1)
+
+typedef struct chip8_vec_env_config {
+    uint32_t instances;
+    uint32_t threads;               /* including the caller */
+    uint32_t instructions_per_frame;
+    uint32_t frame_skip;            /* frames per step, same action */
+    uint32_t expanded_observations; /* 0: 1 bit per pixel, else 1 byte per pixel */
+    const uint16_t* action_keys;    /* action -> keypad bitmask, copied at creation */
+    uint32_t action_count;
+    int32_t reward_address;         /* big-endian counter; reward is its change */
+    uint32_t reward_bytes;
+    int32_t done_address;           /* done when (byte & done_mask) == done_value */
+    uint8_t done_mask;
+    uint8_t done_value;
+    uint64_t max_episode_frames;    /* 0 for no limit */
+    uint64_t seed;
+} chip8_vec_env_config;
+
+CHIP8_API void chip8_vec_env_config_init(chip8_vec_env_config* config);
+
+/* NULL on failure */
+CHIP8_API chip8_vec_env* chip8_vec_env_create(const chip8_vec_env_config* config, const chip8_instance* start);
+CHIP8_API void chip8_vec_env_destroy(chip8_vec_env* env);
+
+CHIP8_API void chip8_vec_env_reset(chip8_vec_env* env);
+/* actions holds one entry per instance */
+CHIP8_API void chip8_vec_env_step(chip8_vec_env* env, const int32_t* actions);
+
+/* [instances][observation_size] uint8 */
+CHIP8_API const uint8_t* chip8_vec_env_observations(const chip8_vec_env* env);
+CHIP8_API size_t chip8_vec_env_observation_size(const chip8_vec_env* env);
+CHIP8_API const float* chip8_vec_env_rewards(const chip8_vec_env* env);
+CHIP8_API const uint8_t* chip8_vec_env_dones(const chip8_vec_env* env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CHIP_8_CHIP8_C_H
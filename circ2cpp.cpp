@@ -0,0 +1,1641 @@
+// circ2cpp: compiles a Logisim-evolution .circ netlist into straight-line C++.
+//
+// The main circuit is parsed, wires are merged into nets, and combinational
+// components are levelized into a single topological order. Each clock period
+// is then emitted as a fixed sequence of evaluation points: the rising edge,
+// one point per rank of derived clocks (flip-flops clocked by other
+// flip-flops, as in a ripple counter), the same again for the falling edge,
+// and a final settle for the output pins. Every evaluation point recomputes
+// only the fan-in cone it needs, in level order, so the generated Clock() has
+// no event queue, no loops and no dispatch.
+//
+// The model is two-state: floating nets read as 0, tri-state drivers that
+// share a net are ORed, and a floating gate input is ignored, matching the
+// gateUndefined=ignore option. Registers and flip-flops sample their data at
+// the evaluation point in which their clock edge is seen.
+//
+// With --lanes the model is bit-sliced instead: every signal bit is its own
+// uint64_t, so one Clock() steps 64 independent copies of the circuit. Each
+// register output bit, controlled buffer enable and demultiplexer select bit
+// is a fault site whose keep/force masks can pin any lane to 0 or 1, which
+// is what chip8_faultsim uses for parallel stuck-at fault simulation.
+//
+// usage: circ2cpp <design.circ> <output stem> <class name> [--lanes]
+//
+// Writes <stem>.h and <stem>.cpp.
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// XML --------------------------------------------------------------------
+
+struct XmlElement {
+    std::string name;
+    std::map<std::string, std::string> attributes;
+    std::vector<XmlElement> children;
+};
+
+// Just enough XML for .circ files: elements, attributes, the predefined and
+// numeric entities. Text content, comments and processing instructions are
+// skipped.
+class XmlParser {
+public:
+    explicit XmlParser(std::string text) : text(std::move(text)) {}
+
+    bool Parse(XmlElement& root) {
+        SkipMisc();
+        return ParseElement(root);
+    }
+
+    std::size_t Offset() const { return pos; }
+
+private:
+    bool AtEnd() const { return pos >= text.size(); }
+
+    bool StartsWith(const char* prefix) const { return text.compare(pos, std::char_traits<char>::length(prefix), prefix) == 0; }
+
+    void SkipSpace() {
+        while (!AtEnd() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+    }
+
+    // skips text, comments, declarations and processing instructions up to
+    // the next element tag
+    void SkipMisc() {
+        while (!AtEnd()) {
+            if (StartsWith("<!--")) {
+                std::size_t end = text.find("-->", pos);
+                pos = end == std::string::npos ? text.size() : end + 3;
+            } else if (StartsWith("<?") || StartsWith("<!")) {
+                std::size_t end = text.find('>', pos);
+                pos = end == std::string::npos ? text.size() : end + 1;
+            } else if (text[pos] == '<') {
+                return;
+            } else {
+                ++pos;
+            }
+        }
+    }
+
+    std::string ParseName() {
+        std::size_t start = pos;
+        while (!AtEnd() && !std::isspace(static_cast<unsigned char>(text[pos])) && text[pos] != '=' && text[pos] != '>' &&
+               text[pos] != '/') {
+            ++pos;
+        }
+        return text.substr(start, pos - start);
+    }
+
+    // false for a malformed numeric entity such as &#x; or &#12a;
+    static bool Decode(const std::string& raw, std::string& out) {
+        out.clear();
+        for (std::size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '&') {
+                out += raw[i];
+                continue;
+            }
+            std::size_t end = raw.find(';', i);
+            if (end == std::string::npos) {
+                out += raw[i];
+                continue;
+            }
+            std::string entity = raw.substr(i + 1, end - i - 1);
+            if (entity == "amp") {
+                out += '&';
+            } else if (entity == "lt") {
+                out += '<';
+            } else if (entity == "gt") {
+                out += '>';
+            } else if (entity == "quot") {
+                out += '"';
+            } else if (entity == "apos") {
+                out += '\'';
+            } else if (!entity.empty() && entity[0] == '#') {
+                // strtoul rather than stoul, which throws on malformed input
+                const bool hex = entity.size() > 1 && entity[1] == 'x';
+                const char* digits = entity.c_str() + (hex ? 2 : 1);
+                if (!(hex ? std::isxdigit(static_cast<unsigned char>(*digits))
+                          : std::isdigit(static_cast<unsigned char>(*digits)))) {
+                    return false;
+                }
+                char* digits_end = nullptr;
+                errno = 0;
+                const unsigned long code = std::strtoul(digits, &digits_end, hex ? 16 : 10);
+                if (*digits_end != '\0' || errno == ERANGE) {
+                    return false;
+                }
+                out += code < 0x80 ? static_cast<char>(code) : '?';
+            } else {
+                out += raw.substr(i, end - i + 1);
+            }
+            i = end;
+        }
+        return true;
+    }
+
+    bool ParseElement(XmlElement& element) {
+        if (AtEnd() || text[pos] != '<') {
+            return false;
+        }
+        ++pos;
+        element.name = ParseName();
+        if (element.name.empty()) {
+            return false;
+        }
+
+        while (true) {
+            SkipSpace();
+            if (AtEnd()) {
+                return false;
+            }
+            if (StartsWith("/>")) {
+                pos += 2;
+                return true;
+            }
+            if (text[pos] == '>') {
+                ++pos;
+                break;
+            }
+
+            std::string key = ParseName();
+            SkipSpace();
+            if (key.empty() || AtEnd() || text[pos] != '=') {
+                return false;
+            }
+            ++pos;
+            SkipSpace();
+            if (AtEnd() || (text[pos] != '"' && text[pos] != '\'')) {
+                return false;
+            }
+            char quote = text[pos++];
+            std::size_t end = text.find(quote, pos);
+            if (end == std::string::npos) {
+                return false;
+            }
+            if (!Decode(text.substr(pos, end - pos), element.attributes[key])) {
+                return false;
+            }
+            pos = end + 1;
+        }
+
+        while (true) {
+            SkipMisc();
+            if (AtEnd()) {
+                return false;
+            }
+            if (StartsWith("</")) {
+                std::size_t end = text.find('>', pos);
+                if (end == std::string::npos) {
+                    return false;
+                }
+                pos = end + 1;
+                return true;
+            }
+            element.children.emplace_back();
+            if (!ParseElement(element.children.back())) {
+                return false;
+            }
+        }
+    }
+
+    std::string text;
+    std::size_t pos{};
+};
+
+// Netlist ----------------------------------------------------------------
+
+struct Point {
+    int x;
+    int y;
+};
+
+uint64_t PointKey(Point p) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(p.x)) << 32) | static_cast<uint32_t>(p.y);
+}
+
+enum class Facing { East, West, North, South };
+
+// rotates an offset given for an east-facing component
+Point Rotate(Facing facing, int dx, int dy) {
+    switch (facing) {
+        case Facing::East:
+            return {dx, dy};
+        case Facing::West:
+            return {-dx, -dy};
+        case Facing::North:
+            return {dy, -dx};
+        case Facing::South:
+            return {-dy, dx};
+    }
+    return {dx, dy};
+}
+
+enum class Kind { Pin, Clock, Constant, Tunnel, Splitter, Gate, Not, ControlledBuffer, Demultiplexer, Register, FlipFlop };
+
+enum class GateOp { And, Or, Xor, Nand, Nor, Xnor };
+
+// port order per kind:
+//   Pin, Clock, Constant, Tunnel   0 connection
+//   Gate                           0 out, 1.. inputs
+//   Not                            0 out, 1 in
+//   ControlledBuffer               0 out, 1 in, 2 control
+//   Demultiplexer                  0 in, 1 select, 2.. outputs
+//   Register                       0 out, 1 in, 2 enable, 3 clock, 4 clear
+//   FlipFlop                       0 q, 1 q', 2 d, 3 clock
+//   Splitter                       0 combined, 1.. ends
+struct Port {
+    Point at;
+    int width;
+    int net = -1;
+};
+
+struct Component {
+    Kind kind;
+    std::string type;
+    std::string label;
+    Point loc;
+    int width = 1;
+    std::vector<Port> ports;
+
+    bool output_pin = false;
+    uint64_t constant = 0;
+    GateOp op = GateOp::And;
+    std::vector<bool> negated;
+    bool falling = false;
+    // splitter: end index (0-based) for each bit of the combined side, -1 for none
+    std::vector<int> bit_end;
+    int splitter_direction = 0;  // 1 combined -> ends, -1 ends -> combined
+    int state = -1;              // index into the state array for registers and flip-flops
+};
+
+struct Driver {
+    int component;
+    int port;
+};
+
+struct Net {
+    int width = 0;
+    std::vector<Driver> drivers;
+    Point first{};
+};
+
+uint64_t Mask(int width) {
+    return width >= 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+}
+
+std::string Hex(uint64_t value) {
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), "0x%llXull", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+// Logisim's default spread of incoming bits over the ends of a splitter
+std::vector<int> DefaultDistribution(int fanout, int bits) {
+    std::vector<int> ends(bits);
+    if (fanout >= bits) {
+        std::iota(ends.begin(), ends.end(), 0);
+        return ends;
+    }
+    int per_end = bits / fanout;
+    int with_extra = bits % fanout;
+    int end = -1;
+    int left = 0;
+    for (int i = 0; i < bits; ++i) {
+        if (left == 0) {
+            ++end;
+            left = per_end;
+            if (with_extra > 0) {
+                ++left;
+                --with_extra;
+            }
+        }
+        ends[i] = end;
+        --left;
+    }
+    return ends;
+}
+
+std::string Identifier(const std::string& text) {
+    std::string out;
+    for (char c: text) {
+        out += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_';
+    }
+    if (out.empty() || std::isdigit(static_cast<unsigned char>(out[0]))) {
+        out.insert(0, "_");
+    }
+    return out;
+}
+
+class Netlist {
+public:
+    bool Load(const XmlElement& project);
+    bool Compile(const std::string& stem, const std::string& class_name, bool lane_sliced);
+
+private:
+    static std::string Attr(const XmlElement& comp, const std::string& name, const std::string& fallback = "");
+    bool AddComponent(const XmlElement& comp);
+    bool BuildNets(const std::vector<std::pair<Point, Point>>& wires);
+    bool ResolveSplitters();
+    bool Levelize();
+    bool RankClocks();
+
+    std::string Describe(int component) const;
+    // one local per net, or per net bit when lane-sliced
+    int Bits(int net) const { return lanes ? nets[net].width : 1; }
+    std::string NetName(int net, int bit = 0) const {
+        return "n" + std::to_string(net) + (lanes ? "_" + std::to_string(bit) : "");
+    }
+    std::string Read(int net, int bit = 0) const { return Floating(net) ? "0" : NetName(net, bit); }
+    std::string StateRef(int component, int bit) const;
+    std::string DriverExpression(const Driver& driver, int phase_clock) const;
+    std::string LaneExpression(const Driver& driver, int phase_clock, int bit) const;
+    std::string NetExpression(int net, int phase_clock, int bit) const;
+    std::string Site(int site, const std::string& value) const;
+    void EnumerateFaultSites();
+    std::vector<int> Inputs(const Driver& driver) const;
+    bool Floating(int net) const { return net < 0 || nets[net].drivers.empty(); }
+
+    // transitive fan-in of the given nets, plus the sources it reaches
+    struct Cone {
+        std::vector<bool> nets;
+        std::set<int> states;
+        bool clock = false;
+        bool inputs = false;
+    };
+    Cone FanIn(const std::vector<int>& roots) const;
+    void EmitCone(std::string& out, const Cone& cone, int phase_clock) const;
+    bool DirectClock(const Component& element) const;
+
+    std::vector<Component> components;
+    std::vector<Net> nets;
+    std::vector<int> order;          // nets in level order
+    std::vector<int> inputs;         // component indices of input pins
+    std::vector<int> outputs;        // component indices of output pins
+    std::vector<int> elements;       // component indices of registers and flip-flops
+    std::vector<int> rank;           // per component; -1 for anything but storage
+    std::vector<int> last_clock;     // per component; index into the last-clock array or -1
+    int clock_net = -1;
+    int max_rank = -1;
+    std::size_t derived_count = 0;
+    std::string circuit_name;
+
+    // lane-sliced output with stuck-at fault sites
+    struct FaultSite {
+        int component;
+        const char* kind;
+        int bit;
+    };
+    bool lanes = false;
+    std::vector<FaultSite> sites;
+    std::vector<int> first_site;     // per component; -1 if it has no fault sites
+    std::vector<int> state_offset;   // per storage element; first bit in the lane state array
+    int state_bits = 0;
+};
+
+std::string Netlist::Attr(const XmlElement& comp, const std::string& name, const std::string& fallback) {
+    for (const XmlElement& child: comp.children) {
+        if (child.name == "a" && child.attributes.count("name") && child.attributes.at("name") == name) {
+            auto it = child.attributes.find("val");
+            return it == child.attributes.end() ? fallback : it->second;
+        }
+    }
+    return fallback;
+}
+
+std::string Netlist::Describe(int component) const {
+    const Component& c = components[component];
+    std::string text = c.type;
+    if (!c.label.empty()) {
+        text += " \"" + c.label + "\"";
+    }
+    return text + " at (" + std::to_string(c.loc.x) + "," + std::to_string(c.loc.y) + ")";
+}
+
+bool Netlist::AddComponent(const XmlElement& comp) {
+    Component c;
+    c.type = comp.attributes.count("name") ? comp.attributes.at("name") : "";
+    if (std::sscanf(comp.attributes.count("loc") ? comp.attributes.at("loc").c_str() : "", "(%d,%d)", &c.loc.x, &c.loc.y) !=
+        2) {
+        std::fprintf(stderr, "circ2cpp: %s has no location\n", c.type.c_str());
+        return false;
+    }
+    c.label = Attr(comp, "label");
+    c.width = std::stoi(Attr(comp, "width", "1"));
+
+    std::string facing_name = Attr(comp, "facing", "east");
+    Facing facing = facing_name == "west" ? Facing::West
+                    : facing_name == "north" ? Facing::North
+                    : facing_name == "south" ? Facing::South
+                                             : Facing::East;
+    auto at = [&](int dx, int dy, int width) {
+        Point offset = Rotate(facing, dx, dy);
+        c.ports.push_back({{c.loc.x + offset.x, c.loc.y + offset.y}, width});
+    };
+    // offsets that Logisim places without rotating
+    auto at_fixed = [&](int dx, int dy, int width) { c.ports.push_back({{c.loc.x + dx, c.loc.y + dy}, width}); };
+
+    static const std::map<std::string, GateOp> GATES = {
+            {"AND Gate", GateOp::And},   {"OR Gate", GateOp::Or},   {"XOR Gate", GateOp::Xor},
+            {"NAND Gate", GateOp::Nand}, {"NOR Gate", GateOp::Nor}, {"XNOR Gate", GateOp::Xnor},
+    };
+
+    if (c.type == "Text" || c.type == "Probe") {
+        return true;
+    } else if (c.type == "Pin") {
+        c.kind = Kind::Pin;
+        c.output_pin = Attr(comp, "output", "false") == "true";
+        at(0, 0, c.width);
+    } else if (c.type == "Clock") {
+        c.kind = Kind::Clock;
+        at(0, 0, 1);
+    } else if (c.type == "Constant") {
+        c.kind = Kind::Constant;
+        c.constant = std::stoull(Attr(comp, "value", "0x1"), nullptr, 0) & Mask(c.width);
+        at(0, 0, c.width);
+    } else if (c.type == "Tunnel") {
+        c.kind = Kind::Tunnel;
+        at(0, 0, c.width);
+    } else if (GATES.count(c.type)) {
+        c.kind = Kind::Gate;
+        c.op = GATES.at(c.type);
+        int size = std::stoi(Attr(comp, "size", "50"));
+        int count = std::stoi(Attr(comp, "inputs", "2"));
+        if (count != 2 || (size != 30 && size != 50 && size != 70)) {
+            std::fprintf(stderr, "circ2cpp: %s at (%d,%d): only two-input gates are supported\n", c.type.c_str(), c.loc.x,
+                         c.loc.y);
+            return false;
+        }
+        // the XOR family is drawn with a wider back
+        int depth = size + (c.op == GateOp::Xor || c.op == GateOp::Xnor ? 10 : 0);
+        int spread = size / 2 - 5;
+        at(0, 0, c.width);
+        at(-depth, -spread, c.width);
+        at(-depth, spread, c.width);
+        c.negated = {Attr(comp, "negate0", "false") == "true", Attr(comp, "negate1", "false") == "true"};
+    } else if (c.type == "NOT Gate") {
+        c.kind = Kind::Not;
+        int size = std::stoi(Attr(comp, "size", "30"));
+        at(0, 0, c.width);
+        at(-size, 0, c.width);
+    } else if (c.type == "Controlled Buffer") {
+        c.kind = Kind::ControlledBuffer;
+        at(0, 0, c.width);
+        at(-20, 0, c.width);
+        at(-10, Attr(comp, "control", "right") == "left" ? -10 : 10, 1);
+    } else if (c.type == "Demultiplexer") {
+        c.kind = Kind::Demultiplexer;
+        int select = std::stoi(Attr(comp, "select", "1"));
+        if (select < 2 || Attr(comp, "enable", "false") == "true") {
+            std::fprintf(stderr, "circ2cpp: Demultiplexer at (%d,%d): needs a select of 2+ bits and no enable\n", c.loc.x,
+                         c.loc.y);
+            return false;
+        }
+        int count = 1 << select;
+        int first = -(count / 2) * 10;
+        at_fixed(0, 0, c.width);
+        // outputs run left to right or top to bottom whatever the facing,
+        // with the select input beside output 0
+        switch (facing) {
+            case Facing::East:
+                at_fixed(20, -first, select);
+                break;
+            case Facing::West:
+                at_fixed(-20, -first, select);
+                break;
+            case Facing::North:
+                at_fixed(first, -20, select);
+                break;
+            case Facing::South:
+                at_fixed(first, 20, select);
+                break;
+        }
+        for (int i = 0; i < count; ++i) {
+            switch (facing) {
+                case Facing::East:
+                    at_fixed(40, first + 10 * i, c.width);
+                    break;
+                case Facing::West:
+                    at_fixed(-40, first + 10 * i, c.width);
+                    break;
+                case Facing::North:
+                    at_fixed(first + 10 * i, -40, c.width);
+                    break;
+                case Facing::South:
+                    at_fixed(first + 10 * i, 40, c.width);
+                    break;
+            }
+        }
+    } else if (c.type == "Register" || c.type == "D Flip-Flop") {
+        std::string trigger = Attr(comp, "trigger", "rising");
+        if (trigger != "rising" && trigger != "falling") {
+            std::fprintf(stderr, "circ2cpp: %s at (%d,%d): level-triggered storage is not supported\n", c.type.c_str(),
+                         c.loc.x, c.loc.y);
+            return false;
+        }
+        if (Attr(comp, "appearance", "logisim_evolution") != "logisim_evolution" || facing != Facing::East) {
+            std::fprintf(stderr, "circ2cpp: %s at (%d,%d): only the east-facing evolution appearance is supported\n",
+                         c.type.c_str(), c.loc.x, c.loc.y);
+            return false;
+        }
+        c.falling = trigger == "falling";
+        if (c.type == "Register") {
+            c.kind = Kind::Register;
+            c.width = std::stoi(Attr(comp, "width", "8"));
+            at(60, 30, c.width);
+            at(0, 30, c.width);
+            at(0, 50, 1);
+            at(0, 70, 1);
+            at(30, 90, 1);
+        } else {
+            c.kind = Kind::FlipFlop;
+            at(50, 10, 1);
+            at(50, 50, 1);
+            at(-10, 10, 1);
+            at(-10, 50, 1);
+        }
+    } else if (c.type == "Splitter") {
+        c.kind = Kind::Splitter;
+        int fanout = std::stoi(Attr(comp, "fanout", "2"));
+        int incoming = std::stoi(Attr(comp, "incoming", "2"));
+        c.width = incoming;
+        c.bit_end = DefaultDistribution(fanout, incoming);
+        for (int bit = 0; bit < incoming; ++bit) {
+            std::string end = Attr(comp, "bit" + std::to_string(bit));
+            if (end == "none") {
+                c.bit_end[bit] = -1;
+            } else if (!end.empty()) {
+                c.bit_end[bit] = std::stoi(end);
+            }
+        }
+
+        std::string appear = Attr(comp, "appear", "left");
+        int justify = appear == "right" ? 1 : appear == "left" ? -1 : 0;
+        at(0, 0, incoming);
+        for (int end = 0; end < fanout; ++end) {
+            int width = static_cast<int>(std::count(c.bit_end.begin(), c.bit_end.end(), end));
+            if (facing == Facing::East || facing == Facing::West) {
+                int m = facing == Facing::West ? -1 : 1;
+                int dy0 = justify == 0 ? -10 * (fanout / 2) : m * justify > 0 ? 10 : -10 * fanout;
+                at_fixed(m * 20, dy0 + 10 * end, width);
+            } else {
+                int m = facing == Facing::North ? 1 : -1;
+                int dx0 = justify == 0 ? 10 * ((fanout + 1) / 2 - 1) : m * justify < 0 ? -10 : 10 * fanout;
+                at_fixed(dx0 - 10 * end, -m * 20, width);
+            }
+        }
+    } else {
+        std::fprintf(stderr, "circ2cpp: unsupported component %s at (%d,%d)\n", c.type.c_str(), c.loc.x, c.loc.y);
+        return false;
+    }
+
+    components.push_back(std::move(c));
+    return true;
+}
+
+bool Netlist::Load(const XmlElement& project) {
+    std::string main_name;
+    for (const XmlElement& child: project.children) {
+        if (child.name == "main") {
+            main_name = child.attributes.count("name") ? child.attributes.at("name") : "";
+        }
+    }
+
+    const XmlElement* circuit = nullptr;
+    std::set<std::string> circuit_names;
+    for (const XmlElement& child: project.children) {
+        if (child.name == "circuit") {
+            std::string name = child.attributes.count("name") ? child.attributes.at("name") : "";
+            circuit_names.insert(name);
+            if (!circuit || name == main_name) {
+                circuit = &child;
+            }
+        }
+    }
+    if (!circuit) {
+        std::fprintf(stderr, "circ2cpp: no circuit in project\n");
+        return false;
+    }
+    circuit_name = circuit->attributes.count("name") ? circuit->attributes.at("name") : "";
+
+    std::vector<std::pair<Point, Point>> wires;
+    for (const XmlElement& child: circuit->children) {
+        if (child.name == "comp") {
+            if (!child.attributes.count("lib")) {
+                std::fprintf(stderr, "circ2cpp: subcircuits are not supported (%s)\n",
+                             child.attributes.count("name") ? child.attributes.at("name").c_str() : "?");
+                return false;
+            }
+            if (!AddComponent(child)) {
+                return false;
+            }
+        } else if (child.name == "wire") {
+            Point from{}, to{};
+            if (std::sscanf(child.attributes.count("from") ? child.attributes.at("from").c_str() : "", "(%d,%d)", &from.x,
+                            &from.y) != 2 ||
+                std::sscanf(child.attributes.count("to") ? child.attributes.at("to").c_str() : "", "(%d,%d)", &to.x,
+                            &to.y) != 2) {
+                std::fprintf(stderr, "circ2cpp: malformed wire\n");
+                return false;
+            }
+            wires.emplace_back(from, to);
+        }
+    }
+
+    return BuildNets(wires) && ResolveSplitters() && Levelize() && RankClocks();
+}
+
+bool Netlist::BuildNets(const std::vector<std::pair<Point, Point>>& wires) {
+    std::unordered_map<uint64_t, int> ids;
+    std::vector<int> parent;
+    std::vector<Point> where;
+    auto id = [&](Point p) {
+        auto [it, added] = ids.try_emplace(PointKey(p), static_cast<int>(parent.size()));
+        if (added) {
+            parent.push_back(it->second);
+            where.push_back(p);
+        }
+        return it->second;
+    };
+    auto find = [&](int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    auto unite = [&](int a, int b) { parent[find(a)] = find(b); };
+
+    for (const auto& [from, to]: wires) {
+        unite(id(from), id(to));
+    }
+    // a wire end landing on the middle of another wire joins it
+    std::vector<Point> ends;
+    for (const auto& [from, to]: wires) {
+        ends.push_back(from);
+        ends.push_back(to);
+    }
+    for (const auto& [from, to]: wires) {
+        for (Point p: ends) {
+            bool vertical = from.x == to.x && p.x == from.x && p.y > std::min(from.y, to.y) && p.y < std::max(from.y, to.y);
+            bool horizontal = from.y == to.y && p.y == from.y && p.x > std::min(from.x, to.x) && p.x < std::max(from.x, to.x);
+            if (vertical || horizontal) {
+                unite(id(p), id(from));
+            }
+        }
+    }
+    for (Component& c: components) {
+        for (Port& port: c.ports) {
+            id(port.at);
+        }
+    }
+    std::map<std::string, int> tunnels;
+    for (Component& c: components) {
+        if (c.kind == Kind::Tunnel) {
+            auto [it, added] = tunnels.try_emplace(c.label, id(c.ports[0].at));
+            unite(id(c.ports[0].at), it->second);
+        }
+    }
+
+    std::unordered_map<int, int> net_of_root;
+    for (Component& c: components) {
+        for (Port& port: c.ports) {
+            int root = find(id(port.at));
+            auto [it, added] = net_of_root.try_emplace(root, static_cast<int>(nets.size()));
+            if (added) {
+                nets.emplace_back();
+                nets.back().first = where[root];
+            }
+            port.net = it->second;
+            if (port.width == 0) {
+                continue;
+            }
+            Net& net = nets[port.net];
+            if (net.width && net.width != port.width) {
+                std::fprintf(stderr, "circ2cpp: width mismatch (%d vs %d) at (%d,%d)\n", net.width, port.width, port.at.x,
+                             port.at.y);
+                return false;
+            }
+            net.width = port.width;
+        }
+    }
+
+    for (std::size_t i = 0; i < components.size(); ++i) {
+        Component& c = components[i];
+        int index = static_cast<int>(i);
+        auto drive = [&](int port) { nets[c.ports[port].net].drivers.push_back({index, port}); };
+        switch (c.kind) {
+            case Kind::Pin:
+                if (c.output_pin) {
+                    outputs.push_back(index);
+                } else {
+                    inputs.push_back(index);
+                    drive(0);
+                }
+                break;
+            case Kind::Clock:
+                if (clock_net >= 0 && clock_net != c.ports[0].net) {
+                    std::fprintf(stderr, "circ2cpp: only one clock net is supported\n");
+                    return false;
+                }
+                clock_net = c.ports[0].net;
+                drive(0);
+                break;
+            case Kind::Constant:
+            case Kind::Gate:
+            case Kind::Not:
+            case Kind::ControlledBuffer:
+                drive(0);
+                break;
+            case Kind::Demultiplexer:
+                for (std::size_t port = 2; port < c.ports.size(); ++port) {
+                    drive(static_cast<int>(port));
+                }
+                break;
+            case Kind::Register:
+                drive(0);
+                c.state = static_cast<int>(elements.size());
+                elements.push_back(index);
+                break;
+            case Kind::FlipFlop:
+                drive(0);
+                drive(1);
+                c.state = static_cast<int>(elements.size());
+                elements.push_back(index);
+                break;
+            case Kind::Tunnel:
+            case Kind::Splitter:
+                break;
+        }
+    }
+    return true;
+}
+
+bool Netlist::ResolveSplitters() {
+    // splitters pass values whichever way they are driven from
+    auto driven_by_other = [&](int net, int splitter) {
+        for (const Driver& d: nets[net].drivers) {
+            if (d.component != splitter) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (std::size_t i = 0; i < components.size(); ++i) {
+            Component& c = components[i];
+            if (c.kind != Kind::Splitter || c.splitter_direction) {
+                continue;
+            }
+            int index = static_cast<int>(i);
+            bool combined = driven_by_other(c.ports[0].net, index);
+            bool ends = false;
+            for (std::size_t port = 1; port < c.ports.size(); ++port) {
+                ends |= c.ports[port].width && driven_by_other(c.ports[port].net, index);
+            }
+            if (combined && ends) {
+                std::fprintf(stderr, "circ2cpp: %s is driven from both sides\n", Describe(index).c_str());
+                return false;
+            }
+            if (combined) {
+                c.splitter_direction = 1;
+                for (std::size_t port = 1; port < c.ports.size(); ++port) {
+                    if (c.ports[port].width) {
+                        nets[c.ports[port].net].drivers.push_back({index, static_cast<int>(port)});
+                    }
+                }
+                progress = true;
+            } else if (ends) {
+                c.splitter_direction = -1;
+                nets[c.ports[0].net].drivers.push_back({index, 0});
+                progress = true;
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < components.size(); ++i) {
+        const Component& c = components[i];
+        if (c.kind == Kind::Register && !Floating(c.ports[4].net)) {
+            std::fprintf(stderr, "circ2cpp: %s: asynchronous clear is not supported\n", Describe(static_cast<int>(i)).c_str());
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < nets.size(); ++i) {
+        const Net& net = nets[i];
+        if (net.drivers.size() < 2) {
+            continue;
+        }
+        // Logisim shows a conflict on such a net whenever the drivers
+        // disagree; keep going so the rest of the design can be simulated
+        for (const Driver& d: net.drivers) {
+            Kind kind = components[d.component].kind;
+            if (kind != Kind::ControlledBuffer && kind != Kind::Splitter) {
+                std::fprintf(stderr, "circ2cpp: warning: net at (%d,%d) has several drivers, including %s; resolving as wired-OR\n",
+                             net.first.x, net.first.y, Describe(d.component).c_str());
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<int> Netlist::Inputs(const Driver& driver) const {
+    const Component& c = components[driver.component];
+    std::vector<int> in;
+    switch (c.kind) {
+        case Kind::Gate:
+            in = {c.ports[1].net, c.ports[2].net};
+            break;
+        case Kind::Not:
+            in = {c.ports[1].net};
+            break;
+        case Kind::ControlledBuffer:
+            in = {c.ports[1].net, c.ports[2].net};
+            break;
+        case Kind::Demultiplexer:
+            in = {c.ports[0].net, c.ports[1].net};
+            break;
+        case Kind::Splitter:
+            if (c.splitter_direction > 0) {
+                in = {c.ports[0].net};
+            } else {
+                for (std::size_t port = 1; port < c.ports.size(); ++port) {
+                    if (c.ports[port].width) {
+                        in.push_back(c.ports[port].net);
+                    }
+                }
+            }
+            break;
+        default:
+            // pins, the clock, constants and storage outputs are sources
+            break;
+    }
+    in.erase(std::remove_if(in.begin(), in.end(), [&](int net) { return Floating(net); }), in.end());
+    return in;
+}
+
+bool Netlist::Levelize() {
+    std::vector<int> pending(nets.size());
+    std::vector<std::vector<int>> readers(nets.size());
+    for (std::size_t i = 0; i < nets.size(); ++i) {
+        std::set<int> deps;
+        for (const Driver& d: nets[i].drivers) {
+            for (int in: Inputs(d)) {
+                deps.insert(in);
+            }
+        }
+        pending[i] = static_cast<int>(deps.size());
+        for (int dep: deps) {
+            readers[dep].push_back(static_cast<int>(i));
+        }
+    }
+
+    std::vector<int> ready;
+    for (std::size_t i = 0; i < nets.size(); ++i) {
+        if (!pending[i]) {
+            ready.push_back(static_cast<int>(i));
+        }
+    }
+    while (!ready.empty()) {
+        int net = ready.back();
+        ready.pop_back();
+        order.push_back(net);
+        for (int reader: readers[net]) {
+            if (--pending[reader] == 0) {
+                ready.push_back(reader);
+            }
+        }
+    }
+
+    if (order.size() != nets.size()) {
+        for (std::size_t i = 0; i < nets.size(); ++i) {
+            if (pending[i]) {
+                std::fprintf(stderr, "circ2cpp: combinational loop through the net at (%d,%d)\n", nets[i].first.x,
+                             nets[i].first.y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+Netlist::Cone Netlist::FanIn(const std::vector<int>& roots) const {
+    Cone cone;
+    cone.nets.assign(nets.size(), false);
+    std::vector<int> stack;
+    for (int net: roots) {
+        if (net >= 0 && !cone.nets[net]) {
+            cone.nets[net] = true;
+            stack.push_back(net);
+        }
+    }
+    while (!stack.empty()) {
+        int net = stack.back();
+        stack.pop_back();
+        for (const Driver& d: nets[net].drivers) {
+            const Component& c = components[d.component];
+            if (c.kind == Kind::Register || c.kind == Kind::FlipFlop) {
+                cone.states.insert(d.component);
+            } else if (c.kind == Kind::Clock) {
+                cone.clock = true;
+            } else if (c.kind == Kind::Pin) {
+                cone.inputs = true;
+            }
+            for (int in: Inputs(d)) {
+                if (!cone.nets[in]) {
+                    cone.nets[in] = true;
+                    stack.push_back(in);
+                }
+            }
+        }
+    }
+    return cone;
+}
+
+bool Netlist::DirectClock(const Component& element) const {
+    int net = element.ports[3].net;
+    return net == clock_net && nets[net].drivers.size() == 1;
+}
+
+bool Netlist::RankClocks() {
+    // rank 0 holds elements on the clock itself and on clocks made from
+    // inputs; each further rank is clocked by elements of lower ranks
+    rank.assign(components.size(), -1);
+    last_clock.assign(components.size(), -1);
+    std::vector<int> visiting(components.size(), 0);
+
+    std::function<bool(int)> visit = [&](int index) {
+        if (visiting[index] == 2) {
+            return true;
+        }
+        if (visiting[index] == 1) {
+            std::fprintf(stderr, "circ2cpp: %s is clocked through its own output\n", Describe(index).c_str());
+            return false;
+        }
+        visiting[index] = 1;
+        const Component& c = components[index];
+        int r = 0;
+        if (!DirectClock(c) && !Floating(c.ports[3].net)) {
+            for (int source: FanIn({c.ports[3].net}).states) {
+                if (!visit(source)) {
+                    return false;
+                }
+                r = std::max(r, rank[source] + 1);
+            }
+            last_clock[index] = static_cast<int>(derived_count++);
+        }
+        rank[index] = r;
+        max_rank = std::max(max_rank, r);
+        visiting[index] = 2;
+        return true;
+    };
+    for (int index: elements) {
+        if (!visit(index)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string Netlist::DriverExpression(const Driver& driver, int phase_clock) const {
+    const Component& c = components[driver.component];
+    uint64_t mask = Mask(nets[c.ports[driver.port].net].width);
+    switch (c.kind) {
+        case Kind::Pin:
+            return "(in[" + std::to_string(std::find(inputs.begin(), inputs.end(), driver.component) - inputs.begin()) +
+                   "] & " + Hex(mask) + ")";
+        case Kind::Clock:
+            return std::to_string(phase_clock);
+        case Kind::Constant:
+            return Hex(c.constant);
+        case Kind::Gate: {
+            std::string in[2];
+            for (int i = 0; i < 2; ++i) {
+                int net = c.ports[1 + i].net;
+                if (Floating(net)) {
+                    // ignored input: the identity of the operation
+                    bool ones = c.op == GateOp::And || c.op == GateOp::Nand;
+                    in[i] = ones ? Hex(mask) : "0";
+                } else {
+                    in[i] = c.negated[i] ? "(~" + NetName(net) + " & " + Hex(mask) + ")" : NetName(net);
+                }
+            }
+            switch (c.op) {
+                case GateOp::And:
+                    return "(" + in[0] + " & " + in[1] + ")";
+                case GateOp::Or:
+                    return "(" + in[0] + " | " + in[1] + ")";
+                case GateOp::Xor:
+                    return "(" + in[0] + " ^ " + in[1] + ")";
+                case GateOp::Nand:
+                    return "(~(" + in[0] + " & " + in[1] + ") & " + Hex(mask) + ")";
+                case GateOp::Nor:
+                    return "(~(" + in[0] + " | " + in[1] + ") & " + Hex(mask) + ")";
+                case GateOp::Xnor:
+                    return "(~(" + in[0] + " ^ " + in[1] + ") & " + Hex(mask) + ")";
+            }
+            return "0";
+        }
+        case Kind::Not:
+            return "(~" + Read(c.ports[1].net) + " & " + Hex(mask) + ")";
+        case Kind::ControlledBuffer:
+            return "((" + Read(c.ports[2].net) + " & 1) ? " + Read(c.ports[1].net) + " : 0)";
+        case Kind::Demultiplexer:
+            return "(" + Read(c.ports[1].net) + " == " + std::to_string(driver.port - 2) + " ? " + Read(c.ports[0].net) +
+                   " : 0)";
+        case Kind::Register:
+            return "state[" + std::to_string(c.state) + "]";
+        case Kind::FlipFlop:
+            return driver.port == 0 ? "state[" + std::to_string(c.state) + "]"
+                                    : "(state[" + std::to_string(c.state) + "] ^ 1)";
+        case Kind::Splitter: {
+            // gather runs of consecutive bits
+            std::vector<std::string> terms;
+            auto add_runs = [&](const std::vector<std::pair<int, int>>& bits, const std::string& from) {
+                // bits: (source bit, destination bit), in destination order
+                for (std::size_t i = 0; i < bits.size();) {
+                    std::size_t j = i + 1;
+                    while (j < bits.size() && bits[j].first == bits[j - 1].first + 1 &&
+                           bits[j].second == bits[j - 1].second + 1) {
+                        ++j;
+                    }
+                    int length = static_cast<int>(j - i);
+                    std::string term = "(" + from + " >> " + std::to_string(bits[i].first) + ") & " + Hex(Mask(length));
+                    if (bits[i].second) {
+                        term = "((" + term + ") << " + std::to_string(bits[i].second) + ")";
+                    } else {
+                        term = "(" + term + ")";
+                    }
+                    terms.push_back(term);
+                    i = j;
+                }
+            };
+            if (driver.port > 0) {
+                std::vector<std::pair<int, int>> bits;
+                for (int bit = 0; bit < c.width; ++bit) {
+                    if (c.bit_end[bit] == driver.port - 1) {
+                        bits.emplace_back(bit, static_cast<int>(bits.size()));
+                    }
+                }
+                add_runs(bits, Read(c.ports[0].net));
+            } else {
+                for (std::size_t end = 1; end < c.ports.size(); ++end) {
+                    if (Floating(c.ports[end].net)) {
+                        continue;
+                    }
+                    std::vector<std::pair<int, int>> bits;
+                    int position = 0;
+                    for (int bit = 0; bit < c.width; ++bit) {
+                        if (c.bit_end[bit] == static_cast<int>(end) - 1) {
+                            bits.emplace_back(position++, bit);
+                        }
+                    }
+                    add_runs(bits, NetName(c.ports[end].net));
+                }
+            }
+            if (terms.empty()) {
+                return "0";
+            }
+            std::string joined = terms[0];
+            for (std::size_t i = 1; i < terms.size(); ++i) {
+                joined += " | " + terms[i];
+            }
+            return terms.size() > 1 ? "(" + joined + ")" : joined;
+        }
+        case Kind::Tunnel:
+            break;
+    }
+    return "0";
+}
+
+std::string Netlist::LaneExpression(const Driver& driver, int phase_clock, int bit) const {
+    const Component& c = components[driver.component];
+    switch (c.kind) {
+        case Kind::Pin:
+            // inputs are shared by every lane
+            return "(0 - ((in[" +
+                   std::to_string(std::find(inputs.begin(), inputs.end(), driver.component) - inputs.begin()) + "] >> " +
+                   std::to_string(bit) + ") & 1))";
+        case Kind::Clock:
+            return phase_clock ? "~uint64_t{0}" : "0";
+        case Kind::Constant:
+            return (c.constant >> bit) & 1 ? "~uint64_t{0}" : "0";
+        case Kind::Gate: {
+            std::string in[2];
+            for (int i = 0; i < 2; ++i) {
+                int net = c.ports[1 + i].net;
+                if (Floating(net)) {
+                    bool ones = c.op == GateOp::And || c.op == GateOp::Nand;
+                    in[i] = ones ? "~uint64_t{0}" : "0";
+                } else {
+                    in[i] = c.negated[i] ? "~" + NetName(net, bit) : NetName(net, bit);
+                }
+            }
+            switch (c.op) {
+                case GateOp::And:
+                    return "(" + in[0] + " & " + in[1] + ")";
+                case GateOp::Or:
+                    return "(" + in[0] + " | " + in[1] + ")";
+                case GateOp::Xor:
+                    return "(" + in[0] + " ^ " + in[1] + ")";
+                case GateOp::Nand:
+                    return "~(" + in[0] + " & " + in[1] + ")";
+                case GateOp::Nor:
+                    return "~(" + in[0] + " | " + in[1] + ")";
+                case GateOp::Xnor:
+                    return "~(" + in[0] + " ^ " + in[1] + ")";
+            }
+            return "0";
+        }
+        case Kind::Not:
+            return "~" + Read(c.ports[1].net, bit);
+        case Kind::ControlledBuffer:
+            return "(" + Read(c.ports[1].net, bit) + " & " + Site(first_site[driver.component], Read(c.ports[2].net, 0)) +
+                   ")";
+        case Kind::Demultiplexer: {
+            // the output is selected when every select bit matches its index
+            int output = driver.port - 2;
+            std::string expression = "(" + Read(c.ports[0].net, bit);
+            for (int j = 0; j < c.ports[1].width; ++j) {
+                std::string select = Site(first_site[driver.component] + j, Read(c.ports[1].net, j));
+                expression += (output >> j) & 1 ? " & " + select : " & ~" + select;
+            }
+            return expression + ")";
+        }
+        case Kind::Register:
+            return StateRef(driver.component, bit);
+        case Kind::FlipFlop:
+            return driver.port == 0 ? StateRef(driver.component, 0) : "~" + StateRef(driver.component, 0);
+        case Kind::Splitter:
+            if (driver.port > 0) {
+                int position = 0;
+                for (int b = 0; b < c.width; ++b) {
+                    if (c.bit_end[b] == driver.port - 1 && position++ == bit) {
+                        return Read(c.ports[0].net, b);
+                    }
+                }
+            } else if (c.bit_end[bit] >= 0) {
+                int end = c.bit_end[bit];
+                int position = static_cast<int>(std::count(c.bit_end.begin(), c.bit_end.begin() + bit, end));
+                return Read(c.ports[end + 1].net, position);
+            }
+            return "0";
+        case Kind::Tunnel:
+            break;
+    }
+    return "0";
+}
+
+std::string Netlist::NetExpression(int net, int phase_clock, int bit) const {
+    const Net& n = nets[net];
+    if (n.drivers.empty()) {
+        return "0";
+    }
+    auto term = [&](const Driver& driver) {
+        return lanes ? LaneExpression(driver, phase_clock, bit) : DriverExpression(driver, phase_clock);
+    };
+    std::string expression = term(n.drivers[0]);
+    for (std::size_t i = 1; i < n.drivers.size(); ++i) {
+        expression += "\n            | " + term(n.drivers[i]);
+    }
+    return expression;
+}
+
+void Netlist::EmitCone(std::string& out, const Cone& cone, int phase_clock) const {
+    for (int net: order) {
+        if (cone.nets[net] && !nets[net].drivers.empty()) {
+            for (int bit = 0; bit < Bits(net); ++bit) {
+                out += "        " + NetName(net, bit) + " = " + NetExpression(net, phase_clock, bit) + ";\n";
+            }
+        }
+    }
+}
+
+std::string Netlist::StateRef(int component, int bit) const {
+    int state = components[component].state;
+    return "state[" + std::to_string(lanes ? state_offset[state] + bit : state) + "]";
+}
+
+std::string Netlist::Site(int site, const std::string& value) const {
+    return "((" + value + " & keep[" + std::to_string(site) + "]) | force[" + std::to_string(site) + "])";
+}
+
+void Netlist::EnumerateFaultSites() {
+    first_site.assign(components.size(), -1);
+    auto add = [&](int index, const char* kind, int count) {
+        first_site[index] = static_cast<int>(sites.size());
+        for (int bit = 0; bit < count; ++bit) {
+            sites.push_back({index, kind, bit});
+        }
+    };
+    for (std::size_t i = 0; i < components.size(); ++i) {
+        const Component& c = components[i];
+        int index = static_cast<int>(i);
+        if (c.kind == Kind::Register) {
+            add(index, "output", c.width);
+        } else if (c.kind == Kind::ControlledBuffer) {
+            add(index, "enable", 1);
+        } else if (c.kind == Kind::Demultiplexer) {
+            add(index, "select", c.ports[1].width);
+        }
+    }
+
+    int offset = 0;
+    for (int index: elements) {
+        state_offset.push_back(offset);
+        offset += components[index].kind == Kind::Register ? components[index].width : 1;
+    }
+    state_bits = offset;
+}
+
+bool Netlist::Compile(const std::string& stem, const std::string& class_name, bool lane_sliced) {
+    lanes = lane_sliced;
+    if (lanes) {
+        EnumerateFaultSites();
+    }
+
+    std::string base = stem.substr(stem.find_last_of("/\\") + 1);
+    std::string guard = "CHIP_8_" + Identifier(base) + "_H";
+
+    // names for the interface
+    auto name_of = [&](int index, const char* prefix) {
+        const Component& c = components[index];
+        if (!c.label.empty()) {
+            return Identifier(c.label);
+        }
+        return std::string(prefix) + "_" + std::to_string(c.loc.x) + "_" + std::to_string(c.loc.y);
+    };
+    auto display_of = [&](int index) {
+        const Component& c = components[index];
+        if (!c.label.empty()) {
+            return c.label;
+        }
+        return c.type + " (" + std::to_string(c.loc.x) + "," + std::to_string(c.loc.y) + ")";
+    };
+    auto output_offset = [&](std::size_t output) {
+        int offset = 0;
+        for (std::size_t i = 0; i < output; ++i) {
+            offset += components[outputs[i]].width;
+        }
+        return offset;
+    };
+
+    std::string header;
+    header += "// Generated by circ2cpp from the \"" + circuit_name + "\" circuit. Do not edit.\n\n";
+    header += "#ifndef " + guard + "\n#define " + guard + "\n\n#include <cstddef>\n#include <cstdint>\n\n";
+    header += "#ifndef CHIP_8_CIRCUIT_SIGNAL\n#define CHIP_8_CIRCUIT_SIGNAL\n";
+    header += "struct CircuitSignal {\n    const char* name;\n    uint8_t width;\n};\n\n";
+    header += "struct CircuitFaultSite {\n    const char* component;\n    const char* kind;\n    uint8_t bit;\n};\n#endif\n\n";
+    if (lanes) {
+        header += "// Lane-sliced model: every signal bit is a word whose 64 bits are 64\n";
+        header += "// copies of the circuit, each of which can carry its own stuck-at fault.\n";
+    }
+    header += "struct " + class_name + " {\n";
+
+    auto emit_enum = [&](const char* name, const char* prefix, const std::vector<int>& list, const char* count) {
+        header += "    enum " + std::string(name) + " : std::size_t {\n";
+        for (int index: list) {
+            header += "        " + std::string(prefix) + "_" + name_of(index, components[index].kind == Kind::Pin ? "PIN"
+                                                                       : components[index].kind == Kind::Register
+                                                                               ? "REGISTER"
+                                                                               : "FLIP_FLOP") + ",\n";
+        }
+        header += "        " + std::string(count) + "\n    };\n\n";
+    };
+    emit_enum("Input", "INPUT", inputs, "INPUT_COUNT");
+    emit_enum("Output", "OUTPUT", outputs, "OUTPUT_COUNT");
+    emit_enum("State", "STATE", elements, "STATE_COUNT");
+
+    header += "    static const CircuitSignal INPUTS[INPUT_COUNT];\n";
+    header += "    static const CircuitSignal OUTPUTS[OUTPUT_COUNT];\n";
+    header += "    static const CircuitSignal STATES[STATE_COUNT];\n\n";
+    std::string clock_count = std::to_string(std::max<std::size_t>(derived_count, 1));
+    if (lanes) {
+        header += "    static constexpr std::size_t OUTPUT_BITS = " + std::to_string(output_offset(outputs.size())) + ";\n";
+        header += "    static constexpr std::size_t STATE_BITS = " + std::to_string(state_bits) + ";\n";
+        header += "    static constexpr std::size_t FAULT_SITE_COUNT = " + std::to_string(sites.size()) + ";\n";
+        header += "    // first bit of each output and state in out[] and state[]\n";
+        header += "    static const uint16_t OUTPUT_OFFSET[OUTPUT_COUNT];\n";
+        header += "    static const uint16_t STATE_OFFSET[STATE_COUNT];\n";
+        header += "    static const CircuitFaultSite FAULT_SITES[FAULT_SITE_COUNT];\n\n";
+        header += "    " + class_name + "() { ClearFaults(); }\n\n";
+        header += "    // zeroes every register and flip-flop and settles the outputs\n    void Reset();\n";
+        header += "    // one full clock period: rising edge, falling edge, settle\n    void Clock();\n";
+        header += "    // recomputes the outputs from the inputs and state with the clock low\n    void Settle();\n";
+        header += "    // removes every injected fault\n    void ClearFaults() {\n        for (std::size_t i = 0; i < FAULT_SITE_COUNT; ++i) {\n";
+        header += "            keep[i] = ~uint64_t{0};\n            force[i] = 0;\n        }\n    }\n\n";
+        header += "    // inputs are shared by every lane; the rest hold one word per bit\n";
+        header += "    uint64_t in[INPUT_COUNT]{};\n";
+        header += "    uint64_t out[OUTPUT_BITS]{};\n";
+        header += "    uint64_t state[STATE_BITS]{};\n";
+        header += "    // last clock level seen by storage on derived clocks\n";
+        header += "    uint64_t clocks[" + clock_count + "]{};\n";
+        header += "    // per fault site: lanes clear in keep are stuck at 0, lanes set in force at 1\n";
+        header += "    uint64_t keep[FAULT_SITE_COUNT];\n";
+        header += "    uint64_t force[FAULT_SITE_COUNT];\n";
+    } else {
+        header += "    // zeroes every register and flip-flop and settles the outputs\n    void Reset();\n";
+        header += "    // one full clock period: rising edge, falling edge, settle\n    void Clock();\n";
+        header += "    // recomputes the outputs from the inputs and state with the clock low\n    void Settle();\n\n";
+        header += "    uint64_t in[INPUT_COUNT]{};\n";
+        header += "    uint64_t out[OUTPUT_COUNT]{};\n";
+        header += "    uint64_t state[STATE_COUNT]{};\n";
+        header += "    // last clock level seen by storage on derived clocks\n";
+        header += "    uint8_t clocks[" + clock_count + "]{};\n";
+    }
+    header += "};\n\n#endif //" + guard + "\n";
+
+    std::string source;
+    source += "// Generated by circ2cpp from the \"" + circuit_name + "\" circuit. Do not edit.\n\n";
+    source += "#include \"" + base + ".h\"\n\n";
+    auto emit_table = [&](const char* table, const std::vector<int>& list) {
+        source += "const CircuitSignal " + class_name + "::" + table + "[] = {\n";
+        for (int index: list) {
+            source += "        {\"" + display_of(index) + "\", " + std::to_string(components[index].width) + "},\n";
+        }
+        if (list.empty()) {
+            source += "        {\"\", 0},\n";
+        }
+        source += "};\n\n";
+    };
+    emit_table("INPUTS", inputs);
+    emit_table("OUTPUTS", outputs);
+    emit_table("STATES", elements);
+    if (lanes) {
+        source += "const uint16_t " + class_name + "::OUTPUT_OFFSET[] = {";
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+            source += (i ? ", " : "") + std::to_string(output_offset(i));
+        }
+        source += outputs.empty() ? "0};\n\n" : "};\n\n";
+        source += "const uint16_t " + class_name + "::STATE_OFFSET[] = {";
+        for (std::size_t i = 0; i < state_offset.size(); ++i) {
+            source += (i % 16 == 0 ? "\n        " : " ") + std::to_string(state_offset[i]) + ",";
+        }
+        source += state_offset.empty() ? "0};\n\n" : "\n};\n\n";
+        source += "const CircuitFaultSite " + class_name + "::FAULT_SITES[] = {\n";
+        for (const FaultSite& site: sites) {
+            source += "        {\"" + display_of(site.component) + "\", \"" + site.kind + "\", " + std::to_string(site.bit) +
+                      "},\n";
+        }
+        if (sites.empty()) {
+            source += "        {\"\", \"\", 0},\n";
+        }
+        source += "};\n\n";
+    }
+
+    // every net that any evaluation point touches gets a local
+    std::vector<int> output_roots;
+    for (int index: outputs) {
+        output_roots.push_back(components[index].ports[0].net);
+    }
+    Cone output_cone = FanIn(output_roots);
+
+    auto declare = [&](const std::vector<bool>& used) {
+        std::string text;
+        int count = 0;
+        for (std::size_t net = 0; net < nets.size(); ++net) {
+            if (!used[net] || nets[net].drivers.empty()) {
+                continue;
+            }
+            for (int bit = 0; bit < Bits(static_cast<int>(net)); ++bit) {
+                text += count % 12 == 0 ? (count ? ";\n    uint64_t " : "    uint64_t ") : ", ";
+                text += NetName(static_cast<int>(net), bit);
+                ++count;
+            }
+        }
+        return count ? text + ";\n" : text;
+    };
+
+    std::string settle_body;
+    EmitCone(settle_body, output_cone, 0);
+    auto store_outputs = [&](std::string& out) {
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+            int net = components[outputs[i]].ports[0].net;
+            if (lanes) {
+                for (int bit = 0; bit < components[outputs[i]].width; ++bit) {
+                    out += "    out[" + std::to_string(output_offset(i) + bit) + "] = " + Read(net, bit) + ";\n";
+                }
+            } else {
+                out += "    out[" + std::to_string(i) + "] = " + Read(net, 0) + ";\n";
+            }
+        }
+    };
+
+    std::string clock_body;
+    std::vector<bool> used = output_cone.nets;
+    for (int phase = 0; phase < 2; ++phase) {
+        bool rising = phase == 0;
+        int level = rising ? 1 : 0;
+        std::set<int> dirty_states;
+        bool dirty_inputs = rising;
+        clock_body += rising ? "\n    // rising edge\n" : "\n    // falling edge\n";
+
+        for (int r = 0; r <= max_rank; ++r) {
+            std::vector<int> group;
+            std::vector<int> roots;
+            for (int index: elements) {
+                const Component& c = components[index];
+                if (rank[index] != r || Floating(c.ports[3].net)) {
+                    continue;
+                }
+                bool live;
+                if (last_clock[index] < 0) {
+                    live = c.falling != rising;
+                } else {
+                    Cone cone = FanIn({c.ports[3].net});
+                    live = cone.clock || (cone.inputs && dirty_inputs);
+                    for (int s: cone.states) {
+                        live |= dirty_states.count(s) > 0;
+                    }
+                }
+                if (!live) {
+                    continue;
+                }
+                group.push_back(index);
+                if (last_clock[index] >= 0) {
+                    roots.push_back(c.ports[3].net);
+                }
+                roots.push_back(c.ports[c.kind == Kind::Register ? 1 : 2].net);
+                if (c.kind == Kind::Register) {
+                    roots.push_back(c.ports[2].net);
+                }
+            }
+            if (group.empty()) {
+                continue;
+            }
+
+            Cone cone = FanIn(roots);
+            for (std::size_t net = 0; net < nets.size(); ++net) {
+                used[net] = used[net] || cone.nets[net];
+            }
+            clock_body += "    {\n        // rank " + std::to_string(r) + "\n";
+            EmitCone(clock_body, cone, level);
+
+            std::string commit;
+            for (int index: group) {
+                const Component& c = components[index];
+                int data_net = c.ports[c.kind == Kind::Register ? 1 : 2].net;
+                int bits = c.kind == Kind::Register ? c.width : 1;
+                std::string tag = std::to_string(c.state);
+                bool enabled = c.kind == Kind::Register && !Floating(c.ports[2].net);
+
+                if (lanes) {
+                    // m holds the lanes that load this period
+                    std::vector<std::string> terms;
+                    if (last_clock[index] >= 0) {
+                        std::string last = "clocks[" + std::to_string(last_clock[index]) + "]";
+                        std::string now = Read(c.ports[3].net, 0);
+                        terms.push_back(c.falling ? "(" + last + " & ~" + now + ")" : "(~" + last + " & " + now + ")");
+                        commit += "        " + last + " = " + now + ";\n";
+                    }
+                    if (enabled) {
+                        terms.push_back(NetName(c.ports[2].net, 0));
+                    }
+                    if (!terms.empty()) {
+                        std::string mask = terms[0];
+                        for (std::size_t i = 1; i < terms.size(); ++i) {
+                            mask += " & " + terms[i];
+                        }
+                        clock_body += "        const uint64_t m" + tag + " = " + mask + ";\n";
+                    }
+                    for (int bit = 0; bit < bits; ++bit) {
+                        std::string s = StateRef(index, bit);
+                        std::string t = "t" + tag + "_" + std::to_string(bit);
+                        std::string data = Read(data_net, bit);
+                        clock_body += "        const uint64_t " + t + " = " +
+                                      (terms.empty() ? data
+                                                     : "(" + data + " & m" + tag + ") | (" + s + " & ~m" + tag + ")") +
+                                      ";\n";
+                        commit += "        " + s + " = " +
+                                  (c.kind == Kind::Register ? Site(first_site[index] + bit, t) : t) + ";\n";
+                    }
+                } else {
+                    std::string s = StateRef(index, 0);
+                    std::string t = "t" + tag;
+                    std::string data = c.kind == Kind::Register ? Read(data_net, 0) : "(" + Read(data_net, 0) + " & 1)";
+                    std::string condition;
+                    if (last_clock[index] >= 0) {
+                        std::string last = "clocks[" + std::to_string(last_clock[index]) + "]";
+                        std::string now = "(" + Read(c.ports[3].net, 0) + " & 1)";
+                        condition = c.falling ? "(" + last + " && !" + now + ")" : "(!" + last + " && " + now + ")";
+                        commit += "        " + last + " = static_cast<uint8_t>" + now + ";\n";
+                    }
+                    if (enabled) {
+                        std::string enable = "(" + NetName(c.ports[2].net, 0) + " & 1)";
+                        condition = condition.empty() ? enable : condition + " && " + enable;
+                    }
+                    clock_body += "        const uint64_t " + t + " = " +
+                                  (condition.empty() ? data : condition + " ? " + data + " : " + s) + ";\n";
+                    commit += "        " + s + " = " + t + ";\n";
+                }
+                dirty_states.insert(index);
+            }
+            clock_body += commit + "    }\n";
+        }
+    }
+
+    source += "void " + class_name + "::Reset() {\n";
+    if (lanes) {
+        // stuck-at-1 lanes of a register output read 1 from the start
+        for (int index: elements) {
+            const Component& c = components[index];
+            for (int bit = 0; bit < (c.kind == Kind::Register ? c.width : 1); ++bit) {
+                source += "    " + StateRef(index, bit) + " = " +
+                          (c.kind == Kind::Register ? "force[" + std::to_string(first_site[index] + bit) + "]" : "0") +
+                          ";\n";
+            }
+        }
+    } else {
+        source += "    for (uint64_t& value: state) {\n        value = 0;\n    }\n";
+    }
+    if (derived_count) {
+        // storage on derived clocks starts from the settled level, so
+        // reset itself is not an edge
+        std::vector<int> roots;
+        for (int index: elements) {
+            if (last_clock[index] >= 0) {
+                roots.push_back(components[index].ports[3].net);
+            }
+        }
+        Cone cone = FanIn(roots);
+        source += declare(cone.nets) + "    {\n";
+        EmitCone(source, cone, 0);
+        for (int index: elements) {
+            if (last_clock[index] >= 0) {
+                std::string now = Read(components[index].ports[3].net, 0);
+                source += "        clocks[" + std::to_string(last_clock[index]) + "] = " +
+                          (lanes ? now : "static_cast<uint8_t>(" + now + " & 1)") + ";\n";
+            }
+        }
+        source += "    }\n";
+    }
+    source += "    Settle();\n}\n\n";
+
+    source += "void " + class_name + "::Settle() {\n" + declare(output_cone.nets) + "    {\n" + settle_body + "    }\n";
+    store_outputs(source);
+    source += "}\n\n";
+
+    source += "void " + class_name + "::Clock() {\n" + declare(used) + clock_body + "\n    // settle\n    {\n" +
+              settle_body + "    }\n";
+    store_outputs(source);
+    source += "}\n";
+
+    std::ofstream header_file(stem + ".h");
+    std::ofstream source_file(stem + ".cpp");
+    header_file << header;
+    source_file << source;
+    if (!header_file || !source_file) {
+        std::fprintf(stderr, "circ2cpp: cannot write %s.h/.cpp\n", stem.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool lanes = argc == 5 && std::string(argv[4]) == "--lanes";
+    if (argc != 4 && !lanes) {
+        std::fprintf(stderr, "usage: %s <design.circ> <output stem> <class name> [--lanes]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file) {
+        std::fprintf(stderr, "circ2cpp: cannot open %s\n", argv[1]);
+        return 1;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    XmlParser parser(std::move(text));
+    XmlElement project;
+    if (!parser.Parse(project) || project.name != "project") {
+        std::fprintf(stderr, "circ2cpp: %s: malformed project near offset %zu\n", argv[1], parser.Offset());
+        return 1;
+    }
+
+    Netlist netlist;
+    if (!netlist.Load(project) || !netlist.Compile(argv[2], argv[3], lanes)) {
+        return 1;
+    }
+    return 0;
+}
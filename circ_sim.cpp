@@ -0,0 +1,51 @@
+// chip8_circ_sim: runs a ROM headlessly on the gate-level model of chip8.circ.
+//
+// The model is generated from the .circ netlist at build time by circ2cpp,
+// so each instruction costs one call into straight-line code instead of a
+// clock tick of Logisim's event-driven simulator.
+//
+// usage: chip8_circ_sim [-cycles N] <rom>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "hardware.h"
+
+int main(int argc, char** argv) {
+    uint64_t cycles = 1000000;
+    const char* rom = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-cycles" && i + 1 < argc) {
+            cycles = std::strtoull(argv[++i], nullptr, 0);
+        } else {
+            rom = argv[i];
+        }
+    }
+    if (!rom) {
+        std::fprintf(stderr, "usage: %s [-cycles N] <rom>\n", argv[0]);
+        return 2;
+    }
+
+    HardwareModel model;
+    if (!model.LoadROM(rom)) {
+        std::fprintf(stderr, "cannot open %s\n", rom);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < cycles; ++i) {
+        model.Step();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%llu cycles in %.3f s (%.2f M cycles/s)\n", static_cast<unsigned long long>(model.Cycles()), seconds,
+                seconds > 0 ? model.Cycles() / seconds / 1e6 : 0.0);
+    std::printf("pc %03X  I %03X\n", model.ProgramCounter(), model.Index());
+    for (std::size_t i = 0; i < 16; ++i) {
+        std::printf("V%X %X%s", static_cast<unsigned int>(i), model.Register(i), i % 8 == 7 ? "\n" : "  ");
+    }
+    return 0;
+}
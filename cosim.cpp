@@ -0,0 +1,130 @@
+// chip8_cosim: runs the Chip8 interpreter and the gate-level model of
+// chip8.circ in lockstep and stops at the first architectural divergence.
+//
+// The interpreter leads: each instruction it fetches is also decoded into
+// the hardware model's pin strobes and clocked through once. After every
+// instruction V0-V15 and I are compared, each to the width of the register
+// in the design, and the first mismatch is printed as a state diff.
+//
+// A ROM that waits for a key either stops the run or, with -key, is answered
+// by pressing and releasing that key.
+//
+// usage: chip8_cosim [-max N] [-key K] <rom>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "chip8.h"
+#include "hardware.h"
+
+namespace {
+
+uint64_t WidthMask(const char* name) {
+    for (std::size_t i = 0; i < Chip8Circuit::STATE_COUNT; ++i) {
+        if (std::string(name) == Chip8Circuit::STATES[i].name) {
+            return (uint64_t{1} << Chip8Circuit::STATES[i].width) - 1;
+        }
+    }
+    return 0;
+}
+
+struct Comparison {
+    uint64_t register_masks[16];
+    uint64_t index_mask;
+
+    Comparison() {
+        for (std::size_t i = 0; i < 16; ++i) {
+            register_masks[i] = WidthMask(("V" + std::to_string(i)).c_str());
+        }
+        index_mask = WidthMask("I_reg");
+    }
+
+    bool Matches(const Chip8& chip8, const HardwareModel& model) const {
+        for (std::size_t i = 0; i < 16; ++i) {
+            if ((chip8.Registers()[i] & register_masks[i]) != model.Register(i)) {
+                return false;
+            }
+        }
+        return (chip8.Index() & index_mask) == model.Index();
+    }
+
+    void PrintDiff(const Chip8& chip8, const HardwareModel& model) const {
+        std::printf("        interpreter  hardware\n");
+        for (std::size_t i = 0; i < 16; ++i) {
+            uint8_t expected = chip8.Registers()[i];
+            std::printf("  V%-2X   %02X           %02X%s\n", static_cast<unsigned int>(i), expected, model.Register(i),
+                        (expected & register_masks[i]) != model.Register(i) ? "  *" : "");
+        }
+        std::printf("  I     %03X          %03X%s\n", chip8.Index(), model.Index(),
+                    (chip8.Index() & index_mask) != model.Index() ? "  *" : "");
+    }
+};
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t max_instructions = 10000000;
+    int answer_key = -1;
+    const char* rom = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-max" && i + 1 < argc) {
+            max_instructions = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "-key" && i + 1 < argc) {
+            answer_key = static_cast<int>(std::strtol(argv[++i], nullptr, 16)) & 0xF;
+        } else {
+            rom = argv[i];
+        }
+    }
+    if (!rom) {
+        std::fprintf(stderr, "usage: %s [-max N] [-key K] <rom>\n", argv[0]);
+        return 2;
+    }
+
+    Chip8 chip8;
+    HardwareModel model;
+    if (!chip8.LoadROM(rom)) {
+        std::fprintf(stderr, "cannot open %s\n", rom);
+        return 2;
+    }
+
+    Comparison comparison;
+    if (!comparison.Matches(chip8, model)) {
+        std::printf("divergence at reset\n");
+        comparison.PrintDiff(chip8, model);
+        return 1;
+    }
+
+    for (uint64_t executed = 0; executed < max_instructions; ++executed) {
+        uint16_t pc = chip8.ProgramCounter();
+        uint16_t opcode = (chip8.Memory()[pc & 0xFFFu] << 8u) | chip8.Memory()[(pc + 1u) & 0xFFFu];
+
+        chip8.Cycle();
+        if (chip8.WaitingForKey()) {
+            if (answer_key < 0) {
+                std::printf("no divergence in %llu instructions; stopped waiting for a key at pc %03X\n",
+                            static_cast<unsigned long long>(executed + 1), pc);
+                return 0;
+            }
+            chip8.SetKey(static_cast<uint8_t>(answer_key), true);
+            chip8.SetKey(static_cast<uint8_t>(answer_key), false);
+        }
+        model.Execute(opcode);
+
+        if (chip8.Faults()) {
+            std::printf("interpreter fault %02X at pc %03X, opcode %04X, after %llu instructions\n", chip8.Faults(), pc,
+                        opcode, static_cast<unsigned long long>(executed + 1));
+            return 1;
+        }
+        if (!comparison.Matches(chip8, model)) {
+            std::printf("divergence after %llu instructions at pc %03X, opcode %04X\n",
+                        static_cast<unsigned long long>(executed + 1), pc, opcode);
+            comparison.PrintDiff(chip8, model);
+            return 1;
+        }
+    }
+
+    std::printf("no divergence in %llu instructions\n", static_cast<unsigned long long>(max_instructions));
+    return 0;
+}
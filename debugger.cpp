@@ -0,0 +1,413 @@
+#include "debugger.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+using Value = std::function<unsigned int(const Chip8&)>;
+using Predicate = Debugger::Predicate;
+
+// Recursive descent over
+//     or      := and ('||' and)*
+//     and     := compare ('&&' compare)*
+//     compare := '(' or ')' | operand op operand
+//     operand := number | V0-VF | I | PC | SP | DT | ST | '[' operand ']'
+// building closures as it goes, so evaluation never re-parses.
+class ConditionParser {
+public:
+    explicit ConditionParser(const std::string& text) : text(text) {}
+
+    Predicate Parse(bool& ok) {
+        Predicate predicate = ParseOr();
+        SkipSpace();
+        ok = valid && pos == text.size();
+        return predicate;
+    }
+
+private:
+    void SkipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+    }
+
+    bool Accept(const char* token) {
+        SkipSpace();
+        const std::size_t length = std::strlen(token);
+        if (text.compare(pos, length, token) != 0) {
+            return false;
+        }
+        pos += length;
+        return true;
+    }
+
+    Predicate Fail() {
+        valid = false;
+        return [](const Chip8&) { return false; };
+    }
+
+    Predicate ParseOr() {
+        Predicate left = ParseAnd();
+        while (Accept("||")) {
+            left = [left, right = ParseAnd()](const Chip8& c) { return left(c) || right(c); };
+        }
+        return left;
+    }
+
+    Predicate ParseAnd() {
+        Predicate left = ParseCompare();
+        while (Accept("&&")) {
+            left = [left, right = ParseCompare()](const Chip8& c) { return left(c) && right(c); };
+        }
+        return left;
+    }
+
+    Predicate ParseCompare() {
+        if (Accept("(")) {
+            Predicate inner = ParseOr();
+            return Accept(")") ? inner : Fail();
+        }
+
+        const Value left = ParseOperand();
+        // two-character operators first so "<=" is not read as "<"
+        if (Accept("==")) return [left, right = ParseOperand()](const Chip8& c) { return left(c) == right(c); };
+        if (Accept("!=")) return [left, right = ParseOperand()](const Chip8& c) { return left(c) != right(c); };
+        if (Accept("<=")) return [left, right = ParseOperand()](const Chip8& c) { return left(c) <= right(c); };
+        if (Accept(">=")) return [left, right = ParseOperand()](const Chip8& c) { return left(c) >= right(c); };
+        if (Accept("<")) return [left, right = ParseOperand()](const Chip8& c) { return left(c) < right(c); };
+        if (Accept(">")) return [left, right = ParseOperand()](const Chip8& c) { return left(c) > right(c); };
+        return Fail();
+    }
+
+    Value ParseOperand() {
+        SkipSpace();
+        if (pos >= text.size()) {
+            valid = false;
+            return [](const Chip8&) { return 0u; };
+        }
+
+        if (Accept("[")) {
+            const Value address = ParseOperand();
+            if (!Accept("]")) {
+                valid = false;
+            }
+            return [address](const Chip8& c) { return unsigned{c.Memory()[address(c) & 0xFFFu]}; };
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(text[pos]))) {
+            // strtoul rather than stoul, which throws on out-of-range input
+            const char* start = text.c_str() + pos;
+            char* end = nullptr;
+            errno = 0;
+            const unsigned long number = std::strtoul(start, &end, 0);
+            pos += end - start;
+            if (errno == ERANGE || number > UINT_MAX) {
+                valid = false;
+            }
+            return [number](const Chip8&) { return static_cast<unsigned int>(number); };
+        }
+
+        std::size_t end = pos;
+        while (end < text.size() && std::isalnum(static_cast<unsigned char>(text[end]))) {
+            ++end;
+        }
+        std::string name = text.substr(pos, end - pos);
+        for (char& ch : name) {
+            ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+        }
+        pos = end;
+
+        if (name.size() == 2 && name[0] == 'V' && std::isxdigit(static_cast<unsigned char>(name[1]))) {
+            const unsigned int x = std::stoul(name.substr(1), nullptr, 16);
+            return [x](const Chip8& c) { return unsigned{c.Registers()[x]}; };
+        }
+        if (name == "I") return [](const Chip8& c) { return unsigned{c.Index()}; };
+        if (name == "PC") return [](const Chip8& c) { return unsigned{c.ProgramCounter()}; };
+        if (name == "SP") return [](const Chip8& c) { return unsigned{c.StackPointer()}; };
+        if (name == "DT") return [](const Chip8& c) { return unsigned{c.DelayTimer()}; };
+        if (name == "ST") return [](const Chip8& c) { return unsigned{c.SoundTimer()}; };
+
+        valid = false;
+        return [](const Chip8&) { return 0u; };
+    }
+
+    const std::string& text;
+    std::size_t pos{};
+    bool valid{true};
+};
+
+// Bitmask of the 64-byte pages covered by [address, address + length),
+// wrapping at the end of memory like the core's accesses do.
+uint64_t PageMask(uint16_t address, uint16_t length) {
+    uint64_t mask = 0;
+    const unsigned int first = address >> 6;
+    const unsigned int last = (address + length - 1) >> 6;
+    for (unsigned int page = first; page <= last; ++page) {
+        mask |= uint64_t{1} << (page & 63);
+    }
+    return mask;
+}
+
+// Jumps, calls, returns and skips, after which control may not fall through
+// to the next address. Every 5xyn, 9xyn and Exnn counts, skip or not.
+bool Transfers(uint16_t op) {
+    switch (op >> 12u) {
+        case 0x0: return op == 0x00EE;
+        case 0x1:
+        case 0x2:
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+        case 0xB:
+        case 0xE: return true;
+        default: return false;
+    }
+}
+
+// Stores through I, which may rewrite code.
+bool WritesMemory(uint16_t op) {
+    return (op & 0xF0FFu) == 0xF033u || (op & 0xF0FFu) == 0xF055u || (op & 0xF00Fu) == 0x5002u;
+}
+
+}
+
+Debugger::Predicate Debugger::Compile(const std::string& condition, bool* ok) {
+    bool valid = false;
+    Predicate predicate = ConditionParser(condition).Parse(valid);
+    if (ok) {
+        *ok = valid;
+    }
+    return valid ? predicate : Predicate{};
+}
+
+void Debugger::SetBreakpoint(uint16_t address) {
+    address &= 0xFFFu;
+    breakpoints[address >> 6] |= uint64_t{1} << (address & 63);
+    conditions.erase(address);
+    ResetBlock();
+}
+
+bool Debugger::SetBreakpoint(uint16_t address, const std::string& condition) {
+    bool ok = false;
+    Predicate predicate = Compile(condition, &ok);
+    if (!ok) {
+        return false;
+    }
+
+    SetBreakpoint(address);
+    conditions[address & 0xFFFu] = std::move(predicate);
+    return true;
+}
+
+void Debugger::ClearBreakpoint(uint16_t address) {
+    address &= 0xFFFu;
+    breakpoints[address >> 6] &= ~(uint64_t{1} << (address & 63));
+    conditions.erase(address);
+    ResetBlock();
+}
+
+bool Debugger::HasBreakpoint(uint16_t address) const {
+    address &= 0xFFFu;
+    return breakpoints[address >> 6] & (uint64_t{1} << (address & 63));
+}
+
+void Debugger::Watch(uint16_t address, uint16_t length, bool read, bool write) {
+    for (uint16_t i = 0; i < length; ++i) {
+        const uint16_t a = (address + i) & 0xFFFu;
+        const uint64_t bit = uint64_t{1} << (a & 63);
+        if (read) {
+            watch_read[a >> 6] |= bit;
+        }
+        if (write) {
+            watch_write[a >> 6] |= bit;
+        }
+    }
+    UpdatePages();
+}
+
+void Debugger::Unwatch(uint16_t address, uint16_t length) {
+    for (uint16_t i = 0; i < length; ++i) {
+        const uint16_t a = (address + i) & 0xFFFu;
+        watch_read[a >> 6] &= ~(uint64_t{1} << (a & 63));
+        watch_write[a >> 6] &= ~(uint64_t{1} << (a & 63));
+    }
+    UpdatePages();
+}
+
+void Debugger::UpdatePages() {
+    read_pages = write_pages = 0;
+    for (unsigned int page = 0; page < WORDS; ++page) {
+        read_pages |= uint64_t{watch_read[page] != 0} << page;
+        write_pages |= uint64_t{watch_write[page] != 0} << page;
+    }
+}
+
+StopReason Debugger::RunFrame(Chip8& chip8, unsigned int instructions) {
+    StopReason reason = StopReason::FrameDone;
+    // the ROM may have been changed between frames
+    block_left = 0;
+    const bool done = chip8.RunFrame(instructions, executed_in_frame, [&](const Chip8& c) {
+        if (!block_left) {
+            const uint16_t pc = c.program_counter & 0xFFFu;
+            const bool skip_break = resuming;
+            resuming = false;
+
+            if (!skip_break && ShouldBreak(c, pc)) {
+                reason = StopReason::Breakpoint;
+                resuming = true;
+                return Chip8::HookAction::Stop;
+            }
+            block_left = EnterBlock(c, pc);
+        }
+        --block_left;
+
+        ++executed;
+        if ((read_pages | write_pages) && CheckWatch(c, c.program_counter & 0xFFFu)) {
+            reason = StopReason::Watchpoint;
+            return Chip8::HookAction::RunThenStop;
+        }
+        return Chip8::HookAction::Run;
+    });
+
+    // Fx0A ends the frame early, timers ticked, exactly as without a debugger
+    return done && chip8.WaitingForKey() ? StopReason::WaitingForKey : reason;
+}
+
+StopReason Debugger::Step(Chip8& chip8) {
+    if (chip8.WaitingForKey()) {
+        return StopReason::WaitingForKey;
+    }
+
+    chip8.observe_lock.BeginWrite();
+    const bool watched = (read_pages | write_pages) && CheckWatch(chip8, chip8.program_counter & 0xFFFu);
+    chip8.Cycle();
+    ++executed_in_frame;
+    ++executed;
+    resuming = false;
+    // the instruction may have been a store into code
+    ResetBlock();
+    chip8.observe_lock.EndWrite();
+
+    return watched ? StopReason::Watchpoint : StopReason::FrameDone;
+}
+
+bool Debugger::ShouldBreak(const Chip8& chip8, uint16_t pc) const {
+    if (!HasBreakpoint(pc)) {
+        return false;
+    }
+
+    const auto condition = conditions.find(pc & 0xFFFu);
+    return condition == conditions.end() || condition->second(chip8);
+}
+
+void Debugger::Reposition(unsigned int instructions) {
+    executed_in_frame = instructions;
+    resuming = true;
+    ResetBlock();
+}
+
+unsigned int Debugger::EnterBlock(const Chip8& chip8, uint16_t pc) {
+    if (code_written) {
+        code_written = false;
+        ForgetBlocks();
+    }
+    if (block_epoch[pc] == epoch) {
+        return block_length[pc];
+    }
+
+    // the block stops short of the next breakpoint in pc's 64-address word,
+    // or at the word's end; the next word is looked at when pc gets there
+    const uint64_t beyond = breakpoints[pc >> 6] >> (pc & 63) >> 1;
+    const unsigned int limit = beyond ? pc + 1 + std::countr_zero(beyond) : ((pc >> 6) + 1) << 6;
+
+    unsigned int length = 0;
+    for (unsigned int at = pc;; at += 2) {
+        const uint16_t op = (chip8.memory[at & 0xFFFu] << 8u) | chip8.memory[(at + 1u) & 0xFFFu];
+        ++length;
+        if (WritesMemory(op)) {
+            // every block is looked at again once the store has run; this one
+            // is not worth keeping
+            code_written = true;
+            return length;
+        }
+        if (Transfers(op) || at + 2 >= limit) {
+            break;
+        }
+    }
+
+    block_epoch[pc] = epoch;
+    block_length[pc] = static_cast<uint8_t>(length);
+    return length;
+}
+
+void Debugger::ForgetBlocks() {
+    if (++epoch == 0) {
+        std::fill(std::begin(block_epoch), std::end(block_epoch), 0u);
+        epoch = 1;
+    }
+}
+
+bool Debugger::CheckWatch(const Chip8& chip8, uint16_t pc) {
+    // every access starts at I and is at most MAX_ACCESS long, so an I far
+    // from any watched page rules out a hit without decoding the opcode
+    if (!(PageMask(chip8.index & 0xFFFu, MAX_ACCESS) & (read_pages | write_pages))) {
+        return false;
+    }
+
+    MemoryAccess access{};
+    if (!DecodeAccess(chip8, pc, access)) {
+        return false;
+    }
+
+    return access.write ? Hit(watch_write, write_pages, access.address, access.length, true)
+                        : Hit(watch_read, read_pages, access.address, access.length, false);
+}
+
+bool Debugger::DecodeAccess(const Chip8& chip8, uint16_t pc, MemoryAccess& access) {
+    const uint16_t op = (chip8.memory[pc & 0xFFFu] << 8u) | chip8.memory[(pc + 1u) & 0xFFFu];
+    const uint16_t x = (op & 0x0F00u) >> 8u;
+    const uint16_t index = chip8.index & 0xFFFu;
+
+    switch (op & 0xF0FFu) {
+        case 0xF033: access = {index, 3, true}; return true;
+        case 0xF055: access = {index, static_cast<uint16_t>(x + 1), true}; return true;
+        case 0xF065: access = {index, static_cast<uint16_t>(x + 1), false}; return true;
+        case 0xF002:
+            access = {index, AUDIO_PATTERN_SIZE, false};
+            return op == 0xF002;
+        default: break;
+    }
+
+    if ((op & 0xF00Eu) == 0x5002u) {
+        const uint16_t y = (op & 0x00F0u) >> 4u;
+        access = {index, static_cast<uint16_t>((x <= y ? y - x : x - y) + 1), (op & 0xFu) == 0x2};
+        return true;
+    }
+    if ((op & 0xF000u) == 0xD000u && (op & 0xFu)) {
+        access = {index, static_cast<uint16_t>(op & 0xFu), false};
+        return true;
+    }
+    return false;
+}
+
+bool Debugger::Hit(const uint64_t* bitmap, uint64_t pages, uint16_t address, uint16_t length, bool write) {
+    if (!(PageMask(address, length) & pages)) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < length; ++i) {
+        const uint16_t a = (address + i) & 0xFFFu;
+        if (bitmap[a >> 6] & (uint64_t{1} << (a & 63))) {
+            last_watch = {a, write};
+            return true;
+        }
+    }
+    return false;
+}
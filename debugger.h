@@ -0,0 +1,132 @@
+#ifndef CHIP_8_DEBUGGER_H
+#define CHIP_8_DEBUGGER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "chip8.h"
+
+enum class StopReason {
+    FrameDone,
+    Breakpoint,
+    Watchpoint,
+    WaitingForKey,
+};
+
+// Debugger core. A session being debugged runs frames through
+// Debugger::RunFrame, which drives Chip8::RunFrame with a per-instruction
+// hook; the plain RunFrame has none, so an undebugged session pays nothing.
+//
+// PC breakpoints live in a 4096-bit bitmap. On entering a block the debugger
+// checks for a breakpoint there and counts the instructions up to the first
+// jump, call, return, skip or store, stopping short of the next breakpoint
+// bit; until those have run it checks nothing. Block lengths are cached by
+// start address until a store runs or the breakpoints change.
+//
+// Watchpoints are per byte, summarised by per-page flags (64-byte pages).
+// Only Dxyn, Fx33, Fx55, Fx65, F002 and 5xy2/5xy3 touch memory through I;
+// the pages around I are tested against the flags before the opcode is even
+// decoded, and the exact range against the byte bitmap only on a watched
+// page. Execution stops after the access.
+//
+// Conditions are compiled once into predicates, e.g.
+//     V3 == 0x10 && (I >= 0x300 || [0x2F0] != 0)
+// Operands: V0-VF, I, PC, SP, DT, ST, [address], numbers.
+class Debugger {
+public:
+    using Predicate = std::function<bool(const Chip8&)>;
+
+    struct WatchHit {
+        uint16_t address;
+        bool write;
+    };
+
+    // A memory range an instruction accesses through I.
+    struct MemoryAccess {
+        uint16_t address;
+        uint16_t length;
+        bool write;
+    };
+
+    void SetBreakpoint(uint16_t address);
+    // Returns false, leaving breakpoints untouched, if `condition` does not parse.
+    bool SetBreakpoint(uint16_t address, const std::string& condition);
+    void ClearBreakpoint(uint16_t address);
+    bool HasBreakpoint(uint16_t address) const;
+
+    void Watch(uint16_t address, uint16_t length, bool read, bool write);
+    void Unwatch(uint16_t address, uint16_t length);
+
+    // Runs the rest of the current frame (up to `instructions` in total, then
+    // the timer tick). After a stop, calling it again resumes the same frame
+    // and steps over the breakpoint it stopped on.
+    StopReason RunFrame(Chip8& chip8, unsigned int instructions);
+
+    // Executes one instruction without checking breakpoints.
+    StopReason Step(Chip8& chip8);
+
+    const WatchHit& LastWatchHit() const { return last_watch; }
+
+    // True if a breakpoint at `pc` exists and its condition (if any) holds.
+    bool ShouldBreak(const Chip8& chip8, uint16_t pc) const;
+
+    // Instructions executed through this debugger, in total and in the
+    // current frame.
+    uint64_t Executed() const { return executed; }
+    unsigned int InstructionsIntoFrame() const { return executed_in_frame; }
+
+    // Tells the debugger the session was moved to `instructions` into a frame
+    // (e.g. by restoring a checkpoint). The next RunFrame steps over any
+    // breakpoint at the new pc.
+    void Reposition(unsigned int instructions);
+
+    static Predicate Compile(const std::string& condition, bool* ok = nullptr);
+
+    // Returns false for instructions that do not access memory through I.
+    static bool DecodeAccess(const Chip8& chip8, uint16_t pc, MemoryAccess& access);
+
+private:
+    static constexpr unsigned int ADDRESS_SPACE = 4096;
+    static constexpr unsigned int WORDS = ADDRESS_SPACE / 64;
+    static constexpr unsigned int PAGE_SHIFT = 6;
+    // longest access through I: Fx55, Fx65, 5xy2 and 5xy3 of all 16 registers
+    static constexpr uint16_t MAX_ACCESS = 16;
+
+    // Returns how many instructions run from pc before control may leave
+    // the block.
+    unsigned int EnterBlock(const Chip8& chip8, uint16_t pc);
+    void ForgetBlocks();
+    bool CheckWatch(const Chip8& chip8, uint16_t pc);
+    void UpdatePages();
+    bool Hit(const uint64_t* bitmap, uint64_t pages, uint16_t address, uint16_t length, bool write);
+    void ResetBlock() {
+        block_left = 0;
+        ForgetBlocks();
+    }
+
+    uint64_t breakpoints[WORDS]{};
+    std::unordered_map<uint16_t, Predicate> conditions;
+
+    uint64_t watch_read[WORDS]{};
+    uint64_t watch_write[WORDS]{};
+    uint64_t read_pages{};
+    uint64_t write_pages{};
+    WatchHit last_watch{};
+
+    // instructions left in the current block
+    unsigned int block_left{};
+    // block_length[pc] is current while block_epoch[pc] == epoch
+    uint8_t block_length[ADDRESS_SPACE]{};
+    uint32_t block_epoch[ADDRESS_SPACE]{};
+    uint32_t epoch{1};
+    // the block just entered ends in a store
+    bool code_written{};
+
+    uint64_t executed{};
+    unsigned int executed_in_frame{};
+    bool resuming{};
+};
+
+#endif //CHIP_8_DEBUGGER_H
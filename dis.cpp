@@ -0,0 +1,104 @@
+// chip8_dis: disassembles ROMs into control-flow graphs.
+//
+// Each ROM is analysed on its own (see disassembler.h), so a corpus is
+// spread over worker threads one ROM at a time. Output is JSON, one object
+// per line, or Graphviz DOT. Without -out everything goes to stdout in
+// argument order; with -out each ROM gets <out>/<name>.json or .dot, where
+// <name> is the file name for a ROM given directly and the path below the
+// directory for one found by searching a directory, which is recursive.
+//
+// usage: chip8_dis [-format json|dot] [-threads T] [-out DIR] <rom or directory>...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "disassembler.h"
+#include "rom_batch.h"
+
+namespace {
+
+struct Result {
+    std::string text;
+    std::size_t blocks{};
+    bool ok{};
+};
+
+}
+
+int main(int argc, char** argv) {
+    bool dot = false;
+    bool usage = false;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::filesystem::path out;
+    std::vector<RomFile> roms;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-format" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            dot = format == "dot";
+            usage |= !dot && format != "json";
+        } else if (arg == "-threads" && i + 1 < argc) {
+            uint64_t value = 0;
+            usage |= !ParseUnsigned(argv[++i], MAX_THREADS, value);
+            threads = std::max(1u, static_cast<unsigned int>(value));
+        } else if (arg == "-out" && i + 1 < argc) {
+            out = argv[++i];
+        } else {
+            CollectRoms(argv[i], roms);
+        }
+    }
+    if (usage || roms.empty()) {
+        std::fprintf(stderr, "usage: %s [-format json|dot] [-threads T] [-out DIR] <rom or directory>...\n", argv[0]);
+        return 2;
+    }
+    const char* extension = dot ? ".dot" : ".json";
+    if (!out.empty() && !UniqueNames(roms, extension)) {
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Result> results(roms.size());
+    ForEachRom(roms.size(), threads, [&](std::size_t i) {
+        std::ifstream file(roms[i].path, std::ios::binary);
+        if (!file) {
+            return;
+        }
+        std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        ControlFlowGraph cfg = BuildCfg(rom.data(), rom.size());
+
+        Result& result = results[i];
+        const std::string name = roms[i].path.string();
+        result.text = dot ? CfgToDot(cfg, name) : CfgToJson(cfg, name);
+        result.blocks = cfg.blocks.size();
+        result.ok = true;
+        if (!out.empty()) {
+            const std::filesystem::path file_out = out / (roms[i].name.string() + extension);
+            std::error_code error;
+            std::filesystem::create_directories(file_out.parent_path(), error);
+            std::ofstream(file_out) << result.text;
+            result.text.clear();
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t failed = 0;
+    std::size_t blocks = 0;
+    for (std::size_t i = 0; i < roms.size(); ++i) {
+        if (!results[i].ok) {
+            std::fprintf(stderr, "cannot open %s\n", roms[i].path.string().c_str());
+            ++failed;
+            continue;
+        }
+        blocks += results[i].blocks;
+        std::fwrite(results[i].text.data(), 1, results[i].text.size(), stdout);
+    }
+    std::fprintf(stderr, "%zu ROMs, %zu blocks in %.3f s\n", roms.size() - failed, blocks, seconds);
+    return failed ? 1 : 0;
+}
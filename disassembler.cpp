@@ -0,0 +1,436 @@
+#include "disassembler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+#include "chip8.h"
+
+namespace {
+
+constexpr std::size_t MEMORY_SIZE = 4096;
+
+enum class Flow {
+    Next,
+    Jump,
+    Call,
+    Return,
+    Skip,
+    Indirect,
+    Invalid,
+};
+
+// mirrors the decode in Chip8::Cycle
+Flow Classify(uint16_t opcode) {
+    switch (opcode >> 12u) {
+        case 0x0:
+            return opcode == 0x00E0 ? Flow::Next : opcode == 0x00EE ? Flow::Return : Flow::Invalid;
+        case 0x1:
+            return Flow::Jump;
+        case 0x2:
+            return Flow::Call;
+        case 0x3:
+        case 0x4:
+            return Flow::Skip;
+        case 0x5: {
+            const unsigned int n = opcode & 0xFu;
+            return n == 0x0 ? Flow::Skip : n == 0x2 || n == 0x3 ? Flow::Next : Flow::Invalid;
+        }
+        case 0x9:
+            return opcode & 0xFu ? Flow::Invalid : Flow::Skip;
+        case 0x8: {
+            const unsigned int n = opcode & 0xFu;
+            return n <= 0x7 || n == 0xE ? Flow::Next : Flow::Invalid;
+        }
+        case 0xB:
+            return Flow::Indirect;
+        case 0xE: {
+            const unsigned int kk = opcode & 0xFFu;
+            return kk == 0x9E || kk == 0xA1 ? Flow::Skip : Flow::Invalid;
+        }
+        case 0xF:
+            switch (opcode & 0xFFu) {
+                case 0x02:
+                    return opcode == 0xF002 ? Flow::Next : Flow::Invalid;
+                case 0x07:
+                case 0x0A:
+                case 0x15:
+                case 0x18:
+                case 0x1E:
+                case 0x29:
+                case 0x33:
+                case 0x3A:
+                case 0x55:
+                case 0x65:
+                    return Flow::Next;
+                default:
+                    return Flow::Invalid;
+            }
+        default:
+            return Flow::Next;
+    }
+}
+
+// an instruction needs both of its bytes below the top of memory
+bool Fits(unsigned int address) {
+    return address + 1 < MEMORY_SIZE;
+}
+
+const char* EdgeName(EdgeKind kind) {
+    switch (kind) {
+        case EdgeKind::Fallthrough: return "fallthrough";
+        case EdgeKind::Jump: return "jump";
+        case EdgeKind::Call: return "call";
+        case EdgeKind::Return: return "return";
+        case EdgeKind::SkipTaken: return "skip_taken";
+        case EdgeKind::SkipNotTaken: return "skip_not_taken";
+    }
+    return "";
+}
+
+const char* TerminatorName(Terminator terminator) {
+    switch (terminator) {
+        case Terminator::Fallthrough: return "fallthrough";
+        case Terminator::Jump: return "jump";
+        case Terminator::Call: return "call";
+        case Terminator::Return: return "return";
+        case Terminator::Skip: return "skip";
+        case Terminator::Indirect: return "indirect";
+        case Terminator::Invalid: return "invalid";
+        case Terminator::End: return "end";
+    }
+    return "";
+}
+
+std::string Format(const char* format, unsigned int a, unsigned int b = 0, unsigned int c = 0) {
+    char text[32];
+    std::snprintf(text, sizeof(text), format, a, b, c);
+    return text;
+}
+
+// escapes for both JSON and DOT strings
+std::string Quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            quoted += '\\';
+            quoted += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            quoted += Format("\\u%04x", static_cast<unsigned char>(ch));
+        } else {
+            quoted += ch;
+        }
+    }
+    return quoted + "\"";
+}
+
+}
+
+std::size_t ControlFlowGraph::UnclassifiedBytes() const {
+    std::vector<bool> classified(MEMORY_SIZE);
+    for (const BasicBlock& block : blocks) {
+        for (unsigned int a = block.start; a < block.end; ++a) {
+            classified[a & 0xFFFu] = true;
+        }
+    }
+    for (const DataRegion& region : data) {
+        for (unsigned int a = region.address; a < region.address + region.length; ++a) {
+            classified[a & 0xFFFu] = true;
+        }
+    }
+    return static_cast<std::size_t>(
+        std::count(classified.begin() + START_ADDRESS, classified.begin() + rom_end, false));
+}
+
+ControlFlowGraph BuildCfg(const uint8_t* rom, std::size_t size) {
+    ControlFlowGraph cfg;
+    size = std::min<std::size_t>(size, MEMORY_SIZE - START_ADDRESS);
+    cfg.memory.assign(MEMORY_SIZE, 0);
+    if (size) {
+        std::memcpy(cfg.memory.data() + START_ADDRESS, rom, size);
+    }
+    cfg.rom_end = static_cast<uint16_t>(START_ADDRESS + size);
+
+    // recursive descent: every worklist entry starts a block
+    std::vector<bool> decoded(MEMORY_SIZE);
+    std::vector<bool> leader(MEMORY_SIZE);
+    std::vector<uint16_t> worklist;
+    auto branch_to = [&](unsigned int target) {
+        if (Fits(target) && !leader[target]) {
+            leader[target] = true;
+            worklist.push_back(static_cast<uint16_t>(target));
+        }
+    };
+    branch_to(START_ADDRESS);
+
+    while (!worklist.empty()) {
+        unsigned int pc = worklist.back();
+        worklist.pop_back();
+        while (Fits(pc) && !decoded[pc]) {
+            decoded[pc] = true;
+            const uint16_t opcode = cfg.Opcode(pc);
+            const Flow flow = Classify(opcode);
+            if (flow == Flow::Next) {
+                pc += 2;
+                continue;
+            }
+            if (flow == Flow::Jump || flow == Flow::Call) {
+                branch_to(opcode & 0xFFFu);
+            }
+            if (flow == Flow::Call || flow == Flow::Skip) {
+                branch_to(pc + 2);
+            }
+            if (flow == Flow::Skip) {
+                branch_to(pc + 4);
+            }
+            break;
+        }
+    }
+
+    for (unsigned int start = 0; start < MEMORY_SIZE; ++start) {
+        if (!leader[start] || !decoded[start]) {
+            continue;
+        }
+
+        BasicBlock block{static_cast<uint16_t>(start), 0, Terminator::End, {}};
+        auto edge = [&](unsigned int target, EdgeKind kind) {
+            if (Fits(target) && decoded[target]) {
+                block.successors.push_back({static_cast<uint16_t>(target), kind});
+            }
+        };
+
+        int index = -1; // I while it is known within the block
+        for (unsigned int pc = start;; pc += 2) {
+            if (!Fits(pc)) {
+                block.end = static_cast<uint16_t>(std::min<std::size_t>(pc, MEMORY_SIZE));
+                block.terminator = Terminator::End;
+                break;
+            }
+            if (pc != start && leader[pc]) {
+                block.end = static_cast<uint16_t>(pc);
+                block.terminator = Terminator::Fallthrough;
+                edge(pc, EdgeKind::Fallthrough);
+                break;
+            }
+
+            const uint16_t opcode = cfg.Opcode(pc);
+            const unsigned int x = (opcode >> 8u) & 0xFu;
+            auto reference = [&](unsigned int length, bool sprite) {
+                if (index >= 0 && length) {
+                    cfg.data.push_back({static_cast<uint16_t>(index), static_cast<uint16_t>(length), sprite,
+                                        static_cast<uint16_t>(pc)});
+                }
+            };
+            switch (opcode >> 12u) {
+                case 0xA:
+                    index = opcode & 0xFFFu;
+                    break;
+                case 0xD:
+                    reference(opcode & 0xFu, true);
+                    break;
+                case 0x5:
+                    if ((opcode & 0xFu) == 0x2 || (opcode & 0xFu) == 0x3) {
+                        const unsigned int y = (opcode >> 4u) & 0xFu;
+                        reference((x <= y ? y - x : x - y) + 1, false);
+                    }
+                    break;
+                case 0xF:
+                    switch (opcode & 0xFFu) {
+                        case 0x02: reference(AUDIO_PATTERN_SIZE, false); break;
+                        case 0x1E:
+                        case 0x29: index = -1; break;
+                        case 0x33: reference(3, false); break;
+                        case 0x55:
+                        case 0x65: reference(x + 1, false); break;
+                        default: break;
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            const Flow flow = Classify(opcode);
+            if (flow == Flow::Next) {
+                continue;
+            }
+            block.end = static_cast<uint16_t>(pc + 2);
+            switch (flow) {
+                case Flow::Jump:
+                    block.terminator = Terminator::Jump;
+                    edge(opcode & 0xFFFu, EdgeKind::Jump);
+                    break;
+                case Flow::Call:
+                    block.terminator = Terminator::Call;
+                    edge(opcode & 0xFFFu, EdgeKind::Call);
+                    edge(pc + 2, EdgeKind::Return);
+                    cfg.subroutines.push_back(opcode & 0xFFFu);
+                    break;
+                case Flow::Skip:
+                    block.terminator = Terminator::Skip;
+                    edge(pc + 2, EdgeKind::SkipNotTaken);
+                    edge(pc + 4, EdgeKind::SkipTaken);
+                    break;
+                case Flow::Return:
+                    block.terminator = Terminator::Return;
+                    break;
+                case Flow::Indirect:
+                    block.terminator = Terminator::Indirect;
+                    break;
+                default:
+                    block.terminator = Terminator::Invalid;
+                    break;
+            }
+            break;
+        }
+
+        for (const CfgEdge& successor : block.successors) {
+            if (successor.target == block.start && successor.kind != EdgeKind::Call) {
+                cfg.self_loops.push_back(block.start);
+                break;
+            }
+        }
+        cfg.blocks.push_back(std::move(block));
+    }
+
+    std::sort(cfg.subroutines.begin(), cfg.subroutines.end());
+    cfg.subroutines.erase(std::unique(cfg.subroutines.begin(), cfg.subroutines.end()), cfg.subroutines.end());
+
+    // one entry per distinct region, credited to its first reference
+    auto key = [](const DataRegion& r) { return std::make_tuple(r.address, r.length, !r.sprite, r.referenced_by); };
+    std::sort(cfg.data.begin(), cfg.data.end(), [&](const DataRegion& a, const DataRegion& b) { return key(a) < key(b); });
+    cfg.data.erase(std::unique(cfg.data.begin(), cfg.data.end(),
+                               [](const DataRegion& a, const DataRegion& b) {
+                                   return a.address == b.address && a.length == b.length && a.sprite == b.sprite;
+                               }),
+                   cfg.data.end());
+    return cfg;
+}
+
+std::string Mnemonic(uint16_t opcode) {
+    const unsigned int x = (opcode >> 8u) & 0xFu;
+    const unsigned int y = (opcode >> 4u) & 0xFu;
+    const unsigned int n = opcode & 0xFu;
+    const unsigned int kk = opcode & 0xFFu;
+    const unsigned int nnn = opcode & 0xFFFu;
+
+    if (Classify(opcode) == Flow::Invalid) {
+        return Format("DW 0x%04X", opcode);
+    }
+    switch (opcode >> 12u) {
+        case 0x0: return opcode == 0x00E0 ? "CLS" : "RET";
+        case 0x1: return Format("JP 0x%03X", nnn);
+        case 0x2: return Format("CALL 0x%03X", nnn);
+        case 0x3: return Format("SE V%X, 0x%02X", x, kk);
+        case 0x4: return Format("SNE V%X, 0x%02X", x, kk);
+        case 0x5:
+            if (n == 0x2) return Format("SAVE V%X-V%X", x, y);
+            if (n == 0x3) return Format("LOAD V%X-V%X", x, y);
+            return Format("SE V%X, V%X", x, y);
+        case 0x6: return Format("LD V%X, 0x%02X", x, kk);
+        case 0x7: return Format("ADD V%X, 0x%02X", x, kk);
+        case 0x8: {
+            static const char* const names[16] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+                                                  "", "", "", "", "", "", "SHL", ""};
+            return std::string(names[n]) + Format(" V%X, V%X", x, y);
+        }
+        case 0x9: return Format("SNE V%X, V%X", x, y);
+        case 0xA: return Format("LD I, 0x%03X", nnn);
+        case 0xB: return Format("JP V0, 0x%03X", nnn);
+        case 0xC: return Format("RND V%X, 0x%02X", x, kk);
+        case 0xD: return Format("DRW V%X, V%X, %u", x, y, n);
+        case 0xE: return Format(kk == 0x9E ? "SKP V%X" : "SKNP V%X", x);
+        default: break;
+    }
+    switch (kk) {
+        case 0x02: return "AUDIO";
+        case 0x07: return Format("LD V%X, DT", x);
+        case 0x0A: return Format("LD V%X, K", x);
+        case 0x15: return Format("LD DT, V%X", x);
+        case 0x18: return Format("LD ST, V%X", x);
+        case 0x1E: return Format("ADD I, V%X", x);
+        case 0x29: return Format("LD F, V%X", x);
+        case 0x33: return Format("LD B, V%X", x);
+        case 0x3A: return Format("PITCH V%X", x);
+        case 0x55: return Format("LD [I], V%X", x);
+        default: return Format("LD V%X, [I]", x);
+    }
+}
+
+std::string CfgToJson(const ControlFlowGraph& cfg, const std::string& name) {
+    // one line per ROM, so a corpus run is valid JSON Lines
+    std::string out = "{\"name\":" + Quote(name) + ",\"size\":" + std::to_string(cfg.rom_end - START_ADDRESS) +
+                      ",\"entry\":" + std::to_string(START_ADDRESS) + ",\"blocks\":[";
+    for (std::size_t b = 0; b < cfg.blocks.size(); ++b) {
+        const BasicBlock& block = cfg.blocks[b];
+        out += b ? ",{" : "{";
+        out += "\"start\":" + std::to_string(block.start) + ",\"end\":" + std::to_string(block.end) +
+               ",\"terminator\":\"" + TerminatorName(block.terminator) + "\",\"instructions\":[";
+        for (unsigned int pc = block.start; pc + 1 < block.end; pc += 2) {
+            out += pc != block.start ? "," : "";
+            out += "[" + std::to_string(pc) + ",\"" + Format("%04X", cfg.Opcode(pc)) + "\"," +
+                   Quote(Mnemonic(cfg.Opcode(pc))) + "]";
+        }
+        out += "],\"successors\":[";
+        for (std::size_t e = 0; e < block.successors.size(); ++e) {
+            out += e ? "," : "";
+            out += "{\"target\":" + std::to_string(block.successors[e].target) + ",\"kind\":\"" +
+                   EdgeName(block.successors[e].kind) + "\"}";
+        }
+        out += "]}";
+    }
+    out += "],\"subroutines\":[";
+    for (std::size_t i = 0; i < cfg.subroutines.size(); ++i) {
+        out += (i ? "," : "") + std::to_string(cfg.subroutines[i]);
+    }
+    out += "],\"data\":[";
+    for (std::size_t i = 0; i < cfg.data.size(); ++i) {
+        const DataRegion& region = cfg.data[i];
+        out += i ? ",{" : "{";
+        out += "\"address\":" + std::to_string(region.address) + ",\"length\":" + std::to_string(region.length) +
+               ",\"kind\":\"" + (region.sprite ? "sprite" : "data") + "\",\"referenced_by\":" +
+               std::to_string(region.referenced_by) + "}";
+    }
+    out += "],\"self_loops\":[";
+    for (std::size_t i = 0; i < cfg.self_loops.size(); ++i) {
+        out += (i ? "," : "") + std::to_string(cfg.self_loops[i]);
+    }
+    out += "],\"unclassified_bytes\":" + std::to_string(cfg.UnclassifiedBytes()) + "}\n";
+    return out;
+}
+
+std::string CfgToDot(const ControlFlowGraph& cfg, const std::string& name) {
+    std::string out = "digraph " + Quote(name) + " {\n    node [shape=box, fontname=\"monospace\"];\n";
+    for (const BasicBlock& block : cfg.blocks) {
+        std::string label;
+        for (unsigned int pc = block.start; pc + 1 < block.end; pc += 2) {
+            label += Format("%03X: %04X  ", pc, cfg.Opcode(pc)) + Mnemonic(cfg.Opcode(pc)) + "\\l";
+        }
+        out += "    b" + std::to_string(block.start) + " [label=\"" + label + "\"];\n";
+    }
+    for (const BasicBlock& block : cfg.blocks) {
+        for (const CfgEdge& successor : block.successors) {
+            out += "    b" + std::to_string(block.start) + " -> b" + std::to_string(successor.target) + " [label=\"" +
+                   EdgeName(successor.kind) + "\"";
+            if (successor.kind == EdgeKind::Call) {
+                out += ", style=bold";
+            } else if (successor.kind == EdgeKind::Return) {
+                out += ", style=dashed";
+            }
+            out += "];\n";
+        }
+    }
+
+    // data regions hang off the block that references them
+    for (const DataRegion& region : cfg.data) {
+        const std::string node = "d" + std::to_string(region.address) + "_" + std::to_string(region.length);
+        out += "    " + node + " [shape=note, label=\"" + (region.sprite ? "sprite " : "data ") +
+               Format("0x%03X (%u bytes)", region.address, region.length) + "\"];\n";
+        auto block = std::upper_bound(cfg.blocks.begin(), cfg.blocks.end(), region.referenced_by,
+                                      [](uint16_t address, const BasicBlock& b) { return address < b.start; });
+        if (block != cfg.blocks.begin()) {
+            out += "    b" + std::to_string((block - 1)->start) + " -> " + node + " [style=dotted, arrowhead=none];\n";
+        }
+    }
+    return out + "}\n";
+}
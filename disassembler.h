@@ -0,0 +1,91 @@
+#ifndef CHIP_8_DISASSEMBLER_H
+#define CHIP_8_DISASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Static analysis of a ROM image, with the instruction set of Chip8::Cycle.
+//
+// Code is found by recursive descent from START_ADDRESS, following jumps,
+// calls (assumed to return), both outcomes of skips, and stopping at 00EE,
+// Bnnn and invalid opcodes. Reachable instructions are then cut into basic
+// blocks at every branch target and after every control transfer.
+//
+// Data is recovered from I: within a block, Annn fixes I until Fx1E or Fx29
+// changes it, and a later Dxyn marks n sprite bytes at that address. Fx33,
+// Fx55, Fx65 and F002 mark the bytes they touch as plain data. I is not
+// tracked across blocks.
+enum class EdgeKind : uint8_t {
+    Fallthrough,
+    Jump,
+    Call,
+    // the instruction after a call, reached when the subroutine returns
+    Return,
+    SkipTaken,
+    SkipNotTaken,
+};
+
+enum class Terminator : uint8_t {
+    // the next instruction starts another block
+    Fallthrough,
+    Jump,
+    Call,
+    Return,
+    Skip,
+    // Bnnn: target depends on V0
+    Indirect,
+    Invalid,
+    // the block runs off the end of memory
+    End,
+};
+
+struct CfgEdge {
+    uint16_t target;
+    EdgeKind kind;
+};
+
+struct BasicBlock {
+    uint16_t start;
+    // one past the last instruction byte
+    uint16_t end;
+    Terminator terminator;
+    std::vector<CfgEdge> successors;
+};
+
+struct DataRegion {
+    uint16_t address;
+    uint16_t length;
+    bool sprite;
+    // the instruction that accesses it
+    uint16_t referenced_by;
+};
+
+struct ControlFlowGraph {
+    // the ROM at START_ADDRESS in an otherwise empty address space
+    std::vector<uint8_t> memory;
+    uint16_t rom_end{};
+
+    std::vector<BasicBlock> blocks;     // ordered by start address
+    std::vector<uint16_t> subroutines;  // call targets, ascending
+    std::vector<DataRegion> data;       // ordered by address
+    // blocks with an edge back to themselves: the usual wait and idle loops
+    std::vector<uint16_t> self_loops;
+
+    uint16_t Opcode(uint16_t address) const {
+        return static_cast<uint16_t>((memory[address & 0xFFFu] << 8u) | memory[(address + 1u) & 0xFFFu]);
+    }
+    // ROM bytes decoded as neither code nor data
+    std::size_t UnclassifiedBytes() const;
+};
+
+ControlFlowGraph BuildCfg(const uint8_t* rom, std::size_t size);
+
+// e.g. "LD V3, 0x10", "DRW V0, V1, 5"; "DW 0x0123" for invalid opcodes
+std::string Mnemonic(uint16_t opcode);
+
+std::string CfgToJson(const ControlFlowGraph& cfg, const std::string& name);
+std::string CfgToDot(const ControlFlowGraph& cfg, const std::string& name);
+
+#endif //CHIP_8_DISASSEMBLER_H
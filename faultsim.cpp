@@ -0,0 +1,254 @@
+// chip8_faultsim: bit-parallel stuck-at fault simulation of chip8.circ.
+//
+// Every fault site of the lane-sliced model (register output bits, controlled
+// buffer enables and demultiplexer select bits) is stuck at 0 and at 1, giving
+// two faults per site. Faults are packed 64 to a group, one per lane, so a
+// single Clock() of Chip8CircuitLanes simulates 64 faulty circuits at once,
+// and groups are shared out among worker threads.
+//
+// Each ROM is first run on the fault-free HardwareModel to record the input
+// pins and the expected observations of every cycle. Groups then replay that
+// stimulus open loop: branches stay those of the fault-free run. A fault is
+// detected when an output pin, V0-V15 or I_reg differs from the recording,
+// and a group stops as soon as all of its lanes are detected. Detection
+// accumulates over the ROMs given.
+//
+// usage: chip8_faultsim [-cycles N] [-threads T] [-v] <rom>...
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chip8_circuit_lanes.h"
+#include "hardware.h"
+
+namespace {
+
+constexpr std::size_t LANES = 64;
+constexpr std::size_t FAULT_COUNT = Chip8CircuitLanes::FAULT_SITE_COUNT * 2;
+constexpr std::size_t GROUP_COUNT = (FAULT_COUNT + LANES - 1) / LANES;
+constexpr std::size_t OBSERVED_REGISTERS = 17;
+
+// fault f is site f / 2 stuck at f % 2
+struct Fault {
+    std::size_t site;
+    bool stuck_at_one;
+};
+
+Fault FaultAt(std::size_t fault) {
+    return {fault / 2, (fault & 1u) != 0};
+}
+
+// stimulus and fault-free observations of one ROM, cycle by cycle; entry 0
+// of the observations is the state right after reset
+struct Trace {
+    std::size_t cycles{};
+    std::vector<uint64_t> inputs;       // INPUT_COUNT per cycle
+    std::vector<uint64_t> observations; // OUTPUT_COUNT + OBSERVED_REGISTERS per cycle, plus reset
+};
+
+constexpr std::size_t OBSERVATIONS = Chip8Circuit::OUTPUT_COUNT + OBSERVED_REGISTERS;
+
+class Observer {
+public:
+    Observer() {
+        for (std::size_t i = 0; i < 16; ++i) {
+            registers[i] = FindState("V" + std::to_string(i));
+        }
+        registers[16] = FindState("I_reg");
+    }
+
+    void Record(const Chip8Circuit& circuit, uint64_t* observation) const {
+        for (std::size_t i = 0; i < Chip8Circuit::OUTPUT_COUNT; ++i) {
+            observation[i] = circuit.out[i];
+        }
+        for (std::size_t i = 0; i < OBSERVED_REGISTERS; ++i) {
+            observation[Chip8Circuit::OUTPUT_COUNT + i] = circuit.state[registers[i]];
+        }
+    }
+
+    // lanes whose observations differ from the fault-free ones
+    uint64_t Mismatches(const Chip8CircuitLanes& circuit, const uint64_t* observation) const {
+        uint64_t mismatches = 0;
+        for (std::size_t i = 0; i < Chip8Circuit::OUTPUT_COUNT; ++i) {
+            const uint64_t* bits = circuit.out + Chip8CircuitLanes::OUTPUT_OFFSET[i];
+            for (std::size_t b = 0; b < Chip8CircuitLanes::OUTPUTS[i].width; ++b) {
+                mismatches |= bits[b] ^ (0 - ((observation[i] >> b) & 1u));
+            }
+        }
+        for (std::size_t i = 0; i < OBSERVED_REGISTERS; ++i) {
+            const uint64_t* bits = circuit.state + Chip8CircuitLanes::STATE_OFFSET[registers[i]];
+            uint64_t expected = observation[Chip8Circuit::OUTPUT_COUNT + i];
+            for (std::size_t b = 0; b < Chip8CircuitLanes::STATES[registers[i]].width; ++b) {
+                mismatches |= bits[b] ^ (0 - ((expected >> b) & 1u));
+            }
+        }
+        return mismatches;
+    }
+
+private:
+    std::size_t registers[OBSERVED_REGISTERS]{};
+};
+
+bool RecordTrace(const char* rom, uint64_t cycles, const Observer& observer, Trace& trace) {
+    HardwareModel model;
+    if (!model.LoadROM(rom)) {
+        return false;
+    }
+    trace.cycles = cycles;
+    trace.inputs.resize(cycles * Chip8Circuit::INPUT_COUNT);
+    trace.observations.resize((cycles + 1) * OBSERVATIONS);
+    observer.Record(model.Circuit(), trace.observations.data());
+    for (uint64_t i = 0; i < cycles; ++i) {
+        model.Step();
+        std::memcpy(&trace.inputs[i * Chip8Circuit::INPUT_COUNT], model.Circuit().in, sizeof(model.Circuit().in));
+        observer.Record(model.Circuit(), &trace.observations[(i + 1) * OBSERVATIONS]);
+    }
+    return true;
+}
+
+// replays the trace with the group's undetected faults injected and returns
+// the lanes that were detected
+uint64_t SimulateGroup(Chip8CircuitLanes& circuit, const Trace& trace, const Observer& observer, std::size_t group,
+                       uint64_t pending) {
+    circuit.ClearFaults();
+    for (std::size_t lane = 0; lane < LANES; ++lane) {
+        if ((pending >> lane) & 1u) {
+            Fault fault = FaultAt(group * LANES + lane);
+            if (fault.stuck_at_one) {
+                circuit.force[fault.site] |= uint64_t{1} << lane;
+            } else {
+                circuit.keep[fault.site] &= ~(uint64_t{1} << lane);
+            }
+        }
+    }
+
+    std::fill(std::begin(circuit.in), std::end(circuit.in), 0);
+    circuit.Reset();
+    uint64_t detected = observer.Mismatches(circuit, trace.observations.data()) & pending;
+    for (std::size_t i = 0; i < trace.cycles && detected != pending; ++i) {
+        std::memcpy(circuit.in, &trace.inputs[i * Chip8Circuit::INPUT_COUNT], sizeof(circuit.in));
+        circuit.Clock();
+        detected |= observer.Mismatches(circuit, &trace.observations[(i + 1) * OBSERVATIONS]) & pending;
+    }
+    return detected;
+}
+
+// lanes of a group that hold a fault
+uint64_t GroupLanes(std::size_t group) {
+    std::size_t count = std::min(LANES, FAULT_COUNT - group * LANES);
+    return count == LANES ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+}
+
+}
+
+int main(int argc, char** argv) {
+    static_assert(std::size_t{Chip8CircuitLanes::INPUT_COUNT} == std::size_t{Chip8Circuit::INPUT_COUNT},
+                  "models disagree on the input pins");
+
+    uint64_t cycles = 100000;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool verbose = false;
+    std::vector<const char*> roms;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-cycles" && i + 1 < argc) {
+            cycles = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            threads = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 0)));
+        } else if (arg == "-v") {
+            verbose = true;
+        } else {
+            roms.push_back(argv[i]);
+        }
+    }
+    if (roms.empty()) {
+        std::fprintf(stderr, "usage: %s [-cycles N] [-threads T] [-v] <rom>...\n", argv[0]);
+        return 2;
+    }
+
+    Observer observer;
+    std::vector<uint64_t> detected(GROUP_COUNT, 0);
+    std::printf("%zu fault sites, %zu stuck-at faults in %zu groups of %zu, %u threads\n",
+                Chip8CircuitLanes::FAULT_SITE_COUNT, FAULT_COUNT, GROUP_COUNT, LANES, threads);
+
+    for (const char* rom: roms) {
+        Trace trace;
+        if (!RecordTrace(rom, cycles, observer, trace)) {
+            std::fprintf(stderr, "cannot open %s\n", rom);
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::atomic<std::size_t> next_group{0};
+        std::atomic<uint64_t> newly_detected{0};
+        auto worker = [&]() {
+            // the lane model is a few tens of kilobytes, too much for the stack
+            auto circuit = std::make_unique<Chip8CircuitLanes>();
+            for (std::size_t group = next_group++; group < GROUP_COUNT; group = next_group++) {
+                uint64_t pending = GroupLanes(group) & ~detected[group];
+                if (!pending) {
+                    continue;
+                }
+                uint64_t found = SimulateGroup(*circuit, trace, observer, group, pending);
+                detected[group] |= found;
+                newly_detected += static_cast<uint64_t>(__builtin_popcountll(found));
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned int i = 1; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& thread: pool) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::printf("%s: %llu cycles, %llu new faults detected in %.3f s\n", rom,
+                    static_cast<unsigned long long>(cycles), static_cast<unsigned long long>(newly_detected.load()),
+                    seconds);
+    }
+
+    // coverage per kind of fault site
+    std::vector<std::string> kinds;
+    std::vector<std::size_t> totals;
+    std::vector<std::size_t> hits;
+    std::size_t total_hits = 0;
+    for (std::size_t fault = 0; fault < FAULT_COUNT; ++fault) {
+        std::string kind = Chip8CircuitLanes::FAULT_SITES[FaultAt(fault).site].kind;
+        std::size_t k = std::find(kinds.begin(), kinds.end(), kind) - kinds.begin();
+        if (k == kinds.size()) {
+            kinds.push_back(kind);
+            totals.push_back(0);
+            hits.push_back(0);
+        }
+        bool hit = (detected[fault / LANES] >> (fault % LANES)) & 1u;
+        ++totals[k];
+        hits[k] += hit;
+        total_hits += hit;
+    }
+
+    std::printf("fault coverage %zu/%zu (%.2f%%)\n", total_hits, FAULT_COUNT, 100.0 * total_hits / FAULT_COUNT);
+    for (std::size_t k = 0; k < kinds.size(); ++k) {
+        std::printf("  %-8s %5zu/%-5zu (%.2f%%)\n", kinds[k].c_str(), hits[k], totals[k], 100.0 * hits[k] / totals[k]);
+    }
+    if (verbose) {
+        std::printf("undetected:\n");
+        for (std::size_t fault = 0; fault < FAULT_COUNT; ++fault) {
+            if (!((detected[fault / LANES] >> (fault % LANES)) & 1u)) {
+                const CircuitFaultSite& site = Chip8CircuitLanes::FAULT_SITES[FaultAt(fault).site];
+                std::printf("  %s %s %u stuck-at-%d\n", site.component, site.kind, static_cast<unsigned int>(site.bit),
+                            FaultAt(fault).stuck_at_one ? 1 : 0);
+            }
+        }
+    }
+    return 0;
+}
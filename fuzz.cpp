@@ -0,0 +1,497 @@
+// chip8_fuzz: coverage-guided in-process fuzzer for ROM images and key input.
+//
+// Guest coverage is the (previous pc, pc) edge of every executed instruction
+// hashed into a bitmap. Host coverage comes from chip8.cpp being built with
+// -fsanitize-coverage=trace-pc, which calls back into this file for every
+// basic block the interpreter runs. Inputs that light up a new edge, or reach
+// an edge in a new hit-count bucket, join the corpus; the latter only at a
+// limited rate, so a loop counter cannot flood it. Between executions the
+// instance is reset by restoring a pristine snapshot.
+//
+// An execution runs for at most -frames frames and ends early once a frame
+// reaches no edge it had not already taken and no key event is left to come.
+//
+// Findings are inputs that raise a Chip8 fault flag: invalid opcode, stack
+// overflow or underflow, or an I-relative access running past memory. Each is
+// printed and, with -out, written next to the corpus.
+//
+// usage: chip8_fuzz [-runs N] [-time SECONDS] [-seed N] [-frames N] [-out DIR] [corpus files or directories...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "chip8.h"
+
+namespace {
+
+constexpr std::size_t EDGE_MAP_SIZE = 1 << 16;
+constexpr std::size_t HOST_MAP_SIZE = 1 << 16;
+constexpr unsigned int DEFAULT_FRAMES_PER_EXEC = 4;
+constexpr unsigned int MAX_FRAMES_PER_EXEC = 3600;
+constexpr unsigned int INSTRUCTIONS_PER_FRAME = 32;
+constexpr std::size_t MAX_ROM_SIZE = 4096 - START_ADDRESS;
+constexpr std::size_t MAX_KEYS = 32;
+constexpr unsigned int MAX_STACKED_MUTATIONS = 4;
+constexpr uint64_t CORPUS_CREDIT_PERIOD = 1024;
+constexpr uint64_t MAX_CORPUS_CREDIT = 64;
+
+struct KeyInput {
+    uint16_t frame;
+    uint8_t key;
+    bool pressed;
+};
+
+struct FuzzInput {
+    std::vector<uint8_t> rom;
+    std::vector<KeyInput> keys; // ordered by frame
+};
+
+enum class Novelty { NONE, BUCKET, EDGE };
+
+struct Coverage {
+    uint8_t trace[EDGE_MAP_SIZE]{};
+    uint8_t virgin[EDGE_MAP_SIZE]{};
+    std::vector<uint32_t> touched;
+    std::size_t covered{};
+
+    void Hit(uint32_t slot) {
+        if (trace[slot] == 0) {
+            touched.push_back(slot);
+        }
+        // saturate: wrapping back to zero would list the slot twice
+        trace[slot] += trace[slot] != 0xFF;
+    }
+
+    // Folds this execution's trace into the global map and clears it.
+    Novelty Merge() {
+        Novelty fresh = Novelty::NONE;
+        for (uint32_t slot : touched) {
+            const uint8_t bucket = Bucket(trace[slot]);
+            if (!(virgin[slot] & bucket)) {
+                fresh = std::max(fresh, virgin[slot] == 0 ? Novelty::EDGE : Novelty::BUCKET);
+                covered += virgin[slot] == 0;
+                virgin[slot] |= bucket;
+            }
+            trace[slot] = 0;
+        }
+        touched.clear();
+        return fresh;
+    }
+
+    // Marks this execution's edges in `seen`, ignoring hit counts; true if
+    // any of them was not there yet. Call before Merge, which clears the trace.
+    bool MarkEdges(std::vector<bool>& seen) const {
+        seen.resize(EDGE_MAP_SIZE);
+        bool fresh = false;
+        for (uint32_t slot : touched) {
+            fresh |= !seen[slot];
+            seen[slot] = true;
+        }
+        return fresh;
+    }
+
+    // AFL-style hit-count classes, so loops that run a different number of
+    // times count as new behaviour without every count being distinct
+    static uint8_t Bucket(uint8_t count) {
+        if (count <= 3) return static_cast<uint8_t>(1u << (count - 1));
+        if (count <= 7) return 0x08;
+        if (count <= 15) return 0x10;
+        if (count <= 31) return 0x20;
+        if (count <= 127) return 0x40;
+        return 0x80;
+    }
+};
+
+Coverage guest;
+Coverage host;
+
+struct Rng {
+    CounterRng state;
+
+    uint64_t Next() { return CounterRng::mix(state.key + state.counter++ * CounterRng::GOLDEN_GAMMA); }
+    uint32_t Below(uint32_t bound) { return bound ? static_cast<uint32_t>(Next() % bound) : 0; }
+};
+
+}
+
+#ifdef CHIP8_HOST_COVERAGE
+extern "C" void __sanitizer_cov_trace_pc() {
+    const auto pc = reinterpret_cast<uintptr_t>(__builtin_return_address(0));
+    host.Hit(static_cast<uint32_t>((pc ^ (pc >> 16)) & (HOST_MAP_SIZE - 1)));
+}
+#endif
+
+namespace {
+
+struct ExecResult {
+    uint8_t faults;
+    uint16_t fault_pc;
+};
+
+// Runs one input and leaves its edges in the guest and host traces.
+ExecResult Execute(Chip8& chip8, const Chip8& pristine, const FuzzInput& input, unsigned int frames) {
+    chip8.Restore(pristine);
+    chip8.LoadROM(input.rom.data(), input.rom.size());
+
+    ExecResult result{};
+    uint16_t previous = START_ADDRESS;
+    std::size_t next_key = 0;
+    std::size_t edges = 0;
+
+    for (unsigned int frame = 0; frame < frames && !result.faults; ++frame) {
+        for (; next_key < input.keys.size() && input.keys[next_key].frame <= frame; ++next_key) {
+            chip8.SetKey(input.keys[next_key].key, input.keys[next_key].pressed);
+        }
+
+        for (unsigned int i = 0; i < INSTRUCTIONS_PER_FRAME && !chip8.WaitingForKey(); ++i) {
+            const uint16_t pc = chip8.ProgramCounter();
+            guest.Hit(((previous * 0x9E3779B1u) ^ pc) & (EDGE_MAP_SIZE - 1));
+            previous = pc;
+
+            chip8.Cycle();
+            if (chip8.Faults()) {
+                result.faults = chip8.Faults();
+                result.fault_pc = pc;
+                break;
+            }
+        }
+        chip8.AdvanceTimers(1);
+
+        // with no key event left to change its course, a frame that reaches
+        // no edge this run has not already taken means the guest is spinning
+        // in a loop, and a key wait will never end
+        const std::size_t reached = guest.touched.size() + host.touched.size();
+        if (next_key == input.keys.size() && (reached == edges || chip8.WaitingForKey())) {
+            break;
+        }
+        edges = reached;
+    }
+    return result;
+}
+
+uint16_t RandomOpcode(Rng& rng) {
+    // bias towards instructions the core implements so mutations get past
+    // the first invalid-opcode fault
+    static constexpr uint16_t TEMPLATES[][2] = {
+        {0x00E0, 0x0000}, {0x00EE, 0x0000}, {0x1000, 0x0FFF}, {0x2000, 0x0FFF}, {0x3000, 0x0FFF},
+        {0x4000, 0x0FFF}, {0x5000, 0x0FF0}, {0x5002, 0x0FF1}, {0x6000, 0x0FFF}, {0x7000, 0x0FFF},
+        {0x8000, 0x0FF7}, {0x800E, 0x0FF0}, {0x9000, 0x0FF0}, {0xA000, 0x0FFF}, {0xB000, 0x0FFF},
+        {0xC000, 0x0FFF}, {0xD000, 0x0FFF}, {0xE09E, 0x0F00}, {0xE0A1, 0x0F00}, {0xF007, 0x0F00},
+        {0xF00A, 0x0F00}, {0xF015, 0x0F00}, {0xF018, 0x0F00}, {0xF01E, 0x0F00}, {0xF029, 0x0F00},
+        {0xF033, 0x0F00}, {0xF055, 0x0F00}, {0xF065, 0x0F00}, {0xF002, 0x0000}, {0xF03A, 0x0F00},
+    };
+    const auto& entry = TEMPLATES[rng.Below(std::size(TEMPLATES))];
+    return entry[0] | (static_cast<uint16_t>(rng.Next()) & entry[1]);
+}
+
+void Mutate(FuzzInput& input, const std::vector<FuzzInput>& corpus, unsigned int frames, Rng& rng) {
+    std::vector<uint8_t>& rom = input.rom;
+    const unsigned int count = 1 + rng.Below(MAX_STACKED_MUTATIONS);
+
+    for (unsigned int n = 0; n < count; ++n) {
+        const uint32_t even = rom.size() >= 2 ? rng.Below(static_cast<uint32_t>(rom.size() / 2)) * 2 : 0;
+
+        switch (rng.Below(10)) {
+            case 0:
+                if (!rom.empty()) {
+                    rom[rng.Below(static_cast<uint32_t>(rom.size()))] ^= 1u << rng.Below(8);
+                }
+                break;
+            case 1:
+                if (!rom.empty()) {
+                    rom[rng.Below(static_cast<uint32_t>(rom.size()))] = static_cast<uint8_t>(rng.Next());
+                }
+                break;
+            case 2:
+                if (rom.size() >= 2) {
+                    const uint16_t op = RandomOpcode(rng);
+                    rom[even] = op >> 8;
+                    rom[even + 1] = op & 0xFF;
+                }
+                break;
+            case 3:
+                if (rom.size() + 2 <= MAX_ROM_SIZE) {
+                    const uint16_t op = RandomOpcode(rng);
+                    rom.insert(rom.begin() + even, {static_cast<uint8_t>(op >> 8), static_cast<uint8_t>(op & 0xFF)});
+                }
+                break;
+            case 4:
+                if (rom.size() > 2) {
+                    rom.erase(rom.begin() + even, rom.begin() + even + 2);
+                }
+                break;
+            case 5:
+                if (rom.size() >= 4) {
+                    const uint32_t from = rng.Below(static_cast<uint32_t>(rom.size()));
+                    const uint32_t to = rng.Below(static_cast<uint32_t>(rom.size()));
+                    const uint32_t length = 1 + rng.Below(static_cast<uint32_t>(rom.size() - std::max(from, to)));
+                    std::memmove(&rom[to], &rom[from], length);
+                }
+                break;
+            case 6: {
+                // splice: our head, another entry's tail
+                const FuzzInput& other = corpus[rng.Below(static_cast<uint32_t>(corpus.size()))];
+                if (!other.rom.empty()) {
+                    const uint32_t cut = rng.Below(static_cast<uint32_t>(std::min(rom.size(), other.rom.size())) + 1);
+                    rom.resize(cut);
+                    rom.insert(rom.end(), other.rom.begin() + cut, other.rom.end());
+                }
+                break;
+            }
+            case 7:
+                if (input.keys.size() < MAX_KEYS) {
+                    const KeyInput key{static_cast<uint16_t>(rng.Below(frames)),
+                                       static_cast<uint8_t>(rng.Below(16)), rng.Below(2) == 0};
+                    auto at = input.keys.begin();
+                    while (at != input.keys.end() && at->frame <= key.frame) {
+                        ++at;
+                    }
+                    input.keys.insert(at, key);
+                }
+                break;
+            case 8:
+                if (!input.keys.empty()) {
+                    input.keys.erase(input.keys.begin() + rng.Below(static_cast<uint32_t>(input.keys.size())));
+                }
+                break;
+            default:
+                if (!input.keys.empty()) {
+                    input.keys[rng.Below(static_cast<uint32_t>(input.keys.size()))].key = rng.Below(16);
+                }
+                break;
+        }
+    }
+}
+
+// File format: "C8FZ", u16 rom size, rom, u8 key count, then per key
+// u16 frame, u8 key, u8 pressed; little endian. Any other file is a raw ROM.
+std::vector<uint8_t> Serialize(const FuzzInput& input) {
+    std::vector<uint8_t> out{'C', '8', 'F', 'Z'};
+    out.push_back(input.rom.size() & 0xFF);
+    out.push_back(input.rom.size() >> 8);
+    out.insert(out.end(), input.rom.begin(), input.rom.end());
+    out.push_back(static_cast<uint8_t>(input.keys.size()));
+    for (const KeyInput& key : input.keys) {
+        out.insert(out.end(), {static_cast<uint8_t>(key.frame & 0xFF), static_cast<uint8_t>(key.frame >> 8), key.key,
+                               static_cast<uint8_t>(key.pressed)});
+    }
+    return out;
+}
+
+bool Deserialize(const std::vector<uint8_t>& data, FuzzInput& input) {
+    if (data.size() < 4 || std::memcmp(data.data(), "C8FZ", 4) != 0) {
+        input.rom.assign(data.begin(), data.begin() + std::min(data.size(), MAX_ROM_SIZE));
+        input.keys.clear();
+        return true;
+    }
+
+    std::size_t pos = 4;
+    if (pos + 2 > data.size()) {
+        return false;
+    }
+    const std::size_t rom_size = data[pos] | (data[pos + 1] << 8);
+    pos += 2;
+    if (rom_size > MAX_ROM_SIZE || pos + rom_size + 1 > data.size()) {
+        return false;
+    }
+    input.rom.assign(data.begin() + pos, data.begin() + pos + rom_size);
+    pos += rom_size;
+
+    const std::size_t key_count = data[pos++];
+    if (pos + key_count * 4 > data.size()) {
+        return false;
+    }
+    input.keys.clear();
+    for (std::size_t i = 0; i < key_count; ++i, pos += 4) {
+        input.keys.push_back({static_cast<uint16_t>(data[pos] | (data[pos + 1] << 8)), static_cast<uint8_t>(data[pos + 2] & 0xF),
+                              data[pos + 3] != 0});
+    }
+    return true;
+}
+
+void WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data) {
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+void LoadCorpus(const std::filesystem::path& path, std::vector<FuzzInput>& corpus) {
+    if (std::filesystem::is_directory(path)) {
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            if (entry.is_regular_file()) {
+                LoadCorpus(entry.path(), corpus);
+            }
+        }
+        return;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    FuzzInput input;
+    if (Deserialize(data, input) && !input.rom.empty()) {
+        corpus.push_back(std::move(input));
+    }
+}
+
+std::string FaultName(uint8_t faults) {
+    std::string name;
+    if (faults & Chip8::FAULT_INVALID_OPCODE) name += "invalid-opcode+";
+    if (faults & Chip8::FAULT_STACK_OVERFLOW) name += "stack-overflow+";
+    if (faults & Chip8::FAULT_STACK_UNDERFLOW) name += "stack-underflow+";
+    if (faults & Chip8::FAULT_INDEX_RANGE) name += "index-range+";
+    name.pop_back();
+    return name;
+}
+
+}
+
+int main(int argc, char** argv) {
+    uint64_t runs = 0;
+    double seconds = 0;
+    uint64_t seed = 1;
+    unsigned int frames = DEFAULT_FRAMES_PER_EXEC;
+    std::filesystem::path out;
+    std::vector<FuzzInput> corpus;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-runs" && i + 1 < argc) {
+            runs = std::stoull(argv[++i]);
+        } else if (arg == "-time" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else if (arg == "-seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "-frames" && i + 1 < argc) {
+            frames = static_cast<unsigned int>(std::clamp(std::stoul(argv[++i]), 1ul, static_cast<unsigned long>(MAX_FRAMES_PER_EXEC)));
+        } else if (arg == "-out" && i + 1 < argc) {
+            out = argv[++i];
+            std::filesystem::create_directories(out);
+        } else {
+            LoadCorpus(arg, corpus);
+        }
+    }
+    if (runs == 0 && seconds == 0) {
+        runs = 1000000;
+    }
+
+    Rng rng{{CounterRng::key_for(seed, 0), 0}};
+    if (corpus.empty()) {
+        FuzzInput input;
+        for (int i = 0; i < 16; ++i) {
+            const uint16_t op = RandomOpcode(rng);
+            input.rom.push_back(op >> 8);
+            input.rom.push_back(op & 0xFF);
+        }
+        corpus.push_back(std::move(input));
+    }
+
+    const Chip8 pristine(seed, 0);
+    Chip8 chip8 = pristine;
+
+    // per fault kind, every interpreter block some finding of that kind ran
+    std::map<uint8_t, std::vector<bool>> finding_blocks;
+    std::set<std::pair<uint8_t, uint16_t>> finding_sites;
+    std::size_t findings = 0;
+    const std::size_t seeds = corpus.size();
+    uint64_t credit = 0;
+
+    // Runs an input and keeps it as a finding or a corpus entry if it
+    // earns a place; `mutated` is false for the inputs given on the command
+    // line, which are in the corpus already.
+    const auto evaluate = [&](const FuzzInput& input, bool mutated) {
+        const ExecResult result = Execute(chip8, pristine, input, frames);
+
+        // a fault only counts if it is at a new address and the interpreter
+        // got there through a block no earlier finding of the same kind ran,
+        // so one bug reached from a thousand slightly different ROMs is
+        // still one finding
+        const std::pair<uint8_t, uint16_t> site{result.faults, result.fault_pc};
+        if (result.faults && !finding_sites.count(site) && host.MarkEdges(finding_blocks[result.faults])) {
+            finding_sites.insert(site);
+            const std::string kind = FaultName(result.faults);
+            std::printf("finding %zu: %s at 0x%03x\n", findings, kind.c_str(), result.fault_pc);
+            if (!out.empty()) {
+                char name[64];
+                std::snprintf(name, sizeof(name), "%04zu-%s-%03x.c8fz", findings, kind.c_str(), result.fault_pc);
+                WriteFile(out / name, Serialize(input));
+            }
+            ++findings;
+        }
+
+        // evaluate both maps even if the first already found something new
+        const Novelty guest_novelty = guest.Merge();
+        const Novelty host_novelty = host.Merge();
+
+        // inputs that fault are findings, not seeds: they stop too early to
+        // be worth mutating further. Anything new in the interpreter gets
+        // in; new guest behaviour, which random jumps turn up endlessly,
+        // has to wait for credit
+        if (!mutated || result.faults) {
+            return;
+        }
+        if (host_novelty == Novelty::NONE) {
+            if (guest_novelty == Novelty::NONE || credit == 0) {
+                return;
+            }
+            --credit;
+        }
+        if (!out.empty()) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "queue-%06zu.c8fz", corpus.size());
+            WriteFile(out / name, Serialize(input));
+        }
+        corpus.push_back(input);
+    };
+
+    for (std::size_t i = 0; i < seeds; ++i) {
+        evaluate(corpus[i], false);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto last_report = start;
+    uint64_t execs = 0;
+
+    for (FuzzInput input;; ++execs) {
+        if (runs && execs >= runs) {
+            break;
+        }
+
+        if ((execs & 0x3FF) == 0) {
+            const auto now = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - start).count();
+            if (seconds && elapsed >= seconds) {
+                break;
+            }
+            if (now - last_report >= std::chrono::seconds(2)) {
+                last_report = now;
+                std::fprintf(stderr, "#%llu  %.0f exec/s  corpus %zu  guest edges %zu  host edges %zu  findings %zu\n",
+                             static_cast<unsigned long long>(execs), execs / elapsed, corpus.size(), guest.covered,
+                             host.covered, findings);
+            }
+        }
+        if (execs % CORPUS_CREDIT_PERIOD == 0) {
+            credit = std::min(credit + 1, MAX_CORPUS_CREDIT);
+        }
+
+        input = corpus[rng.Below(static_cast<uint32_t>(corpus.size()))];
+        Mutate(input, corpus, frames, rng);
+        if (!input.rom.empty()) {
+            evaluate(input, true);
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << execs << " execs in " << elapsed << " s (" << (elapsed > 0 ? execs / elapsed : 0) << " exec/s), corpus "
+              << corpus.size() << ", guest edges " << guest.covered << ", host edges " << host.covered << ", findings "
+              << findings << "\n";
+}
@@ -0,0 +1,139 @@
+#include "hardware.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+
+namespace {
+
+// The input pins of chip8.circ are unlabeled; these are their roles.
+constexpr std::size_t PIN_ADDRESS = Chip8Circuit::INPUT_PIN_6020_1420;
+constexpr std::size_t PIN_MEMORY_WRITE = Chip8Circuit::INPUT_PIN_90_170;
+constexpr std::size_t PIN_X_SELECT = Chip8Circuit::INPUT_PIN_6030_1340;
+constexpr std::size_t PIN_X_ENABLE = Chip8Circuit::INPUT_PIN_6040_340;
+constexpr std::size_t PIN_Y_SELECT = Chip8Circuit::INPUT_PIN_6030_1360;
+constexpr std::size_t PIN_Y_ENABLE = Chip8Circuit::INPUT_PIN_6030_2090;
+constexpr std::size_t PIN_ALU_A = Chip8Circuit::INPUT_PIN_7030_1440;
+constexpr std::size_t PIN_ALU_B = Chip8Circuit::INPUT_PIN_7030_1470;
+
+}
+
+std::size_t FindState(const std::string& name) {
+    for (std::size_t i = 0; i < Chip8Circuit::STATE_COUNT; ++i) {
+        if (name == Chip8Circuit::STATES[i].name) {
+            return i;
+        }
+    }
+    std::fprintf(stderr, "chip8.circ has no state named %s\n", name.c_str());
+    std::abort();
+}
+
+HardwareModel::HardwareModel() {
+    for (std::size_t i = 0; i < 16; ++i) {
+        registers[i] = FindState("V" + std::to_string(i));
+    }
+    index_register = FindState("I_reg");
+    Reset();
+}
+
+void HardwareModel::Reset() {
+    circuit.Reset();
+    std::fill(std::begin(stack), std::end(stack), 0);
+    program_counter = START_ADDRESS;
+    sp = 0;
+    cycles = 0;
+}
+
+bool HardwareModel::LoadROM(const char* filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    LoadROM(buffer.data(), buffer.size());
+    return true;
+}
+
+void HardwareModel::LoadROM(const uint8_t* data, std::size_t size) {
+    size = std::min<std::size_t>(size, sizeof(memory) - START_ADDRESS);
+    std::memcpy(memory + START_ADDRESS, data, size);
+}
+
+void HardwareModel::Execute(uint16_t opcode) {
+    const uint8_t op = opcode >> 12u;
+    const uint8_t x = (opcode >> 8u) & 0xFu;
+    const uint8_t y = (opcode >> 4u) & 0xFu;
+    const uint8_t kk = opcode & 0xFFu;
+
+    // instructions that write Vx, that read Vy, and that store to memory
+    const bool writes_x = op == 0x6 || op == 0x7 || op == 0x8 || op == 0xC ||
+                          (op == 0xF && (kk == 0x07 || kk == 0x0A || kk == 0x65));
+    const bool reads_y = op == 0x5 || op == 0x8 || op == 0x9 || op == 0xD;
+    const bool stores = op == 0xF && (kk == 0x33 || kk == 0x55);
+
+    circuit.in[PIN_ADDRESS] = stores ? Index() : opcode & 0xFFFu;
+    circuit.in[PIN_MEMORY_WRITE] = stores;
+    circuit.in[PIN_X_SELECT] = x;
+    circuit.in[PIN_X_ENABLE] = writes_x || stores;
+    circuit.in[PIN_Y_SELECT] = y;
+    circuit.in[PIN_Y_ENABLE] = reads_y;
+    circuit.in[PIN_ALU_A] = Register(x);
+    circuit.in[PIN_ALU_B] = Register(y);
+    circuit.Clock();
+    ++cycles;
+}
+
+void HardwareModel::Step() {
+    const uint16_t opcode = (memory[program_counter & 0xFFFu] << 8u) | memory[(program_counter + 1u) & 0xFFFu];
+    program_counter += 2;
+
+    const uint8_t x = (opcode >> 8u) & 0xFu;
+    const uint8_t y = (opcode >> 4u) & 0xFu;
+    const uint8_t kk = opcode & 0xFFu;
+    const uint16_t nnn = opcode & 0xFFFu;
+
+    // branches are decided on the register values before the clock
+    switch (opcode >> 12u) {
+        case 0x0:
+            if (opcode == 0x00EE && sp) {
+                program_counter = stack[--sp];
+            }
+            break;
+        case 0x1:
+            program_counter = nnn;
+            break;
+        case 0x2:
+            if (sp < 16) {
+                stack[sp++] = program_counter;
+            }
+            program_counter = nnn;
+            break;
+        case 0x3:
+            program_counter += Register(x) == kk ? 2 : 0;
+            break;
+        case 0x4:
+            program_counter += Register(x) != kk ? 2 : 0;
+            break;
+        case 0x5:
+            program_counter += Register(x) == Register(y) ? 2 : 0;
+            break;
+        case 0x9:
+            program_counter += Register(x) != Register(y) ? 2 : 0;
+            break;
+        case 0xB:
+            program_counter = (nnn + Register(0)) & 0xFFFu;
+            break;
+        default:
+            break;
+    }
+
+    Execute(opcode);
+}
@@ -0,0 +1,55 @@
+#ifndef CHIP_8_HARDWARE_H
+#define CHIP_8_HARDWARE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "chip8_circuit.h"
+
+// Index of the named register in Chip8Circuit::STATES. The names come from
+// chip8.circ, so a missing one means the netlist and this code disagree;
+// that aborts with the name rather than silently reading state 0.
+std::size_t FindState(const std::string& name);
+
+// Runs CHIP-8 programs on the gate-level model compiled from chip8.circ.
+//
+// The design is a datapath without a sequencer: the V0-V15 and I_reg
+// registers with their x/y read buses, a 256-nibble memory array behind a
+// three-level address decoder, and an ALU slice. HardwareModel is the
+// missing control unit. Execute() decodes one opcode into the datapath's
+// pin strobes and clocks the model once; Step() fetches from its own copy of
+// the ROM and follows control flow, deciding branches on the model's
+// register values.
+class HardwareModel {
+public:
+    HardwareModel();
+
+    void Reset();
+    bool LoadROM(const char* filename);
+    void LoadROM(const uint8_t* data, std::size_t size);
+
+    // drives the datapath for one instruction and clocks it
+    void Execute(uint16_t opcode);
+    // fetches, executes and advances the program counter
+    void Step();
+
+    uint8_t Register(std::size_t index) const { return static_cast<uint8_t>(circuit.state[registers[index]]); }
+    uint16_t Index() const { return static_cast<uint16_t>(circuit.state[index_register]); }
+    uint16_t ProgramCounter() const { return program_counter; }
+    uint64_t Cycles() const { return cycles; }
+    const Chip8Circuit& Circuit() const { return circuit; }
+
+private:
+    Chip8Circuit circuit;
+    std::size_t registers[16]{};
+    std::size_t index_register{};
+
+    uint8_t memory[4096]{};
+    uint16_t stack[16]{};
+    uint16_t program_counter{};
+    uint8_t sp{};
+    uint64_t cycles{};
+};
+
+#endif //CHIP_8_HARDWARE_H
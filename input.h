@@ -0,0 +1,36 @@
+#ifndef CHIP_8_INPUT_H
+#define CHIP_8_INPUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8.h"
+#include "spsc_ring.h"
+
+struct KeyEvent {
+    uint64_t frame; // first frame boundary at which the event takes effect
+    uint8_t key;
+    bool pressed;
+};
+
+constexpr std::size_t KEY_QUEUE_SIZE = 64;
+
+// Written by the frontend thread, drained by the emulation thread.
+using KeyQueue = SpscRing<KeyEvent, KEY_QUEUE_SIZE>;
+
+// Applies every queued event stamped at or before `frame` to the keypad of a
+// Chip8, or of anything else with its SetKey() such as RunAhead. Called only
+// between frames, so Ex9E/ExA1/Fx0A see one stable snapshot for the whole
+// frame regardless of when the frontend posted the events.
+template <typename Keypad>
+std::size_t DrainKeys(KeyQueue& queue, Keypad& instance, uint64_t frame) {
+    std::size_t applied = 0;
+    for (const KeyEvent* event = queue.Front(); event && event->frame <= frame; event = queue.Front()) {
+        instance.SetKey(event->key, event->pressed);
+        queue.Pop();
+        ++applied;
+    }
+    return applied;
+}
+
+#endif //CHIP_8_INPUT_H
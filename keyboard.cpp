@@ -0,0 +1,87 @@
+#include "keyboard.h"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char LAYOUT[] = "x123qweasdzc4rfv";
+constexpr int POLL_MS = 5;
+
+}
+
+TerminalKeyboard::TerminalKeyboard(KeyQueue& queue, int fd) : queue(queue), fd(fd) {
+    if (tcgetattr(fd, &saved_mode) == 0) {
+        termios mode = saved_mode;
+        mode.c_lflag &= ~(ICANON | ECHO | ISIG);
+        mode.c_cc[VMIN] = 0;
+        mode.c_cc[VTIME] = 0;
+        raw = tcsetattr(fd, TCSANOW, &mode) == 0;
+    }
+    thread = std::thread(&TerminalKeyboard::ReadLoop, this);
+}
+
+TerminalKeyboard::~TerminalKeyboard() {
+    running.store(false, std::memory_order_relaxed);
+    thread.join();
+    if (raw) {
+        tcsetattr(fd, TCSANOW, &saved_mode);
+    }
+}
+
+int TerminalKeyboard::KeyFor(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        c = static_cast<char>(c - 'A' + 'a');
+    }
+    const char* at = c ? std::strchr(LAYOUT, c) : nullptr;
+    return at ? static_cast<int>(at - LAYOUT) : -1;
+}
+
+void TerminalKeyboard::ReadLoop() {
+    while (running.load(std::memory_order_relaxed)) {
+        pollfd request{fd, POLLIN, 0};
+        if (poll(&request, 1, POLL_MS) > 0 && (request.revents & POLLIN)) {
+            char buffer[64];
+            const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+            if (count == 0 || (count < 0 && errno != EINTR && errno != EAGAIN)) {
+                // stdin closed: keep running without input
+                return;
+            }
+            for (ssize_t i = 0; i < count; ++i) {
+                if (buffer[i] == 0x1B && i + 1 < count) {
+                    // the rest is an escape sequence (arrows, function keys)
+                    break;
+                }
+                if (buffer[i] == 0x1B || buffer[i] == 0x03) {
+                    quit.store(true, std::memory_order_relaxed);
+                }
+                const int key = KeyFor(buffer[i]);
+                if (key < 0) {
+                    continue;
+                }
+                if (!held[key]) {
+                    Post(static_cast<uint8_t>(key), true);
+                }
+                release_at[key] = std::chrono::steady_clock::now() + KEY_HOLD;
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (uint8_t key = 0; key < 16; ++key) {
+            if (held[key] && now >= release_at[key]) {
+                Post(key, false);
+            }
+        }
+    }
+}
+
+void TerminalKeyboard::Post(uint8_t key, bool pressed) {
+    // frame 0: take effect at the next frame boundary. A full queue drops
+    // the event; a dropped release is retried on the next pass
+    if (queue.Push({0, key, pressed})) {
+        held[key] = pressed;
+    }
+}
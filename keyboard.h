@@ -0,0 +1,56 @@
+#ifndef CHIP_8_KEYBOARD_H
+#define CHIP_8_KEYBOARD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <termios.h>
+
+#include "input.h"
+
+// Reads the keypad from a terminal on its own thread and posts the events to
+// a KeyQueue for the emulation thread to drain between frames. The terminal
+// is switched to raw, non-echoing mode for the keyboard's lifetime.
+//
+// The hex keypad sits on the left of a QWERTY keyboard:
+//
+//     1 2 3 4        1 2 3 C
+//     q w e r   ->   4 5 6 D
+//     a s d f        7 8 9 E
+//     z x c v        A 0 B F
+//
+// A terminal only reports key presses, so each key is released KEY_HOLD
+// after its last press; terminal auto-repeat keeps a held key down. Escape
+// or Ctrl-C asks the program to quit.
+class TerminalKeyboard {
+public:
+    static constexpr std::chrono::milliseconds KEY_HOLD{250};
+
+    explicit TerminalKeyboard(KeyQueue& queue, int fd = 0);
+    ~TerminalKeyboard();
+
+    TerminalKeyboard(const TerminalKeyboard&) = delete;
+    TerminalKeyboard& operator=(const TerminalKeyboard&) = delete;
+
+    bool QuitRequested() const { return quit.load(std::memory_order_relaxed); }
+
+    // Keypad key for a terminal byte, or -1 if it is not mapped.
+    static int KeyFor(char c);
+
+private:
+    void ReadLoop();
+    void Post(uint8_t key, bool pressed);
+
+    KeyQueue& queue;
+    int fd;
+    termios saved_mode{};
+    bool raw{};
+    std::atomic<bool> quit{false};
+    std::atomic<bool> running{true};
+    std::chrono::steady_clock::time_point release_at[16]{};
+    bool held[16]{};
+    std::thread thread;
+};
+
+#endif //CHIP_8_KEYBOARD_H
@@ -0,0 +1,144 @@
+// chip8_latency: measures input-to-photon latency of a ROM in real time.
+//
+// The ROM runs at 60 Hz under FramePacer, optionally with run-ahead. A
+// scripted player presses keys at random moments, not aligned to frames, and
+// holds each for a few frames; each event is handed to the instance at the
+// next frame boundary, as a frontend draining its input queue would. A frame
+// counts as presented when the pacer's deadline for it passes, which is when
+// a vsync'd display would scan it out. LatencyProbe reports where the time
+// between a press and its picture goes.
+//
+// usage: chip8_latency [-seconds S] [-ipf N] [-keys HEX] [-hold F] [-gap F] [-run-ahead K] [-run-ahead-instance] [-terminal] <rom>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "latency_probe.h"
+#include "pacer.h"
+#include "runahead.h"
+#include "terminal.h"
+
+namespace {
+
+constexpr int64_t FRAME_NS = 1000000000 / 60;
+
+struct ScriptedKey {
+    int64_t at;
+    uint8_t key;
+    bool pressed;
+};
+
+// presses the keys in turn, `gap` to 2 * `gap` frames apart, at any point
+// within a frame
+std::deque<ScriptedKey> Script(const std::string& keys, unsigned int hold, unsigned int gap, int64_t start,
+                               int64_t end) {
+    CounterRng rng{CounterRng::key_for(1, 0), 0};
+    std::deque<ScriptedKey> script;
+    int64_t at = start;
+    for (std::size_t i = 0;; ++i) {
+        at += (gap + rng.next_byte() % (gap + 1)) * FRAME_NS + rng.next_byte() * FRAME_NS / 256;
+        if (at + hold * FRAME_NS >= end) {
+            return script;
+        }
+        const auto key = static_cast<uint8_t>(std::stoul(keys.substr(i % keys.size(), 1), nullptr, 16));
+        script.push_back({at, key, true});
+        script.push_back({at + hold * FRAME_NS, key, false});
+        at += hold * FRAME_NS;
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    double seconds = 10;
+    unsigned int instructions = 11;
+    std::string keys = "0123456789ABCDEF";
+    unsigned int hold = 6;
+    unsigned int gap = 10;
+    bool terminal_output = false;
+    RunAheadConfig run_ahead;
+    const char* rom = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-seconds" && i + 1 < argc) {
+            seconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "-ipf" && i + 1 < argc) {
+            instructions = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "-keys" && i + 1 < argc) {
+            keys = argv[++i];
+        } else if (arg == "-hold" && i + 1 < argc) {
+            hold = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 0)));
+        } else if (arg == "-gap" && i + 1 < argc) {
+            gap = std::max(1u, static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 0)));
+        } else if (arg == "-run-ahead" && i + 1 < argc) {
+            run_ahead.frames = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (arg == "-run-ahead-instance") {
+            run_ahead.second_instance = true;
+        } else if (arg == "-terminal") {
+            terminal_output = true;
+        } else {
+            rom = argv[i];
+        }
+    }
+    if (!rom || keys.empty() || keys.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        std::fprintf(stderr,
+                     "usage: %s [-seconds S] [-ipf N] [-keys HEX] [-hold F] [-gap F] [-run-ahead K] "
+                     "[-run-ahead-instance] [-terminal] <rom>\n",
+                     argv[0]);
+        return 2;
+    }
+
+    Chip8 chip8;
+    if (!chip8.LoadROM(rom)) {
+        std::fprintf(stderr, "cannot open %s\n", rom);
+        return 2;
+    }
+
+    LatencyProbe probe;
+    RunAhead ahead(chip8, run_ahead);
+    ahead.SetProbe(&probe);
+    std::unique_ptr<TerminalRenderer> terminal;
+    if (terminal_output) {
+        terminal = std::make_unique<TerminalRenderer>(2);
+    }
+
+    const int64_t start = LatencyProbe::Now();
+    const int64_t end = start + static_cast<int64_t>(seconds * 1e9);
+    std::deque<ScriptedKey> script = Script(keys, hold, gap, start, end);
+
+    FramePacer pacer(instructions, instructions);
+    while (LatencyProbe::Now() < end) {
+        // everything that arrived during the last frame lands at this boundary
+        for (const int64_t now = LatencyProbe::Now(); !script.empty() && script.front().at <= now;
+             script.pop_front()) {
+            probe.KeyEvent(chip8, script.front().key, script.front().pressed, script.front().at);
+            ahead.SetKey(script.front().key, script.front().pressed);
+        }
+
+        const uint32_t* video = ahead.RunFrame(pacer.InstructionsPerFrame());
+        if (terminal) {
+            terminal->Render(video);
+        }
+
+        const uint64_t elapsed = pacer.Wait();
+        probe.Presented();
+        ahead.AdvanceTimers(elapsed - 1);
+    }
+    terminal.reset();
+
+    probe.Print(stdout);
+    const FramePacer::Stats stats = pacer.GetStats();
+    std::printf("%llu frames, %llu missed, late by %.1f us on average and %.1f us at worst",
+                static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.missed),
+                stats.mean_late_ns / 1e3, stats.max_late_ns / 1e3);
+    if (run_ahead.frames) {
+        std::printf(", run-ahead %u (%llu resyncs)", run_ahead.frames,
+                    static_cast<unsigned long long>(ahead.Resyncs()));
+    }
+    std::printf("\n");
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// "850 us", "12.3 ms"
+void PrintDuration(std::FILE* out, double ns) {
+    if (ns < 1e6) {
+        std::fprintf(out, "%7.1f us", ns / 1e3);
+    } else {
+        std::fprintf(out, "%7.2f ms", ns / 1e6);
+    }
+}
+
+}
+
+unsigned int LatencyHistogram::Bucket(uint64_t ns) {
+    if (ns < SUB_BUCKETS) {
+        return static_cast<unsigned int>(ns);
+    }
+    const unsigned int shift = 63 - __builtin_clzll(ns) - SUB_BITS;
+    const unsigned int bucket = (shift + 1) * SUB_BUCKETS + static_cast<unsigned int>((ns >> shift) - SUB_BUCKETS);
+    return std::min(bucket, OCTAVES * SUB_BUCKETS - 1);
+}
+
+int64_t LatencyHistogram::UpperEdge(unsigned int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const unsigned int shift = bucket / SUB_BUCKETS - 1;
+    const int64_t lower = static_cast<int64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + (int64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t ns) {
+    ns = std::max<int64_t>(ns, 0);
+    ++buckets[Bucket(static_cast<uint64_t>(ns))];
+    ++count;
+    total += ns;
+    max = std::max(max, ns);
+}
+
+int64_t LatencyHistogram::Percentile(double p) const {
+    if (!count) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * static_cast<double>(count) + 0.5));
+    uint64_t seen = 0;
+    for (unsigned int bucket = 0; bucket < OCTAVES * SUB_BUCKETS; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            return std::min(UpperEdge(bucket), max);
+        }
+    }
+    return max;
+}
+
+void LatencyHistogram::Print(std::FILE* out, const char* name) const {
+    std::fprintf(out, "%s: %llu events\n", name, static_cast<unsigned long long>(count));
+    if (!count) {
+        return;
+    }
+    std::fprintf(out, "  mean ");
+    PrintDuration(out, Mean());
+    for (const double p : {50.0, 90.0, 99.0, 99.9}) {
+        std::fprintf(out, "  p%g ", p);
+        PrintDuration(out, static_cast<double>(Percentile(p)));
+    }
+    std::fprintf(out, "  max ");
+    PrintDuration(out, static_cast<double>(max));
+    std::fprintf(out, "\n");
+
+    // one bar per power of two between the smallest and largest sample
+    uint64_t octaves[OCTAVES]{};
+    uint64_t tallest = 0;
+    unsigned int first = OCTAVES;
+    unsigned int last = 0;
+    for (unsigned int octave = 0; octave < OCTAVES; ++octave) {
+        for (unsigned int sub = 0; sub < SUB_BUCKETS; ++sub) {
+            octaves[octave] += buckets[octave * SUB_BUCKETS + sub];
+        }
+        if (octaves[octave]) {
+            tallest = std::max(tallest, octaves[octave]);
+            first = std::min(first, octave);
+            last = octave;
+        }
+    }
+    for (unsigned int octave = first; octave <= last; ++octave) {
+        std::fprintf(out, "  ");
+        PrintDuration(out, octave ? static_cast<double>(UpperEdge(octave * SUB_BUCKETS - 1) + 1) : 0.0);
+        std::fprintf(out, " |");
+        const auto width = static_cast<unsigned int>((octaves[octave] * 50 + tallest - 1) / tallest);
+        for (unsigned int i = 0; i < width; ++i) {
+            std::fputc('#', out);
+        }
+        std::fprintf(out, " %llu\n", static_cast<unsigned long long>(octaves[octave]));
+    }
+}
+
+int64_t LatencyProbe::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LatencyProbe::KeyEvent(const Chip8& chip8, uint8_t key, bool pressed, int64_t entered_ns) {
+    key &= 0xFu;
+    auto stale = std::find_if(in_flight.begin(), in_flight.end(),
+                              [&](const Event& event) { return event.key == key && !event.observed; });
+    if (stale != in_flight.end()) {
+        in_flight.erase(stale);
+        ++superseded;
+    }
+
+    in_flight.push_back({entered_ns, 0, 0, presents + timeout_presents, key, pressed});
+
+    // a press that ends an Fx0A wait is taken by the ROM right away
+    if (pressed && chip8.WaitingForKey()) {
+        Observe(in_flight.back(), Now());
+    }
+}
+
+void LatencyProbe::Observe(uint8_t key, int64_t now) {
+    auto fresh = [&](const Event& event) { return event.key == key && !event.observed; };
+    if (std::none_of(in_flight.begin(), in_flight.end(), fresh)) {
+        return;
+    }
+
+    // the ROM now sees a newer state of the key; an earlier event it read
+    // but never drew for, typically a release, had no visible effect
+    auto replaced = std::remove_if(in_flight.begin(), in_flight.end(), [&](const Event& event) {
+        return event.key == key && event.observed && !event.drawn;
+    });
+    awaiting_draw -= static_cast<unsigned int>(in_flight.end() - replaced);
+    invisible += static_cast<uint64_t>(in_flight.end() - replaced);
+    in_flight.erase(replaced, in_flight.end());
+
+    for (Event& event : in_flight) {
+        if (event.key == key && !event.observed) {
+            Observe(event, now);
+        }
+    }
+}
+
+void LatencyProbe::Observe(Event& event, int64_t now) {
+    event.observed = now;
+    histograms[ToObserve].Record(now - event.entered);
+    ++awaiting_draw;
+}
+
+void LatencyProbe::Draw(int64_t now) {
+    for (Event& event : in_flight) {
+        if (event.observed && !event.drawn) {
+            event.drawn = now;
+            histograms[ToDraw].Record(now - event.observed);
+        }
+    }
+    awaiting_draw = 0;
+}
+
+void LatencyProbe::RunFrame(Chip8& chip8, unsigned int instructions) {
+    unsigned int executed = 0;
+    chip8.RunFrame(instructions, executed, [&](const Chip8& c) {
+        if (!in_flight.empty()) {
+            Before(c);
+        }
+        return Chip8::HookAction::Run;
+    });
+}
+
+void LatencyProbe::Before(const Chip8& chip8) {
+    const uint16_t pc = chip8.program_counter;
+    const uint16_t opcode = (chip8.memory[pc & 0xFFFu] << 8u) | chip8.memory[(pc + 1u) & 0xFFFu];
+    const uint8_t x = (opcode >> 8u) & 0xFu;
+    if ((opcode & 0xF0FFu) == 0xE09Eu || (opcode & 0xF0FFu) == 0xE0A1u) {
+        Observe(chip8.registers[x] & 0xFu, Now());
+    } else if ((opcode & 0xF0FFu) == 0xF00Au) {
+        const uint8_t* down = std::find(chip8.keypad, chip8.keypad + 16, 1);
+        if (down != chip8.keypad + 16) {
+            Observe(static_cast<uint8_t>(down - chip8.keypad), Now());
+        }
+    } else if ((opcode & 0xF000u) == 0xD000u && awaiting_draw) {
+        // every set sprite bit lands on a pixel and flips it
+        bool changes = false;
+        for (unsigned int row = 0; row < (opcode & 0xFu); ++row) {
+            changes |= chip8.memory[(chip8.index + row) & 0xFFFu] != 0;
+        }
+        if (changes) {
+            Draw(Now());
+        }
+    }
+}
+
+void LatencyProbe::Presented() {
+    const int64_t now = Now();
+    ++presents;
+
+    auto done = std::remove_if(in_flight.begin(), in_flight.end(), [&](const Event& event) {
+        if (event.drawn) {
+            histograms[ToPresent].Record(now - event.drawn);
+            histograms[Total].Record(now - event.entered);
+            return true;
+        }
+        if (presents >= event.present_deadline) {
+            awaiting_draw -= event.observed ? 1 : 0;
+            ++invisible;
+            return true;
+        }
+        return false;
+    });
+    in_flight.erase(done, in_flight.end());
+}
+
+void LatencyProbe::Print(std::FILE* out) const {
+    histograms[ToObserve].Print(out, "key event -> ROM reads it");
+    histograms[ToDraw].Print(out, "ROM reads it -> Dxyn changes video");
+    histograms[ToPresent].Print(out, "Dxyn -> frame presented");
+    histograms[Total].Print(out, "key event -> frame presented");
+    std::fprintf(out, "%llu events superseded before the ROM read them, %llu with no visible reaction\n",
+                 static_cast<unsigned long long>(superseded), static_cast<unsigned long long>(invisible));
+}
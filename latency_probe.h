@@ -0,0 +1,107 @@
+#ifndef CHIP_8_LATENCY_PROBE_H
+#define CHIP_8_LATENCY_PROBE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "chip8.h"
+
+// Log-linear histogram of nanosecond durations: 16 buckets per power of two,
+// so any recorded value is reported within about 6%.
+class LatencyHistogram {
+public:
+    void Record(int64_t ns);
+
+    uint64_t Count() const { return count; }
+    int64_t Max() const { return max; }
+    double Mean() const { return count ? static_cast<double>(total) / count : 0.0; }
+    // upper edge of the bucket holding the p-th percentile, p in [0, 100]
+    int64_t Percentile(double p) const;
+
+    // Percentiles, then one bar per power of two.
+    void Print(std::FILE* out, const char* name) const;
+
+private:
+    static constexpr unsigned int SUB_BITS = 4;
+    static constexpr unsigned int SUB_BUCKETS = 1u << SUB_BITS;
+    static constexpr unsigned int OCTAVES = 48;
+
+    static unsigned int Bucket(uint64_t ns);
+    static int64_t UpperEdge(unsigned int bucket);
+
+    uint64_t buckets[OCTAVES * SUB_BUCKETS]{};
+    uint64_t count{};
+    int64_t total{};
+    int64_t max{};
+};
+
+// Follows each key event from the moment it enters the keypad path to the
+// moment the picture it causes reaches the display:
+//
+//     entered   KeyEvent(), with the time the event arrived
+//     observed  first Ex9E/ExA1 on that key, or the Fx0A that takes it
+//     drawn     first Dxyn after that which changes at least one pixel
+//     presented first Presented() after the draw
+//
+// and keeps a histogram of each stage and of the whole. Like Debugger, a
+// probed session runs its frames through LatencyProbe::RunFrame, which hooks
+// Chip8::RunFrame, so an unprobed one pays nothing. The probe keeps its own bookkeeping, so it may
+// run speculative frames that are later rewound (see RunAhead): the first
+// instance to reach a stage sets it, which is what the player sees.
+//
+// An event still unobserved when the next event for the same key arrives,
+// or not drawn within `timeout_presents` presents, never caused anything
+// visible; those are counted but not timed.
+class LatencyProbe {
+public:
+    enum Stage { ToObserve, ToDraw, ToPresent, Total, STAGE_COUNT };
+
+    explicit LatencyProbe(unsigned int timeout_presents = 120) : timeout_presents(timeout_presents) {}
+
+    static int64_t Now();
+
+    // Call just before chip8.SetKey(); `entered_ns` is when the event arrived
+    // from the host, on the Now() clock.
+    void KeyEvent(const Chip8& chip8, uint8_t key, bool pressed, int64_t entered_ns);
+
+    // Chip8::RunFrame with the reads and draws noted.
+    void RunFrame(Chip8& chip8, unsigned int instructions);
+
+    // The last frame run is now on screen.
+    void Presented();
+
+    const LatencyHistogram& Histogram(Stage stage) const { return histograms[stage]; }
+    uint64_t Superseded() const { return superseded; }
+    uint64_t Invisible() const { return invisible; }
+
+    void Print(std::FILE* out) const;
+
+private:
+    struct Event {
+        int64_t entered;
+        int64_t observed;
+        int64_t drawn;
+        uint64_t present_deadline;
+        uint8_t key;
+        bool pressed;
+    };
+
+    // notes the key reads and draws of the instruction about to run
+    void Before(const Chip8& chip8);
+    void Observe(uint8_t key, int64_t now);
+    void Observe(Event& event, int64_t now);
+    void Draw(int64_t now);
+
+    unsigned int timeout_presents;
+    uint64_t presents{};
+    std::vector<Event> in_flight;
+    // events observed but not drawn yet, so Dxyn can skip the scan
+    unsigned int awaiting_draw{};
+
+    LatencyHistogram histograms[STAGE_COUNT];
+    uint64_t superseded{};
+    uint64_t invisible{};
+};
+
+#endif //CHIP_8_LATENCY_PROBE_H
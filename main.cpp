@@ -1,88 +1,99 @@
-#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-
-constexpr unsigned int START_ADDRESS = 0x200;
-
-struct Chip8 {
-
-private:
-    uint8_t registers[16]{};
-    uint8_t memory[4096]{};
-    uint16_t index{};
-    uint16_t program_counter{};
-    uint16_t stack[16]{};
-    uint8_t sp{};
-    uint8_t delayTimer{};
-    uint8_t soundTimer{};
-    uint8_t keypad[16]{};
-    uint32_t video[64 * 32]{};
-    uint16_t opcode{};
-
-public:
-    Chip8() = default;
-
-    // call
-    void OP_0nnn();
-
-    // display
-    void OP_00e0();
-    void OP_dxyn();
-
-    // flow
-    void OP_00ee();
-    void OP_1nnn();
-    void OP_2nnn();
-    void OP_bnnn();
-
-    // cond
-    void OP_3xnn();
-    void OP_4xnn();
-    void OP_5xy0();
-    void OP_9xy0();
-
-    //const
-    void OP_6xnn();
-    void OP_7xnn();
-
-    // assign
-    void OP_8xy0();
-
-    // bit op
-    void OP_8xy1();
-    void OP_8xy2();
-    void OP_8xy3();
-    void OP_8xy6();
-    void OP_8xye();
-
-    // math
-    void OP_8xy4();
-    void OP_8xy5();
-    void OP_8xy7();
-
-    // memory
-    void OP_annn();
-    void OP_fx1e();
-    void OP_fx29();
-    void OP_fx55();
-    void OP_fx65();
-
-    // rand
-    void OP_cxnn();
-
-    // key op
-    void OP_ex9e();
-    void OP_exa1();
-    void OP_fx0a();
-
-    // timer
-    void OP_fx07();
-    void OP_fx15();
-
-    // bcd
-    void OP_fx33();
-
-};
-
-int main() {
-
+#include <memory>
+
+#include "audio.h"
+#include "chip8.h"
+#include "input.h"
+#include "keyboard.h"
+#include "pacer.h"
+#include "presenter.h"
+#include "runahead.h"
+#include "shared_state.h"
+#include "terminal.h"
+
+constexpr unsigned int INSTRUCTIONS_PER_FRAME = 11;
+constexpr unsigned int AUDIO_SAMPLE_RATE = 44100;
+
+int main(int argc, char** argv) {
+    const char* rom = nullptr;
+    const char* shm_name = nullptr;
+    const char* run_ahead_table = nullptr;
+    const char* wav_path = nullptr;
+    RunAheadConfig run_ahead;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
+        } else if (std::strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            run_ahead.frames = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 0));
+        } else if (std::strcmp(argv[i], "--run-ahead-instance") == 0) {
+            run_ahead.second_instance = true;
+        } else if (std::strcmp(argv[i], "--run-ahead-table") == 0 && i + 1 < argc) {
+            run_ahead_table = argv[++i];
+        } else if (std::strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+            wav_path = argv[++i];
+        } else {
+            rom = argv[i];
+        }
+    }
+
+    if (!rom) {
+        std::cerr << "usage: " << argv[0] << " [--shm <name>] [--run-ahead <frames>] [--run-ahead-instance]"
+                     " [--run-ahead-table <file>] [--wav <file>] <rom>\n";
+        return 1;
+    }
+
+    Chip8 chip8;
+    if (!chip8.LoadROM(rom)) {
+        std::cerr << "cannot open " << rom << "\n";
+        return 1;
+    }
+
+    SharedStateExport shared;
+    if (shm_name && !shared.Open(shm_name)) {
+        std::cerr << "cannot create shared memory " << shm_name << " (is another session using it?)\n";
+        return 1;
+    }
+
+    // the sound timer and XO-CHIP pattern, recorded losslessly since a file
+    // keeps up easily
+    std::unique_ptr<AudioPipeline> audio;
+    if (wav_path) {
+        auto wav = std::make_unique<WavAudioSink>(wav_path, AUDIO_SAMPLE_RATE);
+        if (!wav->IsOpen()) {
+            std::cerr << "cannot create " << wav_path << "\n";
+            return 1;
+        }
+        audio = std::make_unique<AudioPipeline>(AUDIO_SAMPLE_RATE, std::move(wav), true);
+    }
+
+    // a table entry for this ROM overrides the command line
+    if (run_ahead_table) {
+        run_ahead = RunAheadConfigForRom(run_ahead_table, rom, run_ahead);
+    }
+    RunAhead ahead(chip8, run_ahead);
+
+    // the terminal is drawn on the presenter's thread, so a slow terminal
+    // drops frames instead of holding up emulation; at scale 1 with a black
+    // and white palette the RGBA frame is exactly the video the renderer takes
+    TerminalRenderer terminal;
+    Presenter presenter(1, 0xFFFFFFFF, 0x00000000, [&terminal](const uint32_t* rgba, unsigned int, unsigned int,
+                                                               uint64_t) { terminal.Render(rgba); });
+
+    KeyQueue keys;
+    TerminalKeyboard keyboard(keys);
+    FramePacer pacer(INSTRUCTIONS_PER_FRAME);
+    for (uint64_t frame = 0; !keyboard.QuitRequested(); ++frame) {
+        DrainKeys(keys, ahead, frame);
+        presenter.Publish(ahead.RunFrame(pacer.InstructionsPerFrame()), frame);
+        shared.Publish(chip8, frame);
+        if (audio) {
+            audio->Frame(chip8.Audio());
+        }
+
+        // timers keep wall-clock time even when frames are missed
+        ahead.AdvanceTimers(pacer.Wait() - 1);
+    }
 }
@@ -0,0 +1,247 @@
+#include "netplay.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Packet, little endian:
+//   "C8NP"  u8 delay  u32 ack  u32 first  u8 count  u16 input[count]
+// delay is the sender's input_delay, which both peers must share; ack is
+// how many of the receiver's inputs the sender holds; input[i] is the
+// sender's keypad for frame first + i.
+constexpr uint8_t MAGIC[4] = {'C', '8', 'N', 'P'};
+constexpr std::size_t HEADER_SIZE = 14;
+
+void Put32(uint8_t* out, uint32_t value) {
+    for (unsigned int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t Get32(const uint8_t* in) {
+    return in[0] | (in[1] << 8u) | (in[2] << 16u) | (static_cast<uint32_t>(in[3]) << 24u);
+}
+
+sockaddr_in Loopback(uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return address;
+}
+
+}
+
+LoopbackLink::LoopbackLink() {
+    first.outgoing = &forward;
+    first.incoming = &backward;
+    second.outgoing = &backward;
+    second.incoming = &forward;
+}
+
+void LoopbackLink::End::Send(const uint8_t* data, std::size_t size) {
+    if (size > NETPLAY_MAX_PACKET) {
+        return;
+    }
+    Datagram datagram;
+    datagram.size = static_cast<uint16_t>(size);
+    std::memcpy(datagram.data, data, size);
+    outgoing->Push(datagram);
+}
+
+std::size_t LoopbackLink::End::Receive(uint8_t* data, std::size_t capacity) {
+    const Datagram* datagram = incoming->Front();
+    if (!datagram) {
+        return 0;
+    }
+    const std::size_t size = std::min<std::size_t>(datagram->size, capacity);
+    std::memcpy(data, datagram->data, size);
+    incoming->Pop();
+    return size;
+}
+
+UdpTransport::~UdpTransport() {
+    if (socket_fd >= 0) {
+        close(socket_fd);
+    }
+}
+
+bool UdpTransport::Open(uint16_t local_port, uint16_t peer) {
+    if (socket_fd >= 0) {
+        close(socket_fd);
+    }
+    socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socket_fd < 0) {
+        return false;
+    }
+
+    const sockaddr_in address = Loopback(local_port);
+    if (bind(socket_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK) != 0) {
+        close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+    peer_port = peer;
+    return true;
+}
+
+void UdpTransport::Send(const uint8_t* data, std::size_t size) {
+    const sockaddr_in address = Loopback(peer_port);
+    // losses are recovered by the session's resends
+    sendto(socket_fd, data, size, 0, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+std::size_t UdpTransport::Receive(uint8_t* data, std::size_t capacity) {
+    for (;;) {
+        const ssize_t size = recv(socket_fd, data, capacity, 0);
+        if (size > 0) {
+            return static_cast<std::size_t>(size);
+        }
+        // a refused send to a peer that is not up yet surfaces here; skip it
+        if (size < 0 && errno == ECONNREFUSED) {
+            continue;
+        }
+        return 0;
+    }
+}
+
+RollbackSession::RollbackSession(const Chip8& start, NetplayTransport& transport, const RollbackConfig& config)
+    : chip8(start), transport(transport), config(config) {
+    // both histories must cover the rollback window plus input delay twice
+    this->config.max_rollback = std::clamp(config.max_rollback, 1u, 64u);
+    this->config.input_delay = std::min(config.input_delay, 32u);
+    snapshots.resize(this->config.max_rollback + 1);
+
+    // the first input_delay frames run with no keys on either side
+    local_count = this->config.input_delay;
+    remote_count = this->config.input_delay;
+}
+
+bool RollbackSession::AdvanceFrame(uint16_t local_keys) {
+    if (local_count <= frame + config.input_delay) {
+        local_input[local_count % HISTORY] = local_keys;
+        ++local_count;
+    }
+
+    Exchange();
+    Rollback();
+
+    if (frame >= remote_count + config.max_rollback) {
+        ++stalls;
+        return false;
+    }
+    RunFrame(frame);
+    ++frame;
+    return true;
+}
+
+void RollbackSession::Poll() {
+    Exchange();
+    Rollback();
+}
+
+void RollbackSession::Exchange() {
+    uint8_t packet[NETPLAY_MAX_PACKET];
+
+    for (std::size_t size = transport.Receive(packet, sizeof(packet)); size;
+         size = transport.Receive(packet, sizeof(packet))) {
+        if (size < HEADER_SIZE || std::memcmp(packet, MAGIC, sizeof(MAGIC)) != 0 ||
+            size < HEADER_SIZE + 2u * packet[13]) {
+            continue;
+        }
+        // a peer with another input delay numbers its frames differently and
+        // would desync without a single misprediction; take nothing from it
+        if (packet[4] != config.input_delay) {
+            config_mismatch = true;
+            continue;
+        }
+        // the peer cannot hold inputs we never sent; such a packet is corrupt
+        // or from another session, and trusting it would make local_count -
+        // first below wrap
+        const uint64_t ack = Get32(packet + 5);
+        if (ack > local_count) {
+            continue;
+        }
+        peer_ack = std::max(peer_ack, ack);
+
+        const uint64_t first = Get32(packet + 9);
+        for (unsigned int i = 0; i < packet[13]; ++i) {
+            // only the next expected frame is taken; gaps wait for a resend
+            if (first + i != remote_count) {
+                continue;
+            }
+            const uint16_t keys = static_cast<uint16_t>(packet[HEADER_SIZE + 2 * i] |
+                                                        (packet[HEADER_SIZE + 2 * i + 1] << 8u));
+            remote_input[remote_count % HISTORY] = keys;
+            if (remote_count < frame && used_remote[remote_count % HISTORY] != keys) {
+                first_wrong = std::min(first_wrong, remote_count);
+            }
+            ++remote_count;
+        }
+    }
+
+    // resend everything the peer has not acknowledged
+    const uint64_t first = std::max(peer_ack, local_count > HISTORY ? local_count - HISTORY : 0);
+    const std::size_t count = std::min<uint64_t>(local_count - first, MAX_PACKET_INPUTS);
+    std::memcpy(packet, MAGIC, sizeof(MAGIC));
+    packet[4] = static_cast<uint8_t>(config.input_delay);
+    Put32(packet + 5, static_cast<uint32_t>(remote_count));
+    Put32(packet + 9, static_cast<uint32_t>(first));
+    packet[13] = static_cast<uint8_t>(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const uint16_t keys = local_input[(first + i) % HISTORY];
+        packet[HEADER_SIZE + 2 * i] = static_cast<uint8_t>(keys);
+        packet[HEADER_SIZE + 2 * i + 1] = static_cast<uint8_t>(keys >> 8u);
+    }
+    transport.Send(packet, HEADER_SIZE + 2 * count);
+}
+
+void RollbackSession::Rollback() {
+    if (first_wrong >= frame) {
+        first_wrong = UINT64_MAX;
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    chip8.Restore(snapshots[first_wrong % snapshots.size()]);
+    for (uint64_t f = first_wrong; f < frame; ++f) {
+        RunFrame(f);
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    ++rollbacks;
+    resimulated_frames += frame - first_wrong;
+    max_rollback_ns = std::max<uint64_t>(max_rollback_ns, elapsed.count());
+    first_wrong = UINT64_MAX;
+}
+
+void RollbackSession::RunFrame(uint64_t f) {
+    snapshots[f % snapshots.size()] = chip8;
+
+    // predict that the peer keeps holding what it last confirmed
+    uint16_t remote = 0;
+    if (f < remote_count) {
+        remote = remote_input[f % HISTORY];
+    } else if (remote_count) {
+        remote = remote_input[(remote_count - 1) % HISTORY];
+    }
+    used_remote[f % HISTORY] = remote;
+
+    const uint16_t keys = local_input[f % HISTORY] | remote;
+    const uint16_t previous = f ? combined[(f - 1) % HISTORY] : 0;
+    for (uint16_t changed = keys ^ previous; changed; changed &= changed - 1) {
+        const uint8_t key = static_cast<uint8_t>(__builtin_ctz(changed));
+        chip8.SetKey(key, (keys >> key) & 1u);
+    }
+    combined[f % HISTORY] = keys;
+
+    chip8.RunFrame(config.instructions_per_frame);
+}
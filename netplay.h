@@ -0,0 +1,167 @@
+#ifndef CHIP_8_NETPLAY_H
+#define CHIP_8_NETPLAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.h"
+#include "spsc_ring.h"
+
+// Datagram transport between the two peers. Delivery may drop, duplicate or
+// reorder packets; the session resends until acknowledged.
+class NetplayTransport {
+public:
+    virtual ~NetplayTransport() = default;
+    virtual void Send(const uint8_t* data, std::size_t size) = 0;
+    // Returns the size of the next pending datagram, or 0 if there is none.
+    virtual std::size_t Receive(uint8_t* data, std::size_t capacity) = 0;
+};
+
+constexpr std::size_t NETPLAY_MAX_PACKET = 256;
+
+// Both ends of an in-process link. Each direction is an SPSC ring, so the
+// two sessions may run on the same thread or on two. Packets that do not fit
+// are dropped, as UDP would.
+class LoopbackLink {
+public:
+    class End : public NetplayTransport {
+    public:
+        void Send(const uint8_t* data, std::size_t size) override;
+        std::size_t Receive(uint8_t* data, std::size_t capacity) override;
+
+    private:
+        friend class LoopbackLink;
+
+        struct Datagram {
+            uint16_t size;
+            uint8_t data[NETPLAY_MAX_PACKET];
+        };
+        using Ring = SpscRing<Datagram, 64>;
+
+        Ring* outgoing{};
+        Ring* incoming{};
+    };
+
+    LoopbackLink();
+
+    End& First() { return first; }
+    End& Second() { return second; }
+
+private:
+    End::Ring forward;
+    End::Ring backward;
+    End first;
+    End second;
+};
+
+// Non-blocking UDP socket bound to `local_port` on the loopback interface,
+// talking to `peer_port` there. Opening again replaces the socket.
+class UdpTransport : public NetplayTransport {
+public:
+    UdpTransport() = default;
+    ~UdpTransport() override;
+
+    UdpTransport(const UdpTransport&) = delete;
+    UdpTransport& operator=(const UdpTransport&) = delete;
+
+    bool Open(uint16_t local_port, uint16_t peer_port);
+
+    void Send(const uint8_t* data, std::size_t size) override;
+    std::size_t Receive(uint8_t* data, std::size_t capacity) override;
+
+private:
+    int socket_fd{-1};
+    uint16_t peer_port{};
+};
+
+struct RollbackConfig {
+    unsigned int instructions_per_frame = 11;
+    // how many frames the session may run ahead of the peer's confirmed
+    // input, and so the deepest rollback
+    unsigned int max_rollback = 8;
+    // local input is scheduled this many frames ahead, hiding that much
+    // latency without any rollback
+    unsigned int input_delay = 2;
+};
+
+// Two-player rollback session over one shared Chip8. Each player contributes
+// a 16-bit keypad mask per frame and the instance sees the OR of both.
+//
+// Remote input that has not arrived yet is predicted to repeat the last
+// confirmed one. The state at the start of each of the last max_rollback
+// frames is kept as a snapshot; when real input contradicts a prediction
+// the session restores the snapshot of the first wrong frame and runs every
+// frame since again, all within the AdvanceFrame() call that received it.
+//
+// Both peers must start from the same state; Chip8 is deterministic given
+// its inputs, CXNN included. Every packet carries the sender's input_delay
+// and packets from a peer configured with another one are ignored, so such
+// a session stalls and reports ConfigMismatch() instead of drifting apart.
+class RollbackSession {
+public:
+    RollbackSession(const Chip8& start, NetplayTransport& transport, const RollbackConfig& config = {});
+
+    // Schedules local_keys for frame Frame() + input_delay, exchanges input
+    // with the peer, rolls back if needed and runs one frame. Returns false,
+    // having run nothing, while the peer is max_rollback frames behind; the
+    // same call should be repeated on the next tick.
+    bool AdvanceFrame(uint16_t local_keys);
+
+    // Exchanges input and corrects mispredictions without running a new
+    // frame, e.g. while paused or once the local side has stopped.
+    void Poll();
+
+    const Chip8& State() const { return chip8; }
+    // frames run so far
+    uint64_t Frame() const { return frame; }
+    // frames whose inputs are all known; their state will not change again
+    uint64_t ConfirmedFrame() const { return std::min(frame, remote_count); }
+
+    uint64_t Rollbacks() const { return rollbacks; }
+    uint64_t ResimulatedFrames() const { return resimulated_frames; }
+    // longest single restore-and-resimulate, for checking the frame budget
+    uint64_t MaxRollbackNanoseconds() const { return max_rollback_ns; }
+    uint64_t Stalls() const { return stalls; }
+    // a packet arrived from a peer with a different input_delay
+    bool ConfigMismatch() const { return config_mismatch; }
+
+private:
+    // input history; must hold the unacknowledged local window
+    static constexpr std::size_t HISTORY = 256;
+    // longest input run in one packet
+    static constexpr std::size_t MAX_PACKET_INPUTS = 64;
+
+    void Exchange();
+    void Rollback();
+    void RunFrame(uint64_t f);
+
+    Chip8 chip8;
+    NetplayTransport& transport;
+    RollbackConfig config;
+
+    // snapshots[f % size] is the state at the start of frame f
+    std::vector<Chip8> snapshots;
+
+    uint16_t local_input[HISTORY]{};
+    uint16_t remote_input[HISTORY]{};
+    // remote input each simulated frame actually used, predicted or not
+    uint16_t used_remote[HISTORY]{};
+    // keypad the instance saw in each frame
+    uint16_t combined[HISTORY]{};
+
+    uint64_t frame{};
+    uint64_t local_count{};   // local inputs scheduled
+    uint64_t remote_count{};  // remote inputs received, in order
+    uint64_t peer_ack{};      // local inputs the peer has received
+    uint64_t first_wrong{UINT64_MAX};
+
+    uint64_t rollbacks{};
+    uint64_t resimulated_frames{};
+    uint64_t max_rollback_ns{};
+    uint64_t stalls{};
+    bool config_mismatch{};
+};
+
+#endif //CHIP_8_NETPLAY_H
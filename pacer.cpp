@@ -0,0 +1,111 @@
+#include "pacer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+
+#ifdef _WIN32
+#include <chrono>
+#include <thread>
+#endif
+
+namespace {
+
+constexpr int64_t NS_PER_SECOND = 1000000000;
+constexpr int64_t MIN_SPIN_NS = 20000;
+constexpr int64_t MAX_SPIN_NS = 1000000;
+
+// governor thresholds on the smoothed load
+constexpr double LOAD_HIGH = 0.9;
+constexpr double LOAD_LOW = 0.6;
+constexpr double LOAD_SMOOTHING = 0.1;
+
+int64_t Now() {
+#ifdef _WIN32
+    // steady_clock is QueryPerformanceCounter on MSVC and MinGW
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+#endif
+}
+
+void SleepUntil(int64_t deadline) {
+#ifdef _WIN32
+    // deadlines are on the steady_clock timeline, see Now()
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+#else
+    timespec ts{};
+    ts.tv_sec = deadline / NS_PER_SECOND;
+    ts.tv_nsec = deadline % NS_PER_SECOND;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#endif
+}
+
+}
+
+FramePacer::FramePacer(unsigned int instructions_per_frame, unsigned int min_instructions_per_frame, double hz)
+    : period_ns(static_cast<int64_t>(NS_PER_SECOND / hz)), next_deadline(Now() + period_ns),
+      spin_ns(MIN_SPIN_NS * 5), target_instructions(instructions_per_frame),
+      min_instructions(std::min(min_instructions_per_frame, instructions_per_frame)),
+      instructions_per_frame(instructions_per_frame) {
+    last_wake = next_deadline - period_ns;
+}
+
+uint64_t FramePacer::Wait() {
+    const int64_t work_done = Now();
+    Govern(work_done - last_wake);
+
+    uint64_t elapsed = 1;
+    if (work_done >= next_deadline) {
+        // overran: skip to the next deadline still ahead on the same grid
+        const uint64_t behind = (work_done - next_deadline) / period_ns + 1;
+        next_deadline += behind * period_ns;
+        missed += behind;
+        elapsed += behind;
+    }
+
+    if (next_deadline - work_done > spin_ns) {
+        SleepUntil(next_deadline - spin_ns);
+    }
+
+    int64_t now = Now();
+    if (now > next_deadline) {
+        // the OS overslept past our spin window; widen it
+        spin_ns = std::min(MAX_SPIN_NS, spin_ns * 2);
+    } else {
+        while (now < next_deadline) {
+            now = Now();
+        }
+        spin_ns = std::max(MIN_SPIN_NS, spin_ns - spin_ns / 16);
+    }
+
+    const int64_t late = now - next_deadline;
+    max_late_ns = std::max(max_late_ns, late);
+    total_late_ns += late;
+    ++frames;
+
+    last_wake = now;
+    next_deadline += period_ns;
+    return elapsed;
+}
+
+void FramePacer::Govern(int64_t work_ns) {
+    load += LOAD_SMOOTHING * (static_cast<double>(work_ns) / period_ns - load);
+
+    if (load > LOAD_HIGH && instructions_per_frame > min_instructions) {
+        instructions_per_frame = std::max(min_instructions, instructions_per_frame - instructions_per_frame / 8 - 1);
+        // let the average settle on the new size before adjusting again
+        load = (LOAD_HIGH + LOAD_LOW) / 2;
+    } else if (load < LOAD_LOW && instructions_per_frame < target_instructions) {
+        ++instructions_per_frame;
+    }
+}
+
+FramePacer::Stats FramePacer::GetStats() const {
+    return {frames, missed, max_late_ns, frames ? total_late_ns / static_cast<int64_t>(frames) : 0, load,
+            instructions_per_frame};
+}
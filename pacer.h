@@ -0,0 +1,54 @@
+#ifndef CHIP_8_PACER_H
+#define CHIP_8_PACER_H
+
+#include <cstdint>
+
+// Real-time governor for the run loop. Deadlines sit on a fixed 60 Hz grid
+// anchored at construction, so they never drift. Wait() sleeps with an
+// absolute clock_nanosleep until shortly before the deadline and spins only
+// for the last stretch; the spin window tracks how late the OS wakes us.
+//
+// If the host falls behind, Wait() reports how many frame periods passed so
+// the caller can tick the 60 Hz timers for the missed frames, and the
+// governor trims instructions per frame until the work fits the budget again.
+class FramePacer {
+public:
+    struct Stats {
+        uint64_t frames;
+        uint64_t missed;
+        int64_t max_late_ns;
+        int64_t mean_late_ns;
+        double load;            // smoothed fraction of the frame spent working
+        unsigned int instructions_per_frame;
+    };
+
+    explicit FramePacer(unsigned int instructions_per_frame, unsigned int min_instructions_per_frame = 1,
+                        double hz = 60.0);
+
+    // Blocks until the next deadline; returns the number of frame periods
+    // elapsed since the previous call (1 unless frames were missed).
+    uint64_t Wait();
+
+    unsigned int InstructionsPerFrame() const { return instructions_per_frame; }
+    Stats GetStats() const;
+
+private:
+    void Govern(int64_t work_ns);
+
+    int64_t period_ns;
+    int64_t next_deadline;
+    int64_t last_wake{};
+    int64_t spin_ns;
+
+    unsigned int target_instructions;
+    unsigned int min_instructions;
+    unsigned int instructions_per_frame;
+
+    uint64_t frames{};
+    uint64_t missed{};
+    int64_t max_late_ns{};
+    int64_t total_late_ns{};
+    double load{};
+};
+
+#endif //CHIP_8_PACER_H
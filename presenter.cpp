@@ -0,0 +1,40 @@
+#include "presenter.h"
+
+#include <cstring>
+
+Presenter::Presenter(unsigned int scale, uint32_t on_color, uint32_t off_color, Sink sink)
+    : scale(scale), upscaler({off_color, on_color}), sink(std::move(sink)),
+      output(VIDEO_WIDTH * scale * VIDEO_HEIGHT * scale), thread(&Presenter::RenderLoop, this) {}
+
+Presenter::~Presenter() {
+    running.store(false, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_one();
+    thread.join();
+}
+
+void Presenter::Publish(const uint32_t* video, uint64_t frame) {
+    VideoFrame& back = frames.Back();
+    back.number = frame;
+    std::memcpy(back.pixels, video, sizeof(back.pixels));
+    frames.Publish();
+
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_one();
+}
+
+void Presenter::RenderLoop() {
+    uint32_t seen = 0;
+
+    while (running.load(std::memory_order_relaxed)) {
+        generation.wait(seen, std::memory_order_acquire);
+        seen = generation.load(std::memory_order_acquire);
+
+        if (frames.Update()) {
+            const unsigned int width = VIDEO_WIDTH * scale;
+            const unsigned int height = VIDEO_HEIGHT * scale;
+            upscaler.Scale(frames.Front().pixels, VIDEO_WIDTH, VIDEO_HEIGHT, output.data(), width, height, width);
+            sink(output.data(), width, height, frames.Front().number);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef CHIP_8_PRESENTER_H
+#define CHIP_8_PRESENTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+#include "triple_buffer.h"
+#include "upscale.h"
+
+struct VideoFrame {
+    uint64_t number;
+    uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
+};
+
+// Hands finished frames from the emulation thread to a render thread. The
+// emulation side only copies `video` into a triple buffer; palette conversion,
+// scaling and the sink call all happen on the render thread, so a slow display
+// never stalls the interpreter. Frames the display cannot keep up with are
+// dropped, always keeping the newest.
+class Presenter {
+public:
+    // Receives RGBA8888 pixels of size width x height.
+    using Sink = std::function<void(const uint32_t* rgba, unsigned int width, unsigned int height, uint64_t frame)>;
+
+    Presenter(unsigned int scale, uint32_t on_color, uint32_t off_color, Sink sink);
+    ~Presenter();
+
+    Presenter(const Presenter&) = delete;
+    Presenter& operator=(const Presenter&) = delete;
+
+    // Emulation thread; never blocks.
+    void Publish(const uint32_t* video, uint64_t frame);
+
+    uint64_t Dropped() const { return frames.Dropped(); }
+
+private:
+    void RenderLoop();
+
+    TripleBuffer<VideoFrame> frames;
+    std::atomic<uint32_t> generation{0};
+    std::atomic<bool> running{true};
+
+    unsigned int scale;
+    Upscaler upscaler;
+    Sink sink;
+    std::vector<uint32_t> output;
+
+    std::thread thread;
+};
+
+#endif //CHIP_8_PRESENTER_H
@@ -0,0 +1,251 @@
+#include "ram_search.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHIP8_HAVE_AVX2 1
+#include <immintrin.h>
+#else
+#define CHIP8_HAVE_AVX2 0
+#endif
+
+namespace {
+
+constexpr char MAGIC[4] = {'C', '8', 'R', 'S'};
+constexpr uint8_t FORMAT_VERSION = 1;
+
+bool Passes(SearchFilter filter, uint8_t now, uint8_t before, uint8_t operand) {
+    switch (filter) {
+        case SearchFilter::EqualTo: return now == operand;
+        case SearchFilter::NotEqualTo: return now != operand;
+        case SearchFilter::Unchanged: return now == before;
+        case SearchFilter::Changed: return now != before;
+        case SearchFilter::Increased: return now > before;
+        case SearchFilter::Decreased: return now < before;
+        case SearchFilter::ChangedBy: return now == static_cast<uint8_t>(before + operand);
+    }
+    return false;
+}
+
+void FilterScalar(const uint8_t* now, const uint8_t* before, uint32_t* candidates, std::size_t words,
+                  SearchFilter filter, uint8_t operand) {
+    for (std::size_t word = 0; word < words; ++word) {
+        for (uint32_t bits = candidates[word]; bits; bits &= bits - 1) {
+            const unsigned int bit = __builtin_ctz(bits);
+            const std::size_t address = word * 32 + bit;
+            if (!Passes(filter, now[address], before[address], operand)) {
+                candidates[word] &= ~(1u << bit);
+            }
+        }
+    }
+}
+
+#if CHIP8_HAVE_AVX2
+
+__attribute__((target("avx2")))
+void FilterAvx2(const uint8_t* now, const uint8_t* before, uint32_t* candidates, std::size_t words,
+                SearchFilter filter, uint8_t operand) {
+    const __m256i value = _mm256_set1_epi8(static_cast<char>(operand));
+    const __m256i ones = _mm256_set1_epi8(-1);
+
+    for (std::size_t word = 0; word < words; ++word) {
+        if (!candidates[word]) {
+            continue;
+        }
+        const __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(now + word * 32));
+        const __m256i b = _mm256_load_si256(reinterpret_cast<const __m256i*>(before + word * 32));
+
+        __m256i pass;
+        switch (filter) {
+            case SearchFilter::EqualTo: pass = _mm256_cmpeq_epi8(a, value); break;
+            case SearchFilter::NotEqualTo: pass = _mm256_xor_si256(_mm256_cmpeq_epi8(a, value), ones); break;
+            case SearchFilter::Unchanged: pass = _mm256_cmpeq_epi8(a, b); break;
+            case SearchFilter::Changed: pass = _mm256_xor_si256(_mm256_cmpeq_epi8(a, b), ones); break;
+            // unsigned a > b: max(a, b) is a and they differ
+            case SearchFilter::Increased:
+                pass = _mm256_andnot_si256(_mm256_cmpeq_epi8(a, b), _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a));
+                break;
+            case SearchFilter::Decreased:
+                pass = _mm256_andnot_si256(_mm256_cmpeq_epi8(a, b), _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a));
+                break;
+            case SearchFilter::ChangedBy: pass = _mm256_cmpeq_epi8(a, _mm256_add_epi8(b, value)); break;
+            default: pass = _mm256_setzero_si256(); break;
+        }
+        candidates[word] &= static_cast<uint32_t>(_mm256_movemask_epi8(pass));
+    }
+}
+
+bool HostHasAvx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+bool HostHasAvx2() {
+    return false;
+}
+
+#endif
+
+}
+
+RamSearch::RamSearch(const Chip8& chip8) : use_avx2(HostHasAvx2()) {
+    Reset(chip8);
+}
+
+void RamSearch::Capture(const Chip8& chip8, uint8_t* out) {
+    std::memcpy(out, chip8.Memory(), RAM_SEARCH_REGISTERS);
+    std::memcpy(out + RAM_SEARCH_REGISTERS, chip8.Registers(), 16);
+}
+
+void RamSearch::Reset(const Chip8& chip8) {
+    Capture(chip8, snapshot);
+    // padding past V0-VF is never a candidate
+    std::fill(std::begin(candidates), std::end(candidates), 0xFFFFFFFFu);
+    candidates[RAM_SEARCH_SIZE / 32] = (1u << (RAM_SEARCH_SIZE % 32)) - 1;
+}
+
+std::size_t RamSearch::Filter(const Chip8& chip8, SearchFilter filter, uint8_t operand) {
+    Capture(chip8, current);
+#if CHIP8_HAVE_AVX2
+    if (use_avx2) {
+        FilterAvx2(current, snapshot, candidates, WORDS, filter, operand);
+    } else
+#endif
+    {
+        FilterScalar(current, snapshot, candidates, WORDS, filter, operand);
+    }
+    std::memcpy(snapshot, current, RAM_SEARCH_SIZE);
+    return Count();
+}
+
+std::size_t RamSearch::Count() const {
+    std::size_t count = 0;
+    for (const uint32_t word : candidates) {
+        count += __builtin_popcount(word);
+    }
+    return count;
+}
+
+bool RamSearch::IsCandidate(uint16_t address) const {
+    return address < RAM_SEARCH_SIZE && (candidates[address / 32] >> (address % 32)) & 1u;
+}
+
+std::vector<uint16_t> RamSearch::Candidates(std::size_t limit) const {
+    std::vector<uint16_t> out;
+    for (std::size_t word = 0; word < WORDS && out.size() < limit; ++word) {
+        for (uint32_t bits = candidates[word]; bits && out.size() < limit; bits &= bits - 1) {
+            out.push_back(static_cast<uint16_t>(word * 32 + __builtin_ctz(bits)));
+        }
+    }
+    return out;
+}
+
+void RamSearch::Freeze(uint16_t address, uint8_t value) {
+    if (address >= RAM_SEARCH_SIZE) {
+        return;
+    }
+    auto it = std::lower_bound(frozen.begin(), frozen.end(), address,
+                               [](const Frozen& entry, uint16_t key) { return entry.address < key; });
+    if (it != frozen.end() && it->address == address) {
+        it->value = value;
+    } else {
+        frozen.insert(it, {address, value});
+    }
+}
+
+void RamSearch::Unfreeze(uint16_t address) {
+    frozen.erase(std::remove_if(frozen.begin(), frozen.end(),
+                                [&](const Frozen& entry) { return entry.address == address; }),
+                 frozen.end());
+}
+
+void RamSearch::ApplyFreezes(Chip8& chip8) const {
+    if (frozen.empty()) {
+        return;
+    }
+    chip8.observe_lock.BeginWrite();
+    for (const Frozen& entry : frozen) {
+        if (entry.address < RAM_SEARCH_REGISTERS) {
+            chip8.memory[entry.address] = entry.value;
+        } else {
+            chip8.registers[entry.address - RAM_SEARCH_REGISTERS] = entry.value;
+        }
+    }
+    chip8.observe_lock.EndWrite();
+}
+
+// Saved search, little endian:
+//   "C8RS"  u8 version  candidate bits (RAM_SEARCH_SIZE / 8 bytes)
+//   snapshot (RAM_SEARCH_SIZE bytes)  u16 frozen count  (u16 address, u8 value)...
+bool RamSearch::Save(const char* path) const {
+    std::vector<uint8_t> bytes(MAGIC, MAGIC + sizeof(MAGIC));
+    bytes.push_back(FORMAT_VERSION);
+    for (std::size_t i = 0; i < RAM_SEARCH_SIZE / 8; ++i) {
+        bytes.push_back(static_cast<uint8_t>(candidates[i / 4] >> (8 * (i % 4))));
+    }
+    bytes.insert(bytes.end(), snapshot, snapshot + RAM_SEARCH_SIZE);
+    bytes.push_back(static_cast<uint8_t>(frozen.size()));
+    bytes.push_back(static_cast<uint8_t>(frozen.size() >> 8));
+    for (const Frozen& entry : frozen) {
+        bytes.insert(bytes.end(), {static_cast<uint8_t>(entry.address), static_cast<uint8_t>(entry.address >> 8),
+                                   entry.value});
+    }
+
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return std::fclose(file) == 0 && written;
+}
+
+bool RamSearch::Load(const char* path) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t chunk[4096];
+    for (std::size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) > 0;) {
+        bytes.insert(bytes.end(), chunk, chunk + read);
+    }
+    std::fclose(file);
+
+    constexpr std::size_t FIXED = sizeof(MAGIC) + 1 + RAM_SEARCH_SIZE / 8 + RAM_SEARCH_SIZE + 2;
+    if (bytes.size() < FIXED || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0 ||
+        bytes[sizeof(MAGIC)] != FORMAT_VERSION) {
+        return false;
+    }
+    const std::size_t frozen_count = bytes[FIXED - 2] | (bytes[FIXED - 1] << 8u);
+    if (bytes.size() != FIXED + 3 * frozen_count) {
+        return false;
+    }
+
+    const uint8_t* in = bytes.data() + sizeof(MAGIC) + 1;
+    std::fill(std::begin(candidates), std::end(candidates), 0u);
+    for (std::size_t i = 0; i < RAM_SEARCH_SIZE / 8; ++i) {
+        candidates[i / 4] |= static_cast<uint32_t>(in[i]) << (8 * (i % 4));
+    }
+    in += RAM_SEARCH_SIZE / 8;
+    std::memcpy(snapshot, in, RAM_SEARCH_SIZE);
+    in += RAM_SEARCH_SIZE + 2;
+
+    frozen.clear();
+    for (std::size_t i = 0; i < frozen_count; ++i, in += 3) {
+        Freeze(static_cast<uint16_t>(in[0] | (in[1] << 8u)), in[2]);
+    }
+    return true;
+}
+
+std::string RamSearch::AddressName(uint16_t address) {
+    char name[8];
+    if (address >= RAM_SEARCH_REGISTERS) {
+        std::snprintf(name, sizeof(name), "V%X", (address - RAM_SEARCH_REGISTERS) & 0xFu);
+    } else {
+        std::snprintf(name, sizeof(name), "0x%03X", address);
+    }
+    return name;
+}
@@ -0,0 +1,95 @@
+#ifndef CHIP_8_RAM_SEARCH_H
+#define CHIP_8_RAM_SEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+
+// Search addresses: 0x000-0xFFF are memory, V0-VF follow at 0x1000-0x100F.
+constexpr uint16_t RAM_SEARCH_REGISTERS = 0x1000;
+constexpr std::size_t RAM_SEARCH_SIZE = RAM_SEARCH_REGISTERS + 16;
+
+enum class SearchFilter {
+    EqualTo,     // value == operand
+    NotEqualTo,  // value != operand
+    Unchanged,   // since the last snapshot
+    Changed,
+    Increased,   // unsigned
+    Decreased,
+    ChangedBy,   // value == snapshot + operand, wrapping; 0xFF is -1
+};
+
+// Cheat-engine style search for the bytes that hold a score, lives and the
+// like. The candidate set starts as every address and each Filter() keeps
+// those whose value passes against the last snapshot, then takes a new
+// snapshot, so "increased, increased, unchanged" narrows the set over three
+// stretches of play.
+//
+// Memory and registers are copied side by side into one padded buffer, and
+// each 32-byte block of it maps to one 32-bit word of the candidate bitset.
+// A filter is a couple of AVX2 compares and a movemask per block, ANDed into
+// its word; blocks with no candidates left are skipped. A scalar path covers
+// hosts without AVX2.
+//
+// Frozen addresses are written back by ApplyFreezes(), which the caller runs
+// at each frame boundary. The candidates, snapshot and freezes can be saved
+// and loaded again, to carry a search across sessions.
+class RamSearch {
+public:
+    explicit RamSearch(const Chip8& chip8);
+
+    // All addresses become candidates again and the snapshot is retaken.
+    void Reset(const Chip8& chip8);
+
+    // Retakes the snapshot and keeps the candidates, e.g. after loading a
+    // search into a session that started over.
+    void Rebase(const Chip8& chip8) { Capture(chip8, snapshot); }
+
+    // Returns the number of candidates left.
+    std::size_t Filter(const Chip8& chip8, SearchFilter filter, uint8_t operand = 0);
+
+    std::size_t Count() const;
+    bool IsCandidate(uint16_t address) const;
+    // ascending, at most `limit`
+    std::vector<uint16_t> Candidates(std::size_t limit = SIZE_MAX) const;
+    uint8_t SnapshotValue(uint16_t address) const { return snapshot[address]; }
+
+    // Addresses out of range are ignored.
+    void Freeze(uint16_t address, uint8_t value);
+    void Unfreeze(uint16_t address);
+    // Writes every frozen value into the instance, as one observable update.
+    void ApplyFreezes(Chip8& chip8) const;
+
+    bool Save(const char* path) const;
+    // Leaves the search untouched and returns false if `path` is not a
+    // saved search.
+    bool Load(const char* path);
+
+    bool UsesAvx2() const { return use_avx2; }
+
+    // "0x2F0" or "V3"
+    static std::string AddressName(uint16_t address);
+
+private:
+    // multiple of 32, so every byte is in a whole block
+    static constexpr std::size_t PADDED_SIZE = 4128;
+    static constexpr std::size_t WORDS = PADDED_SIZE / 32;
+
+    struct Frozen {
+        uint16_t address;
+        uint8_t value;
+    };
+
+    static void Capture(const Chip8& chip8, uint8_t* out);
+
+    alignas(32) uint8_t snapshot[PADDED_SIZE]{};
+    alignas(32) uint8_t current[PADDED_SIZE]{};
+    uint32_t candidates[WORDS]{};
+    std::vector<Frozen> frozen; // sorted by address
+    bool use_avx2;
+};
+
+#endif //CHIP_8_RAM_SEARCH_H
@@ -0,0 +1,313 @@
+// chip8_ramsearch: runs one RAM search script against many ROMs.
+//
+// The script plays each ROM and narrows its candidate addresses, e.g. to
+// find the score: play a while, note the score went up, play on without
+// scoring, and so on. Commands, separated by ';' or newlines:
+//
+//     run N          run N frames with the keys as they are
+//     play N         run N frames pressing random keys
+//     press K        release K     (K is a hex key)
+//     eq V  ne V     value equal / not equal to V
+//     changed  unchanged  increased  decreased
+//     by D           value changed by D since the last filter (-1 etc.)
+//     reset          every address is a candidate again
+//     freeze A V     unfreeze A    (A is 0x2F0 or V3; applied every frame)
+//
+// ROMs are spread over worker threads. Each prints one JSON line with its
+// surviving candidates, in argument order. With -save each ROM's search is
+// written to <dir>/<name>.ramsearch, and -load resumes from there: the
+// candidates and freezes carry over, while the ROM starts from power-on and
+// the next filter compares against that. <name> is the file name for a ROM
+// given directly and the path below the directory for one found in a
+// directory, so ROMs that share a file name keep separate searches.
+//
+// usage: chip8_ramsearch (-e SCRIPT | -script FILE) [-ipf N] [-seed S] [-limit N] [-threads T] [-load DIR] [-save DIR] <rom or directory>...
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ram_search.h"
+#include "rom_batch.h"
+
+namespace {
+
+enum class Op { Run, Play, Press, Release, Filter, Reset, Freeze, Unfreeze };
+
+struct Command {
+    Op op;
+    SearchFilter filter{};
+    unsigned int count{};
+    uint16_t address{};
+    uint8_t value{};
+};
+
+bool ParseAddress(const std::string& text, uint16_t& address) {
+    char* end = nullptr;
+    if (text.size() == 2 && (text[0] == 'V' || text[0] == 'v')) {
+        const unsigned long reg = std::strtoul(text.c_str() + 1, &end, 16);
+        address = static_cast<uint16_t>(RAM_SEARCH_REGISTERS + reg);
+        return *end == '\0';
+    }
+    const unsigned long value = std::strtoul(text.c_str(), &end, 0);
+    address = static_cast<uint16_t>(value);
+    return !text.empty() && *end == '\0' && value < RAM_SEARCH_REGISTERS;
+}
+
+bool ParseNumber(const std::string& text, long low, long high, long& value) {
+    char* end = nullptr;
+    value = std::strtol(text.c_str(), &end, 0);
+    return !text.empty() && *end == '\0' && value >= low && value <= high;
+}
+
+bool ParseScript(const std::string& script, std::vector<Command>& commands) {
+    std::string text = script;
+    std::replace(text.begin(), text.end(), ';', '\n');
+    std::istringstream lines(text);
+    for (std::string line; std::getline(lines, line);) {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string name;
+        std::string a;
+        std::string b;
+        if (!(words >> name)) {
+            continue;
+        }
+        words >> a >> b;
+
+        static const std::pair<const char*, SearchFilter> FILTERS[] = {
+            {"eq", SearchFilter::EqualTo},          {"ne", SearchFilter::NotEqualTo},
+            {"unchanged", SearchFilter::Unchanged}, {"changed", SearchFilter::Changed},
+            {"increased", SearchFilter::Increased}, {"decreased", SearchFilter::Decreased},
+            {"by", SearchFilter::ChangedBy},
+        };
+        const auto filter = std::find_if(std::begin(FILTERS), std::end(FILTERS),
+                                         [&](const auto& entry) { return name == entry.first; });
+
+        Command command{};
+        long number = 0;
+        bool ok = true;
+        if (filter != std::end(FILTERS)) {
+            command.op = Op::Filter;
+            command.filter = filter->second;
+            if (name == "eq" || name == "ne") {
+                ok = ParseNumber(a, 0, 255, number);
+            } else if (name == "by") {
+                ok = ParseNumber(a, -255, 255, number);
+            }
+            command.value = static_cast<uint8_t>(number);
+        } else if (name == "run" || name == "play") {
+            command.op = name == "run" ? Op::Run : Op::Play;
+            ok = ParseNumber(a, 0, 1 << 24, number);
+            command.count = static_cast<unsigned int>(number);
+        } else if (name == "press" || name == "release") {
+            command.op = name == "press" ? Op::Press : Op::Release;
+            ok = ParseNumber("0x" + a, 0, 15, number) && !a.empty();
+            command.value = static_cast<uint8_t>(number);
+        } else if (name == "reset") {
+            command.op = Op::Reset;
+        } else if (name == "freeze") {
+            command.op = Op::Freeze;
+            ok = ParseAddress(a, command.address) && ParseNumber(b, 0, 255, number);
+            command.value = static_cast<uint8_t>(number);
+        } else if (name == "unfreeze") {
+            command.op = Op::Unfreeze;
+            ok = ParseAddress(a, command.address);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "bad command: %s\n", line.c_str());
+            return false;
+        }
+        commands.push_back(command);
+    }
+    return true;
+}
+
+std::string JsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (const char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            quoted += '\\';
+            quoted += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(ch));
+            quoted += escape;
+        } else {
+            quoted += ch;
+        }
+    }
+    return quoted + "\"";
+}
+
+struct Options {
+    unsigned int instructions = 11;
+    uint64_t seed = 1;
+    std::size_t limit = 16;
+    std::filesystem::path load;
+    std::filesystem::path save;
+};
+
+struct Result {
+    std::string json;
+    uint64_t filters{};
+    bool ok{};
+};
+
+Result Search(const RomFile& rom, const std::vector<Command>& commands, const Options& options) {
+    Result result;
+    Chip8 chip8(options.seed, 0);
+    if (!chip8.LoadROM(rom.path.string().c_str())) {
+        return result;
+    }
+
+    RamSearch search(chip8);
+    const std::filesystem::path saved = rom.name.string() + ".ramsearch";
+    if (!options.load.empty()) {
+        if (search.Load((options.load / saved).string().c_str())) {
+            search.Rebase(chip8);
+        } else {
+            std::fprintf(stderr, "no saved search for %s, starting over\n", rom.path.string().c_str());
+        }
+    }
+
+    CounterRng rng{CounterRng::key_for(options.seed, 0), 0};
+    uint16_t keys = 0;
+    auto run = [&](unsigned int frames, bool random) {
+        for (unsigned int frame = 0; frame < frames; ++frame) {
+            // hold each random key for about eight frames
+            const uint8_t roll = rng.next_byte();
+            if (random && roll < 32) {
+                const uint8_t key = roll & 0xFu;
+                keys ^= static_cast<uint16_t>(1u << key);
+                chip8.SetKey(key, (keys >> key) & 1u);
+            }
+            search.ApplyFreezes(chip8);
+            chip8.RunFrame(options.instructions);
+        }
+    };
+
+    for (const Command& command : commands) {
+        switch (command.op) {
+            case Op::Run: run(command.count, false); break;
+            case Op::Play: run(command.count, true); break;
+            case Op::Press:
+            case Op::Release:
+                keys = static_cast<uint16_t>((keys & ~(1u << command.value)) |
+                                             ((command.op == Op::Press ? 1u : 0u) << command.value));
+                chip8.SetKey(command.value, command.op == Op::Press);
+                break;
+            case Op::Filter:
+                search.Filter(chip8, command.filter, command.value);
+                ++result.filters;
+                break;
+            case Op::Reset: search.Reset(chip8); break;
+            case Op::Freeze: search.Freeze(command.address, command.value); break;
+            case Op::Unfreeze: search.Unfreeze(command.address); break;
+        }
+    }
+
+    if (!options.save.empty()) {
+        const std::filesystem::path path = options.save / saved;
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        if (!search.Save(path.string().c_str())) {
+            std::fprintf(stderr, "cannot save %s\n", path.string().c_str());
+        }
+    }
+
+    std::ostringstream json;
+    json << "{\"rom\":" << JsonString(rom.path.string()) << ",\"candidates\":" << search.Count() << ",\"addresses\":[";
+    const std::vector<uint16_t> addresses = search.Candidates(options.limit);
+    for (std::size_t i = 0; i < addresses.size(); ++i) {
+        json << (i ? "," : "") << "{\"address\":\"" << RamSearch::AddressName(addresses[i])
+             << "\",\"value\":" << static_cast<unsigned int>(search.SnapshotValue(addresses[i])) << "}";
+    }
+    json << "]}\n";
+    result.json = json.str();
+    result.ok = true;
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string script;
+    Options options;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<RomFile> roms;
+    bool usage = false;
+    uint64_t value = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-e" && i + 1 < argc) {
+            script += std::string(argv[++i]) + "\n";
+        } else if (arg == "-script" && i + 1 < argc) {
+            std::ifstream file(argv[++i]);
+            if (!file) {
+                std::fprintf(stderr, "cannot open %s\n", argv[i]);
+                return 2;
+            }
+            std::ostringstream text;
+            text << file.rdbuf();
+            script += text.str() + "\n";
+        } else if (arg == "-ipf" && i + 1 < argc) {
+            usage |= !ParseUnsigned(argv[++i], UINT_MAX, value);
+            options.instructions = static_cast<unsigned int>(value);
+        } else if (arg == "-seed" && i + 1 < argc) {
+            usage |= !ParseUnsigned(argv[++i], UINT64_MAX, options.seed);
+        } else if (arg == "-limit" && i + 1 < argc) {
+            usage |= !ParseUnsigned(argv[++i], SIZE_MAX, value);
+            options.limit = static_cast<std::size_t>(value);
+        } else if (arg == "-threads" && i + 1 < argc) {
+            usage |= !ParseUnsigned(argv[++i], MAX_THREADS, value);
+            threads = std::max(1u, static_cast<unsigned int>(value));
+        } else if (arg == "-load" && i + 1 < argc) {
+            options.load = argv[++i];
+        } else if (arg == "-save" && i + 1 < argc) {
+            options.save = argv[++i];
+        } else {
+            CollectRoms(argv[i], roms);
+        }
+    }
+    std::vector<Command> commands;
+    if (usage || roms.empty() || !ParseScript(script, commands)) {
+        std::fprintf(stderr,
+                     "usage: %s (-e SCRIPT | -script FILE) [-ipf N] [-seed S] [-limit N] [-threads T] "
+                     "[-load DIR] [-save DIR] <rom or directory>...\n",
+                     argv[0]);
+        return 2;
+    }
+    if ((!options.save.empty() || !options.load.empty()) && !UniqueNames(roms, ".ramsearch")) {
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Result> results(roms.size());
+    ForEachRom(roms.size(), threads, [&](std::size_t i) { results[i] = Search(roms[i], commands, options); });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t failed = 0;
+    uint64_t filters = 0;
+    for (std::size_t i = 0; i < roms.size(); ++i) {
+        if (!results[i].ok) {
+            std::fprintf(stderr, "cannot open %s\n", roms[i].path.string().c_str());
+            ++failed;
+            continue;
+        }
+        filters += results[i].filters;
+        std::fwrite(results[i].json.data(), 1, results[i].json.size(), stdout);
+    }
+    std::fprintf(stderr, "%zu ROMs, %llu filters in %.3f s\n", roms.size() - failed,
+                 static_cast<unsigned long long>(filters), seconds);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+#include "recorder.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr unsigned int RECORD_FPS = 60;
+
+uint64_t HashFrame(const uint8_t* bits, std::size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bits + i, sizeof(word));
+        hash = CounterRng::mix(hash ^ word);
+    }
+    return hash;
+}
+
+void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+}
+
+Recorder::~Recorder() {
+    Close();
+}
+
+bool Recorder::Open(const char* path, RecordFormat record_format) {
+    Close();
+
+    file = std::fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+    format = record_format;
+    previous_hash = 0;
+    pending_repeats = 0;
+    frames.store(0, std::memory_order_relaxed);
+    repeats.store(0, std::memory_order_relaxed);
+    stalls.store(0, std::memory_order_relaxed);
+
+    scratch.clear();
+    if (format == RecordFormat::Y4M) {
+        std::fprintf(file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 Cmono\n", VIDEO_WIDTH, VIDEO_HEIGHT, RECORD_FPS);
+    } else {
+        scratch.insert(scratch.end(), {'C', '8', 'R', 'L'});
+        PutU16(scratch, VIDEO_WIDTH);
+        PutU16(scratch, VIDEO_HEIGHT);
+        PutU16(scratch, RECORD_FPS);
+        std::fwrite(scratch.data(), 1, scratch.size(), file);
+    }
+
+    running.store(true, std::memory_order_relaxed);
+    thread = std::thread(&Recorder::EncodeLoop, this);
+    return true;
+}
+
+bool Recorder::Submit(const uint32_t* video) {
+    // with no encoder to drain the queue the push below would spin forever
+    if (!thread.joinable()) {
+        return false;
+    }
+
+    PackedFrame packed;
+    pack_video_bits(video, packed.bits);
+
+    while (!queue.Push(packed)) {
+        stalls.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_one();
+    return true;
+}
+
+void Recorder::Close() {
+    if (!thread.joinable()) {
+        return;
+    }
+
+    running.store(false, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_one();
+    thread.join();
+
+    std::fclose(file);
+    file = nullptr;
+}
+
+void Recorder::EncodeLoop() {
+    uint32_t seen = 0;
+
+    for (;;) {
+        const bool draining = !running.load(std::memory_order_relaxed);
+
+        PackedFrame frame;
+        while (queue.Pop(frame)) {
+            Encode(frame);
+        }
+
+        if (draining) {
+            break;
+        }
+
+        generation.wait(seen, std::memory_order_acquire);
+        seen = generation.load(std::memory_order_acquire);
+    }
+
+    FlushRepeats();
+}
+
+void Recorder::Encode(const PackedFrame& frame) {
+    const uint64_t frame_number = frames.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    const uint64_t hash = HashFrame(frame.bits, PACKED_SIZE);
+    const bool repeat = frame_number > 1 && hash == previous_hash &&
+                        std::memcmp(frame.bits, previous.bits, PACKED_SIZE) == 0;
+
+    if (repeat) {
+        repeats.fetch_add(1, std::memory_order_relaxed);
+        if (format == RecordFormat::RLE) {
+            ++pending_repeats;
+        } else {
+            // Y4M has no repeat marker; the previous frame is still in scratch
+            std::fwrite(scratch.data(), 1, scratch.size(), file);
+        }
+        return;
+    }
+
+    previous = frame;
+    previous_hash = hash;
+
+    if (format == RecordFormat::Y4M) {
+        WriteY4M(frame);
+    } else {
+        FlushRepeats();
+        WriteRLE(frame);
+    }
+}
+
+void Recorder::WriteY4M(const PackedFrame& frame) {
+    static constexpr char FRAME_HEADER[] = "FRAME\n";
+
+    scratch.assign(FRAME_HEADER, FRAME_HEADER + sizeof(FRAME_HEADER) - 1);
+    for (std::size_t i = 0; i < PACKED_SIZE; ++i) {
+        for (unsigned int bit = 0; bit < 8; ++bit) {
+            // studio-swing luma: 16 black, 235 white
+            scratch.push_back(frame.bits[i] & (0x80u >> bit) ? 235 : 16);
+        }
+    }
+    std::fwrite(scratch.data(), 1, scratch.size(), file);
+}
+
+void Recorder::WriteRLE(const PackedFrame& frame) {
+    scratch.assign(1, 'F');
+
+    bool value = false;
+    uint64_t run = 0;
+    for (std::size_t i = 0; i < PACKED_SIZE; ++i) {
+        for (unsigned int bit = 0; bit < 8; ++bit) {
+            const bool pixel = frame.bits[i] & (0x80u >> bit);
+            if (pixel != value) {
+                PutVarint(scratch, run);
+                value = pixel;
+                run = 0;
+            }
+            ++run;
+        }
+    }
+    PutVarint(scratch, run);
+
+    std::fwrite(scratch.data(), 1, scratch.size(), file);
+}
+
+void Recorder::FlushRepeats() {
+    if (pending_repeats == 0) {
+        return;
+    }
+
+    std::vector<uint8_t> marker{'R'};
+    PutVarint(marker, pending_repeats);
+    std::fwrite(marker.data(), 1, marker.size(), file);
+    pending_repeats = 0;
+}
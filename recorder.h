@@ -0,0 +1,85 @@
+#ifndef CHIP_8_RECORDER_H
+#define CHIP_8_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+#include "spsc_ring.h"
+
+enum class RecordFormat {
+    // YUV4MPEG2, 8-bit mono luma, 60 fps; every frame is written out
+    Y4M,
+    // Lossless run-length stream:
+    //   header  "C8RL" u16 width  u16 height  u16 fps          (little endian)
+    //   'F' varint runs...  pixel runs alternating off/on, starting with off,
+    //                       together covering width * height pixels
+    //   'R' varint count    previous frame repeated count more times
+    // varints are unsigned LEB128.
+    RLE,
+};
+
+// Streams frames to disk from a background encoder thread. The emulation
+// thread only packs `video` to one bit per pixel and pushes it into a bounded
+// lock-free queue; hashing, dedupe, encoding and I/O happen on the encoder.
+// When the queue is full Submit() yields until space frees up rather than
+// losing frames, and counts the stall.
+class Recorder {
+public:
+    Recorder() = default;
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    bool Open(const char* path, RecordFormat format);
+
+    // Emulation thread. Returns false, dropping the frame, if the recorder
+    // is not open.
+    bool Submit(const uint32_t* video);
+
+    // Drains the queue, flushes and closes the file.
+    void Close();
+
+    // safe to read from any thread while recording
+    uint64_t Frames() const { return frames.load(std::memory_order_relaxed); }
+    uint64_t Repeats() const { return repeats.load(std::memory_order_relaxed); }
+    uint64_t Stalls() const { return stalls.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t PACKED_SIZE = VIDEO_PACKED_SIZE;
+    static constexpr std::size_t QUEUE_SIZE = 256;
+
+    struct PackedFrame {
+        uint8_t bits[PACKED_SIZE];
+    };
+
+    void EncodeLoop();
+    void Encode(const PackedFrame& frame);
+    void WriteY4M(const PackedFrame& frame);
+    void WriteRLE(const PackedFrame& frame);
+    void FlushRepeats();
+
+    SpscRing<PackedFrame, QUEUE_SIZE> queue;
+    std::atomic<uint32_t> generation{0};
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    // encoder thread only
+    std::FILE* file{};
+    RecordFormat format{};
+    PackedFrame previous{};
+    uint64_t previous_hash{};
+    uint64_t pending_repeats{};
+    std::vector<uint8_t> scratch;
+
+    // frames and repeats are written by the encoder, stalls by Submit()
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> repeats{0};
+    std::atomic<uint64_t> stalls{0};
+};
+
+#endif //CHIP_8_RECORDER_H
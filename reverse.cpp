@@ -0,0 +1,226 @@
+#include "reverse.h"
+
+#include <algorithm>
+
+ReverseDebugger::ReverseDebugger(Chip8& chip8, Debugger& debugger, unsigned int instructions_per_frame,
+                                 unsigned int interval, std::size_t max_checkpoints)
+    : chip8(chip8), debugger(debugger), instructions_per_frame(instructions_per_frame),
+      interval(std::max(1u, interval)), max_checkpoints(std::max<std::size_t>(2, max_checkpoints)) {}
+
+void ReverseDebugger::SetKey(uint8_t key, bool pressed) {
+    Truncate();
+    pending.push_back({0, key, pressed});
+}
+
+StopReason ReverseDebugger::RunFrame() {
+    StartFrame();
+
+    const StopReason reason = debugger.RunFrame(chip8, instructions_per_frame);
+    if (reason == StopReason::FrameDone || reason == StopReason::WaitingForKey) {
+        EndFrame(debugger.Executed() - frame_start_executed);
+    }
+    return reason;
+}
+
+StopReason ReverseDebugger::Step() {
+    StartFrame();
+
+    if (chip8.WaitingForKey() || debugger.InstructionsIntoFrame() >= instructions_per_frame) {
+        return RunFrame();
+    }
+
+    const StopReason reason = debugger.Step(chip8);
+    if (debugger.InstructionsIntoFrame() >= instructions_per_frame) {
+        // close the frame now so positions never sit past the frame length
+        debugger.RunFrame(chip8, instructions_per_frame);
+        EndFrame(debugger.Executed() - frame_start_executed);
+    }
+    return reason;
+}
+
+bool ReverseDebugger::ReverseStep() {
+    if (checkpoints.empty()) {
+        return false;
+    }
+
+    Position target = Now();
+    if (target.instruction > 0) {
+        --target.instruction;
+    } else {
+        // last instruction of the closest earlier frame that ran any
+        do {
+            if (target.frame == checkpoints.front().frame) {
+                return false;
+            }
+            --target.frame;
+        } while (frame_lengths[target.frame] == 0);
+        target.instruction = frame_lengths[target.frame] - 1;
+    }
+
+    Seek(target);
+    return true;
+}
+
+bool ReverseDebugger::ReverseContinue() {
+    return SeekBackTo([this](const Chip8& state) { return debugger.ShouldBreak(state, state.ProgramCounter()); });
+}
+
+bool ReverseDebugger::RunBackToLastWrite(uint16_t address) {
+    address &= 0xFFFu;
+    return SeekBackTo([address](const Chip8& state) {
+        Debugger::MemoryAccess access{};
+        if (!Debugger::DecodeAccess(state, state.ProgramCounter(), access) || !access.write) {
+            return false;
+        }
+        return static_cast<uint16_t>((address - access.address) & 0xFFFu) < access.length;
+    });
+}
+
+void ReverseDebugger::StartFrame() {
+    if (frame_started) {
+        return;
+    }
+    frame_started = true;
+    frame_start_executed = debugger.Executed() - debugger.InstructionsIntoFrame();
+
+    if (frame < frame_lengths.size()) {
+        // re-executing recorded history: replay what was recorded
+        ApplyKeys(frame);
+    } else {
+        for (RecordedKey& key : pending) {
+            key.frame = frame;
+            keys.push_back(key);
+            chip8.SetKey(key.key, key.pressed);
+        }
+        pending.clear();
+    }
+
+    if (frame % interval == 0 && (checkpoints.empty() || checkpoints.back().frame < frame)) {
+        TakeCheckpoint();
+    }
+}
+
+void ReverseDebugger::EndFrame(uint64_t executed_in_frame) {
+    if (frame < frame_lengths.size()) {
+        frame_lengths[frame] = static_cast<uint32_t>(executed_in_frame);
+    } else {
+        frame_lengths.push_back(static_cast<uint32_t>(executed_in_frame));
+    }
+    ++frame;
+    frame_started = false;
+}
+
+void ReverseDebugger::TakeCheckpoint() {
+    if (checkpoints.size() == max_checkpoints) {
+        // keep the first one so the start of the session stays reachable
+        std::deque<Checkpoint> thinned;
+        for (std::size_t i = 0; i < checkpoints.size(); i += 2) {
+            thinned.push_back(std::move(checkpoints[i]));
+        }
+        checkpoints = std::move(thinned);
+        interval *= 2;
+        if (frame % interval != 0) {
+            return;
+        }
+    }
+    checkpoints.push_back({frame, chip8});
+}
+
+void ReverseDebugger::ApplyKeys(uint64_t at_frame) {
+    auto it = std::lower_bound(keys.begin(), keys.end(), at_frame,
+                               [](const RecordedKey& key, uint64_t f) { return key.frame < f; });
+    for (; it != keys.end() && it->frame == at_frame; ++it) {
+        chip8.SetKey(it->key, it->pressed);
+    }
+}
+
+void ReverseDebugger::Truncate() {
+    if (frame >= frame_lengths.size()) {
+        return;
+    }
+
+    // inputs change from here on, so the recorded future no longer holds;
+    // keys for the current frame stay only if the frame already started
+    const uint64_t keep_keys_until = frame_started ? frame + 1 : frame;
+    keys.erase(std::lower_bound(keys.begin(), keys.end(), keep_keys_until,
+                                [](const RecordedKey& key, uint64_t f) { return key.frame < f; }),
+               keys.end());
+    frame_lengths.resize(frame);
+    // a checkpoint for a frame that has not started yet holds the old keys
+    // for it; drop it so StartFrame takes a fresh one with the new keys
+    const uint64_t keep_checkpoints_until = frame_started ? frame + 1 : frame;
+    while (!checkpoints.empty() && checkpoints.back().frame >= keep_checkpoints_until) {
+        checkpoints.pop_back();
+    }
+}
+
+std::size_t ReverseDebugger::CheckpointFor(Position target) const {
+    std::size_t i = checkpoints.size() - 1;
+    while (i > 0 && checkpoints[i].frame > target.frame) {
+        --i;
+    }
+    return i;
+}
+
+template <typename Visit>
+void ReverseDebugger::Replay(std::size_t checkpoint, Position target, Visit&& visit) {
+    chip8.Restore(checkpoints[checkpoint].state);
+    Position at{checkpoints[checkpoint].frame, 0};
+
+    for (;;) {
+        const uint32_t length = at.frame < target.frame ? frame_lengths[at.frame] : target.instruction;
+        for (; at.instruction < length; ++at.instruction) {
+            visit(static_cast<const Chip8&>(chip8), at);
+            chip8.Cycle();
+        }
+
+        if (at.frame == target.frame) {
+            break;
+        }
+
+        chip8.AdvanceTimers(1);
+        ++at.frame;
+        at.instruction = 0;
+        ApplyKeys(at.frame);
+    }
+}
+
+void ReverseDebugger::Seek(Position target) {
+    Replay(CheckpointFor(target), target, [](const Chip8&, Position) {});
+
+    frame = target.frame;
+    frame_started = true;
+    debugger.Reposition(target.instruction);
+    frame_start_executed = debugger.Executed() - target.instruction;
+}
+
+template <typename Match>
+bool ReverseDebugger::SeekBackTo(Match&& match) {
+    if (checkpoints.empty()) {
+        return false;
+    }
+
+    const Position now = Now();
+    Position limit = now;
+
+    for (std::size_t k = CheckpointFor(now) + 1; k-- > 0;) {
+        bool found = false;
+        Position hit{};
+        Replay(k, limit, [&](const Chip8& state, Position at) {
+            if (match(state)) {
+                found = true;
+                hit = at;
+            }
+        });
+
+        if (found) {
+            Seek(hit);
+            return true;
+        }
+        limit = {checkpoints[k].frame, 0};
+    }
+
+    // nothing earlier: put the session back where it was
+    Seek(now);
+    return false;
+}
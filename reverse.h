@@ -0,0 +1,101 @@
+#ifndef CHIP_8_REVERSE_H
+#define CHIP_8_REVERSE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "chip8.h"
+#include "debugger.h"
+
+// Reverse execution on top of Debugger. Every `interval` frames a full copy of
+// the instance is kept as a checkpoint; going backwards restores the nearest
+// earlier checkpoint and re-executes forward to the target. Re-execution is
+// deterministic because the only outside inputs, key events, are recorded
+// per frame. The RNG needs no log: it is counter-based and its counter is
+// part of the checkpointed state.
+//
+// At most `max_checkpoints` are kept (each is one sizeof(Chip8)). When full,
+// every other checkpoint is dropped and the interval doubles, so the whole
+// session stays reachable with coarser restore points.
+class ReverseDebugger {
+public:
+    // (frame, instructions executed in that frame); frame boundaries sit
+    // after the key events for the frame have been applied
+    struct Position {
+        uint64_t frame;
+        uint32_t instruction;
+
+        auto operator<=>(const Position&) const = default;
+    };
+
+    ReverseDebugger(Chip8& chip8, Debugger& debugger, unsigned int instructions_per_frame,
+                    unsigned int interval = 60, std::size_t max_checkpoints = 256);
+
+    // Key events take effect at the next frame boundary. Posting one while
+    // re-executing the past discards the recorded future.
+    void SetKey(uint8_t key, bool pressed);
+
+    StopReason RunFrame();
+    StopReason Step();
+
+    bool ReverseStep();
+    // Moves back to the most recent earlier point where a breakpoint fires.
+    bool ReverseContinue();
+    // Moves back to just before the most recent instruction that wrote
+    // `address`; one Step() then shows the write.
+    bool RunBackToLastWrite(uint16_t address);
+
+    Position Now() const { return {frame, debugger.InstructionsIntoFrame()}; }
+    std::size_t Checkpoints() const { return checkpoints.size(); }
+
+private:
+    struct Checkpoint {
+        uint64_t frame;
+        Chip8 state;
+    };
+
+    struct RecordedKey {
+        uint64_t frame;
+        uint8_t key;
+        bool pressed;
+    };
+
+    void StartFrame();
+    void EndFrame(uint64_t executed_in_frame);
+    void TakeCheckpoint();
+    void ApplyKeys(uint64_t at_frame);
+    void Truncate();
+
+    // Restores the last checkpoint at or before `target` and re-executes up
+    // to it. `visit` sees every instruction position on the way, before the
+    // instruction runs.
+    template <typename Visit>
+    void Replay(std::size_t checkpoint, Position target, Visit&& visit);
+    void Seek(Position target);
+
+    // Searches backwards, checkpoint by checkpoint, for the latest position
+    // before Now() where `match` holds, and seeks there.
+    template <typename Match>
+    bool SeekBackTo(Match&& match);
+
+    std::size_t CheckpointFor(Position target) const;
+
+    Chip8& chip8;
+    Debugger& debugger;
+    unsigned int instructions_per_frame;
+    unsigned int interval;
+    std::size_t max_checkpoints;
+
+    std::deque<Checkpoint> checkpoints;
+    std::vector<RecordedKey> keys;       // ordered by frame
+    std::vector<uint32_t> frame_lengths; // instructions run in each finished frame
+    std::vector<RecordedKey> pending;
+
+    uint64_t frame{};
+    uint64_t frame_start_executed{};
+    bool frame_started{};
+};
+
+#endif //CHIP_8_REVERSE_H
@@ -0,0 +1,47 @@
+#include "rom_batch.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+void CollectRoms(const std::filesystem::path& path, std::vector<RomFile>& roms) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(path, error)) {
+        roms.push_back({path, path.filename()});
+        return;
+    }
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error)) {
+        if (entry.is_regular_file()) {
+            roms.push_back({entry.path(), entry.path().lexically_relative(path)});
+        }
+    }
+}
+
+bool UniqueNames(const std::vector<RomFile>& roms, const char* suffix) {
+    std::map<std::filesystem::path, const RomFile*> names;
+    for (const RomFile& rom : roms) {
+        const auto [it, added] = names.emplace(rom.name, &rom);
+        if (!added) {
+            std::fprintf(stderr, "%s and %s would share %s%s\n", it->second->path.string().c_str(),
+                         rom.path.string().c_str(), rom.name.string().c_str(), suffix);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ParseUnsigned(const char* text, uint64_t max, uint64_t& value) {
+    // strtoull accepts a sign and wraps negative input around
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long number = std::strtoull(text, &end, 0);
+    if (*end != '\0' || errno == ERANGE || number > max) {
+        return false;
+    }
+    value = number;
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef CHIP_8_ROM_BATCH_H
+#define CHIP_8_ROM_BATCH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "worker_pool.h"
+
+// Shared by the command-line tools that process a corpus of ROMs one at a
+// time: chip8_dis and chip8_ramsearch.
+
+struct RomFile {
+    std::filesystem::path path;
+    // relative to the argument it was found under; names per-ROM output
+    std::filesystem::path name;
+};
+
+// Adds `path` itself, or every regular file below it if it is a directory.
+void CollectRoms(const std::filesystem::path& path, std::vector<RomFile>& roms);
+
+// Two arguments can still bring the same name, e.g. a/x.ch8 and b/x.ch8.
+// Returns false, naming both, if any two ROMs would share <name><suffix>.
+bool UniqueNames(const std::vector<RomFile>& roms, const char* suffix);
+
+// upper bound for -threads
+constexpr uint64_t MAX_THREADS = 1024;
+
+// Parses a whole argument as an unsigned number, decimal or 0x hex, no
+// larger than `max`. Rejects empty, negative and trailing text.
+bool ParseUnsigned(const char* text, uint64_t max, uint64_t& value);
+
+// Calls fn(i) for every ROM index, spread over up to `threads` threads, the
+// caller included.
+template <typename Fn>
+void ForEachRom(std::size_t count, unsigned int threads, const Fn& fn) {
+    WorkerPool pool(static_cast<unsigned int>(std::min<std::size_t>(std::max(1u, threads), count)));
+    pool.Run(count, fn);
+}
+
+#endif //CHIP_8_ROM_BATCH_H
@@ -0,0 +1,89 @@
+#include "runahead.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+RunAheadConfig RunAheadConfigForRom(const char* table, const std::string& rom, RunAheadConfig fallback) {
+    std::ifstream file(table);
+    if (!file) {
+        return fallback;
+    }
+
+    const std::size_t slash = rom.find_last_of('/');
+    const std::string name = slash == std::string::npos ? rom : rom.substr(slash + 1);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string entry;
+        unsigned int frames = 0;
+        if (!(fields >> entry >> frames) || entry != name) {
+            continue;
+        }
+        std::string mode;
+        fields >> mode;
+        return {frames, mode == "second"};
+    }
+    return fallback;
+}
+
+RunAhead::RunAhead(Chip8& chip8, const RunAheadConfig& config) : chip8(chip8), config(config) {
+    if (config.frames && config.second_instance) {
+        ahead = std::make_unique<Chip8>(chip8);
+    } else if (config.frames) {
+        saved = std::make_unique<Chip8>(chip8);
+    }
+}
+
+void RunAhead::SetKey(uint8_t key, bool pressed) {
+    chip8.SetKey(key, pressed);
+    ahead_valid = false;
+}
+
+void RunAhead::AdvanceTimers(uint64_t frames) {
+    if (frames) {
+        chip8.AdvanceTimers(frames);
+        ahead_valid = false;
+    }
+}
+
+void RunAhead::Run(Chip8& instance, unsigned int instructions) {
+    if (probe) {
+        probe->RunFrame(instance, instructions);
+    } else {
+        instance.RunFrame(instructions);
+    }
+}
+
+const uint32_t* RunAhead::RunFrame(unsigned int instructions) {
+    Run(chip8, instructions);
+    if (!config.frames) {
+        return chip8.Video();
+    }
+
+    if (ahead) {
+        if (ahead_valid && ahead_instructions == instructions) {
+            // same inputs as when it last ran ahead: one frame catches up
+            Run(*ahead, instructions);
+        } else {
+            *ahead = chip8;
+            for (unsigned int i = 0; i < config.frames; ++i) {
+                Run(*ahead, instructions);
+            }
+            ahead_valid = true;
+            ahead_instructions = instructions;
+            ++resyncs;
+        }
+        return ahead->Video();
+    }
+
+    *saved = chip8;
+    for (unsigned int i = 0; i < config.frames; ++i) {
+        Run(chip8, instructions);
+    }
+    std::memcpy(video, chip8.Video(), sizeof(video));
+    chip8.Restore(*saved);
+    ++resyncs;
+    return video;
+}
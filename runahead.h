@@ -0,0 +1,79 @@
+#ifndef CHIP_8_RUNAHEAD_H
+#define CHIP_8_RUNAHEAD_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "chip8.h"
+#include "latency_probe.h"
+
+struct RunAheadConfig {
+    // frames emulated past the real one before presenting; 0 disables
+    unsigned int frames = 0;
+    // speculate on a separate instance instead of saving and restoring the
+    // real one
+    bool second_instance = false;
+};
+
+// Looks up the settings for `rom` in a table file, one ROM per line:
+//
+//     # file name      frames  [second]
+//     tetris.ch8       2
+//     brix.ch8         1       second
+//
+// Matching is by file name, ignoring directories. Returns `fallback` when
+// the table cannot be read or has no line for the ROM.
+RunAheadConfig RunAheadConfigForRom(const char* table, const std::string& rom, RunAheadConfig fallback);
+
+// Hides a ROM's own input lag. Many ROMs sample the keypad with Ex9E/ExA1
+// only every few frames, or act on a key a frame or two after reading it.
+// After each real frame, run-ahead emulates `frames` more with the current
+// keypad held and presents the last of those, so a press shows up as soon as
+// the game would react to it. Game logic is untouched: the real instance
+// never runs a speculative frame for keeps.
+//
+// With a single instance every frame costs one save, `frames` extra frames
+// and one Restore(), and observers of the instance may glimpse the
+// speculative state in between. With a second instance the real one is
+// never rewound; while the keypad, timers and frame length are unchanged
+// the speculative instance is already `frames` ahead of the real one on the
+// same inputs, so it only needs one more frame instead of a full resync.
+class RunAhead {
+public:
+    RunAhead(Chip8& chip8, const RunAheadConfig& config);
+
+    // Keypad and timer changes must go through here so the second instance
+    // knows to resync.
+    void SetKey(uint8_t key, bool pressed);
+    void AdvanceTimers(uint64_t frames);
+
+    // Runs one real frame and returns the video to present.
+    const uint32_t* RunFrame(unsigned int instructions);
+
+    // Runs every frame, speculative ones included, through `probe`; null
+    // turns probing off.
+    void SetProbe(LatencyProbe* latency_probe) { probe = latency_probe; }
+
+    uint64_t Resyncs() const { return resyncs; }
+
+private:
+    void Run(Chip8& instance, unsigned int instructions);
+
+    Chip8& chip8;
+    RunAheadConfig config;
+
+    // single instance: the real state while speculating
+    std::unique_ptr<Chip8> saved;
+    // second instance: `frames` ahead of chip8 when in sync
+    std::unique_ptr<Chip8> ahead;
+    bool ahead_valid{};
+    unsigned int ahead_instructions{};
+
+    LatencyProbe* probe{};
+
+    uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT]{};
+    uint64_t resyncs{};
+};
+
+#endif //CHIP_8_RUNAHEAD_H
@@ -0,0 +1,60 @@
+#include "scheduler.h"
+
+Scheduler::Scheduler(unsigned int instructions_per_frame) : instructions_per_frame(instructions_per_frame) {}
+
+std::size_t Scheduler::Add(Chip8* instance) {
+    sessions.emplace_back().instance = instance;
+    runnable.push_back(sessions.size() - 1);
+    return sessions.size() - 1;
+}
+
+void Scheduler::RunFrame() {
+    const uint64_t now = frame.load(std::memory_order_relaxed);
+
+    for (std::size_t session = 0; session < sessions.size(); ++session) {
+        Session& s = sessions[session];
+        if (DrainKeys(s.keys, *s.instance, now) && s.parked && !s.instance->WaitingForKey()) {
+            Resume(session);
+        }
+    }
+
+    for (std::size_t i = 0; i < runnable.size();) {
+        const std::size_t session = runnable[i];
+        Chip8* instance = sessions[session].instance;
+
+        instance->RunFrame(instructions_per_frame);
+
+        if (instance->WaitingForKey()) {
+            // swap-remove keeps the runnable list dense; revisit slot i
+            runnable[i] = runnable.back();
+            runnable.pop_back();
+            Park(session);
+        } else {
+            ++i;
+        }
+    }
+
+    frame.store(now + 1, std::memory_order_release);
+}
+
+bool Scheduler::PostKey(std::size_t session, uint8_t key, bool pressed) {
+    return PostKey(session, {Frame(), key, pressed});
+}
+
+bool Scheduler::PostKey(std::size_t session, const KeyEvent& event) {
+    return sessions[session].keys.Push(event);
+}
+
+void Scheduler::Park(std::size_t session) {
+    // The instance already ticked its timers for the current frame, so the
+    // first frame it sits out is the next one.
+    sessions[session].parked = true;
+    sessions[session].parked_at_frame = frame.load(std::memory_order_relaxed) + 1;
+}
+
+void Scheduler::Resume(std::size_t session) {
+    Session& s = sessions[session];
+    s.instance->AdvanceTimers(frame.load(std::memory_order_relaxed) - s.parked_at_frame);
+    s.parked = false;
+    runnable.push_back(session);
+}
@@ -0,0 +1,54 @@
+#ifndef CHIP_8_SCHEDULER_H
+#define CHIP_8_SCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "chip8.h"
+#include "input.h"
+
+// Runs a fleet of instances frame by frame. An instance that executes Fx0A
+// with no key down is parked: it is dropped from the runnable list and costs
+// nothing until a key event for it arrives. Its timers are not ticked while
+// parked; they are caught up analytically on resume.
+//
+// Key events reach each session through its own lock-free queue and are
+// applied at frame boundaries. Add() must not race with PostKey().
+class Scheduler {
+public:
+    explicit Scheduler(unsigned int instructions_per_frame = 11);
+
+    std::size_t Add(Chip8* instance);
+
+    void RunFrame();
+
+    // Producer side, one thread per session. The first overload stamps the
+    // event with the next frame boundary. Returns false if the queue is full.
+    bool PostKey(std::size_t session, uint8_t key, bool pressed);
+    bool PostKey(std::size_t session, const KeyEvent& event);
+
+    bool Parked(std::size_t session) const { return sessions[session].parked; }
+    std::size_t RunnableCount() const { return runnable.size(); }
+    uint64_t Frame() const { return frame.load(std::memory_order_acquire); }
+
+private:
+    struct Session {
+        Chip8* instance;
+        KeyQueue keys;
+        uint64_t parked_at_frame{};
+        bool parked{};
+    };
+
+    void Park(std::size_t session);
+    void Resume(std::size_t session);
+
+    std::deque<Session> sessions;
+    std::vector<std::size_t> runnable;
+    std::atomic<uint64_t> frame{0};
+    unsigned int instructions_per_frame;
+};
+
+#endif //CHIP_8_SCHEDULER_H
@@ -0,0 +1,55 @@
+#ifndef CHIP_8_SEQLOCK_H
+#define CHIP_8_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+// Sequence lock for one writer and any number of readers. The writer never
+// waits; readers retry until they observe the same even sequence before and
+// after reading. The counter is a plain integer accessed through atomic_ref,
+// so it is address-free and can live in memory shared between processes, and
+// state embedding a lock stays trivially copyable. Copying onto state that
+// readers may be watching must skip the counter (see Chip8::Restore): a
+// restored snapshot must not rewind the sequence observers have seen.
+class SeqLock {
+public:
+    void BeginWrite() {
+        Counter().store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void EndWrite() {
+        Counter().store(sequence + 1, std::memory_order_release);
+    }
+
+    // Calls fn() until it ran without overlapping a write.
+    template <typename Fn>
+    void Read(Fn&& fn) const {
+        for (;;) {
+            const uint32_t before = Counter().load(std::memory_order_acquire);
+            if (before & 1u) {
+                continue;
+            }
+
+            fn();
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (Counter().load(std::memory_order_relaxed) == before) {
+                return;
+            }
+        }
+    }
+
+    uint32_t Sequence() const { return Counter().load(std::memory_order_acquire); }
+
+private:
+    using Ref = std::atomic_ref<uint32_t>;
+
+    Ref Counter() const { return Ref(const_cast<uint32_t&>(sequence)); }
+
+    alignas(Ref::required_alignment) uint32_t sequence{0};
+
+    static_assert(Ref::is_always_lock_free);
+};
+
+#endif //CHIP_8_SEQLOCK_H
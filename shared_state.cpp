@@ -0,0 +1,150 @@
+#include "shared_state.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// True if `name` holds a segment whose writer has exited. Anything that
+// cannot be confirmed stale, including a segment another session is still
+// setting up, counts as live.
+bool Stale(const char* name) {
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SharedState))) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(SharedState), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const auto* state = static_cast<const SharedState*>(mapping);
+    const bool ours = state->magic == SharedState::MAGIC && state->version == SharedState::VERSION;
+    const pid_t owner = ours ? state->owner_pid : 0;
+    munmap(mapping, sizeof(SharedState));
+
+    // EPERM means the process exists but belongs to someone else
+    return owner > 0 && kill(owner, 0) != 0 && errno == ESRCH;
+}
+
+}
+
+SharedStateExport::~SharedStateExport() {
+    Close();
+}
+
+bool SharedStateExport::Open(const char* shm_name) {
+    Close();
+
+    // A segment left by a crashed session is replaced, not reused: zeroing
+    // it in place would reset the sequence under a reader mid-Read().
+    int fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST && Stale(shm_name)) {
+        shm_unlink(shm_name);
+        fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) {
+        return false;
+    }
+
+    if (ftruncate(fd, sizeof(SharedState)) != 0) {
+        close(fd);
+        shm_unlink(shm_name);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(shm_name);
+        return false;
+    }
+
+    state = new (mapping) SharedState{};
+    state->owner_pid = getpid();
+    state->version = SharedState::VERSION;
+    state->magic = SharedState::MAGIC;
+    std::strncpy(name, shm_name, sizeof(name) - 1);
+    return true;
+}
+
+void SharedStateExport::Close() {
+    if (!state) {
+        return;
+    }
+
+    munmap(state, sizeof(SharedState));
+    shm_unlink(name);
+    state = nullptr;
+}
+
+void SharedStateExport::Publish(const Chip8& chip8, uint64_t frame) {
+    if (!state) {
+        return;
+    }
+
+    state->lock.BeginWrite();
+    state->frame = frame;
+    state->program_counter = chip8.ProgramCounter();
+    state->index = chip8.Index();
+    std::memcpy(state->registers, chip8.Registers(), sizeof(state->registers));
+    state->delay_timer = chip8.DelayTimer();
+    state->sound_timer = chip8.SoundTimer();
+    std::memcpy(state->video, chip8.Video(), sizeof(state->video));
+    state->lock.EndWrite();
+}
+
+SharedStateView::~SharedStateView() {
+    Close();
+}
+
+bool SharedStateView::Open(const char* shm_name) {
+    Close();
+
+    const int fd = shm_open(shm_name, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    // reading past the end of a short segment would raise SIGBUS
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SharedState))) {
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, sizeof(SharedState), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    state = static_cast<const SharedState*>(mapping);
+    if (state->magic != SharedState::MAGIC || state->version != SharedState::VERSION) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SharedStateView::Close() {
+    if (!state) {
+        return;
+    }
+
+    munmap(const_cast<SharedState*>(state), sizeof(SharedState));
+    state = nullptr;
+}
@@ -0,0 +1,79 @@
+#ifndef CHIP_8_SHARED_STATE_H
+#define CHIP_8_SHARED_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chip8.h"
+#include "seqlock.h"
+
+// Layout of the POSIX shared-memory segment. Fixed-size fields only, so any
+// local process built against this header can map it.
+struct SharedState {
+    static constexpr uint32_t MAGIC = 0x43385353; // "SS8C"
+    static constexpr uint32_t VERSION = 2;
+
+    uint32_t magic;
+    uint32_t version;
+    int32_t owner_pid; // writer process, to tell a live segment from a stale one
+    SeqLock lock;
+    uint64_t frame;
+    uint16_t program_counter;
+    uint16_t index;
+    uint8_t registers[16];
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    alignas(CACHE_LINE_SIZE) uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT];
+};
+
+// Writer side: the emulation thread publishes once per frame under the
+// seqlock and never waits for readers. Publishing copies the registers and
+// the frame into the segment (about 8 KiB); it is readers that get the state
+// without a copy or a system call, by reading the mapping in place.
+//
+// Open() refuses a name whose segment still belongs to a running process, so
+// a second session cannot take it over from the first and its readers. A
+// segment left by a process that has exited is replaced.
+class SharedStateExport {
+public:
+    SharedStateExport() = default;
+    ~SharedStateExport();
+
+    SharedStateExport(const SharedStateExport&) = delete;
+    SharedStateExport& operator=(const SharedStateExport&) = delete;
+
+    // `name` follows shm_open rules, e.g. "/chip8-session-1".
+    bool Open(const char* name);
+    void Close();
+
+    void Publish(const Chip8& chip8, uint64_t frame);
+
+private:
+    SharedState* state{};
+    char name[256]{};
+};
+
+// Reader side for monitors, recorders and dashboards. Read() hands the mapped
+// segment to `fn` in place and re-runs it if the writer published meanwhile,
+// so `fn` should only copy out what it needs.
+class SharedStateView {
+public:
+    SharedStateView() = default;
+    ~SharedStateView();
+
+    SharedStateView(const SharedStateView&) = delete;
+    SharedStateView& operator=(const SharedStateView&) = delete;
+
+    bool Open(const char* name);
+    void Close();
+
+    template <typename Fn>
+    void Read(Fn&& fn) const {
+        state->lock.Read([&] { fn(static_cast<const SharedState&>(*state)); });
+    }
+
+private:
+    const SharedState* state{};
+};
+
+#endif //CHIP_8_SHARED_STATE_H
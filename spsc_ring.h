@@ -0,0 +1,73 @@
+#ifndef CHIP_8_SPSC_RING_H
+#define CHIP_8_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "chip8.h"
+
+// Bounded single-producer/single-consumer ring. Each side owns one cache line
+// holding its index and a cached copy of the other side's index, so the shared
+// atomics are only re-read when the ring looks full (producer) or empty
+// (consumer). Capacity must be a power of two.
+template <typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // producer side
+    bool Push(const T& value) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == Capacity) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head == Capacity) {
+                return false;
+            }
+        }
+
+        buffer[t & (Capacity - 1)] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: Front() returns nullptr when empty, Pop() discards it
+    const T* Front() {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail) {
+                return nullptr;
+            }
+        }
+        return &buffer[h & (Capacity - 1)];
+    }
+
+    void Pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool Pop(T& out) {
+        const T* front = Front();
+        if (!front) {
+            return false;
+        }
+        out = *front;
+        Pop();
+        return true;
+    }
+
+    std::size_t Size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail{0};
+    std::size_t cached_head{0};
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head{0};
+    std::size_t cached_tail{0};
+
+    alignas(CACHE_LINE_SIZE) T buffer[Capacity]{};
+};
+
+#endif //CHIP_8_SPSC_RING_H
@@ -0,0 +1,79 @@
+#include "terminal.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+namespace {
+
+// indexed by (top << 1) | bottom
+constexpr const char* GLYPHS[4] = {" ", "▄", "▀", "█"};
+
+}
+
+TerminalRenderer::TerminalRenderer(int fd) : fd(fd) {
+    out.reserve(ROWS * VIDEO_WIDTH * 16);
+}
+
+TerminalRenderer::~TerminalRenderer() {
+    // park the cursor below the image and show it again
+    out = "\x1b[" + std::to_string(ROWS + 1) + ";1H\x1b[?25h";
+    Flush();
+}
+
+void TerminalRenderer::Render(const uint32_t* video) {
+    out.clear();
+    if (full_redraw) {
+        out += "\x1b[?25l\x1b[2J";
+    }
+
+    // position the terminal cursor would be at after the last glyph we wrote;
+    // a cursor move is only needed when the next changed cell is elsewhere
+    unsigned int cursor_row = ROWS;
+    unsigned int cursor_col = 0;
+
+    for (unsigned int row = 0; row < ROWS; ++row) {
+        const uint32_t* top = video + (row * 2) * VIDEO_WIDTH;
+        const uint32_t* bottom = top + VIDEO_WIDTH;
+
+        for (unsigned int col = 0; col < VIDEO_WIDTH; ++col) {
+            const uint8_t cell = ((top[col] != 0) << 1) | (bottom[col] != 0);
+            uint8_t& previous = cells[row * VIDEO_WIDTH + col];
+
+            if (cell == previous && !full_redraw) {
+                continue;
+            }
+            previous = cell;
+
+            if (row != cursor_row || col != cursor_col) {
+                out += "\x1b[";
+                out += std::to_string(row + 1);
+                out += ';';
+                out += std::to_string(col + 1);
+                out += 'H';
+            }
+            out += GLYPHS[cell];
+            cursor_row = row;
+            cursor_col = col + 1;
+        }
+    }
+
+    full_redraw = false;
+    Flush();
+}
+
+void TerminalRenderer::Flush() {
+    const char* data = out.data();
+    std::size_t remaining = out.size();
+
+    while (remaining > 0) {
+        const ssize_t written = ::write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        remaining -= written;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef CHIP_8_TERMINAL_H
+#define CHIP_8_TERMINAL_H
+
+#include <cstdint>
+#include <string>
+
+#include "chip8.h"
+
+// Draws `video` on an ANSI terminal with Unicode half blocks, one cell per two
+// vertically adjacent pixels. Only cells that changed since the previous frame
+// are emitted, and the whole frame goes out in a single write(), which keeps
+// slow SSH links usable.
+class TerminalRenderer {
+public:
+    explicit TerminalRenderer(int fd = 1);
+    ~TerminalRenderer();
+
+    TerminalRenderer(const TerminalRenderer&) = delete;
+    TerminalRenderer& operator=(const TerminalRenderer&) = delete;
+
+    void Render(const uint32_t* video);
+
+    // Forces a full redraw on the next Render(), e.g. after a terminal resize.
+    void Invalidate() { full_redraw = true; }
+
+private:
+    static constexpr unsigned int ROWS = VIDEO_HEIGHT / 2;
+
+    void Flush();
+
+    int fd;
+    bool full_redraw{true};
+    uint8_t cells[ROWS * VIDEO_WIDTH]{};
+    std::string out;
+};
+
+#endif //CHIP_8_TERMINAL_H
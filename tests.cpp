@@ -0,0 +1,1034 @@
+// chip8_tests: behaviour checks for the deterministic parts of the tree.
+//
+// Each case is a plain function; ctest runs them one per process by name.
+//
+// usage: chip8_tests [case]...   (no arguments runs every case)
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "audio.h"
+#include "chip8_c.h"
+#include "debugger.h"
+#include "disassembler.h"
+#include "input.h"
+#include "keyboard.h"
+#include "netplay.h"
+#include "presenter.h"
+#include "ram_search.h"
+#include "recorder.h"
+#include "reverse.h"
+#include "scheduler.h"
+#include "shared_state.h"
+#include "triple_buffer.h"
+#include "upscale.h"
+#include "vector_env.h"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                           \
+    do {                                                                           \
+        if (!(condition)) {                                                        \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                              \
+            ++failures;                                                            \
+        }                                                                          \
+    } while (0)
+
+// loops on "V2 += 1 while key V5 is held"
+constexpr uint8_t HOLD_COUNTER[] = {0x65, 0x05, 0xE5, 0xA1, 0x72, 0x01, 0x12, 0x02};
+
+void SeekTo(ReverseDebugger& reverse, uint64_t frame, uint32_t instruction) {
+    while (reverse.Now() > ReverseDebugger::Position{frame, instruction} && reverse.ReverseStep()) {
+    }
+}
+
+void TestReverseReplay() {
+    Chip8 chip8;
+    chip8.LoadROM(HOLD_COUNTER, sizeof(HOLD_COUNTER));
+    Debugger debugger;
+    ReverseDebugger reverse(chip8, debugger, 10, 2);
+
+    CHECK(!reverse.ReverseStep());
+
+    reverse.RunFrame();
+    reverse.RunFrame();
+    reverse.SetKey(5, true);
+    while (reverse.Now().frame < 5) {
+        reverse.RunFrame();
+    }
+    const uint8_t live = chip8.Registers()[2];
+    CHECK(live > 0);
+
+    // replay reproduces the recorded run
+    SeekTo(reverse, 3, 4);
+    const uint8_t at_3_4 = chip8.Registers()[2];
+    while (reverse.Now().frame < 5) {
+        reverse.RunFrame();
+    }
+    CHECK(chip8.Registers()[2] == live);
+    SeekTo(reverse, 3, 4);
+    CHECK(chip8.Registers()[2] == at_3_4);
+
+    // Rewind to the boundary before frame 2, where the press was recorded,
+    // and change the input there. Replays must use the new keys.
+    SeekTo(reverse, 1, 9);
+    reverse.Step();
+    CHECK((reverse.Now() == ReverseDebugger::Position{2, 0}));
+    reverse.SetKey(5, false);
+    while (reverse.Now().frame < 5) {
+        reverse.RunFrame();
+    }
+    CHECK(chip8.Registers()[2] == 0);
+    SeekTo(reverse, 2, 9);
+    CHECK((reverse.Now() == ReverseDebugger::Position{2, 9}));
+    CHECK(chip8.Registers()[2] == 0);
+}
+
+void TestDecodeFaults() {
+    // 5xyN only exists with N = 0, 2 or 3 and 9xyN with N = 0
+    for (const uint16_t opcode : {0x5011, 0x501F, 0x901F}) {
+        const uint8_t rom[] = {static_cast<uint8_t>(opcode >> 8u), static_cast<uint8_t>(opcode)};
+        Chip8 chip8;
+        chip8.LoadROM(rom, sizeof(rom));
+        chip8.Cycle();
+        CHECK(chip8.Faults() == Chip8::FAULT_INVALID_OPCODE);
+        CHECK(chip8.ProgramCounter() == START_ADDRESS + 2);
+    }
+
+    // RET with an empty stack faults and leaves the stack pointer alone
+    constexpr uint8_t RET[] = {0x00, 0xEE};
+    Chip8 chip8;
+    chip8.LoadROM(RET, sizeof(RET));
+    chip8.Cycle();
+    CHECK(chip8.Faults() == Chip8::FAULT_STACK_UNDERFLOW);
+    CHECK(chip8.StackPointer() == 0);
+    CHECK(chip8.ProgramCounter() == START_ADDRESS + 2);
+}
+
+void TestXoChipRegisterRanges() {
+    // I = 0x300; V1..V3 = 1, 2, 3; save V1-V3 ascending, save V3-V1 at 0x303
+    // descending, then load 0x300.. into V4-V6
+    constexpr uint8_t ROM[] = {0xA3, 0x00, 0x61, 0x01, 0x62, 0x02, 0x63, 0x03, 0x51, 0x32,
+                               0xA3, 0x03, 0x53, 0x12, 0xA3, 0x00, 0x54, 0x63};
+    Chip8 chip8;
+    chip8.LoadROM(ROM, sizeof(ROM));
+    for (std::size_t i = 0; i < sizeof(ROM) / 2; ++i) {
+        chip8.Cycle();
+    }
+    CHECK(chip8.Faults() == 0);
+    CHECK(chip8.Index() == 0x300);
+    const uint8_t expected[] = {1, 2, 3, 3, 2, 1};
+    CHECK(std::memcmp(chip8.Memory() + 0x300, expected, sizeof(expected)) == 0);
+    CHECK(chip8.Registers()[4] == 1 && chip8.Registers()[5] == 2 && chip8.Registers()[6] == 3);
+}
+
+void TestSchedulerParkResume() {
+    // DT = 30, wait for a key into V2, then spin
+    constexpr uint8_t ROM[] = {0x63, 0x1E, 0xF3, 0x15, 0xF2, 0x0A, 0x12, 0x06};
+    constexpr unsigned int PARKED_FRAMES = 10;
+
+    Chip8 chip8;
+    chip8.LoadROM(ROM, sizeof(ROM));
+    Scheduler scheduler;
+    const std::size_t session = scheduler.Add(&chip8);
+
+    scheduler.RunFrame();
+    CHECK(scheduler.Parked(session));
+    CHECK(scheduler.RunnableCount() == 0);
+    for (unsigned int i = 0; i < PARKED_FRAMES; ++i) {
+        scheduler.RunFrame();
+    }
+    // parked frames do not touch the instance at all
+    CHECK(chip8.DelayTimer() == 29);
+
+    CHECK(scheduler.PostKey(session, 7, true));
+    scheduler.RunFrame();
+    CHECK(!scheduler.Parked(session));
+    CHECK(scheduler.RunnableCount() == 1);
+    CHECK(chip8.Registers()[2] == 7);
+
+    // the timers end up where they would had every frame run: one tick for
+    // each of the PARKED_FRAMES + 2 frames
+    CHECK(chip8.DelayTimer() == 30 - (PARKED_FRAMES + 2));
+
+    Chip8 reference;
+    reference.LoadROM(ROM, sizeof(ROM));
+    for (unsigned int i = 0; i < PARKED_FRAMES + 1; ++i) {
+        reference.RunFrame(11);
+    }
+    reference.SetKey(7, true);
+    reference.RunFrame(11);
+    CHECK(reference.DelayTimer() == chip8.DelayTimer());
+    CHECK(reference.ProgramCounter() == chip8.ProgramCounter());
+}
+
+void TestKeyRingBounds() {
+    SpscRing<int, 4> ring;
+    int value = -1;
+    CHECK(ring.Front() == nullptr);
+    CHECK(!ring.Pop(value) && value == -1);
+
+    // full at exactly Capacity, and usable again after one pop; go round
+    // several times so the indices wrap
+    int next_in = 0;
+    int next_out = 0;
+    for (int lap = 0; lap < 3; ++lap) {
+        while (ring.Push(next_in)) {
+            ++next_in;
+        }
+        CHECK(ring.Size() == 4);
+        CHECK(ring.Pop(value) && value == next_out++);
+        CHECK(ring.Push(next_in++));
+        CHECK(!ring.Push(next_in));
+        while (ring.Pop(value)) {
+            CHECK(value == next_out++);
+        }
+        CHECK(ring.Size() == 0 && ring.Front() == nullptr);
+    }
+    CHECK(next_in == next_out);
+
+    // DrainKeys stops at the first event stamped for a later frame
+    KeyQueue keys;
+    Chip8 chip8;
+    CHECK(keys.Push({0, 0x1, true}));
+    CHECK(keys.Push({2, 0x1, false}));
+    CHECK(keys.Push({2, 0xF, true}));
+    CHECK(DrainKeys(keys, chip8, 1) == 1);
+    CHECK(keys.Size() == 2);
+    CHECK(DrainKeys(keys, chip8, 2) == 2);
+    CHECK(DrainKeys(keys, chip8, 3) == 0);
+
+    CHECK(TerminalKeyboard::KeyFor('1') == 0x1 && TerminalKeyboard::KeyFor('x') == 0x0);
+    CHECK(TerminalKeyboard::KeyFor('V') == 0xF && TerminalKeyboard::KeyFor('4') == 0xC);
+    CHECK(TerminalKeyboard::KeyFor('p') == -1 && TerminalKeyboard::KeyFor('\0') == -1);
+}
+
+void TestTripleBufferFresh() {
+    TripleBuffer<int> buffer;
+    CHECK(!buffer.Update());
+
+    buffer.Back() = 1;
+    buffer.Publish();
+    CHECK(buffer.Update() && buffer.Front() == 1);
+    // a frame is never read twice
+    CHECK(!buffer.Update() && buffer.Front() == 1);
+
+    // the newest of several unread frames wins; the others count as dropped
+    for (int value : {2, 3, 4}) {
+        buffer.Back() = value;
+        buffer.Publish();
+    }
+    CHECK(buffer.Update() && buffer.Front() == 4);
+    CHECK(!buffer.Update());
+    CHECK(buffer.Dropped() == 2);
+
+    // across threads the consumer sees strictly increasing values, and every
+    // published value is either read or dropped
+    constexpr int LAST = 20000;
+    TripleBuffer<int> shared;
+    std::thread producer([&] {
+        for (int value = 1; value <= LAST; ++value) {
+            shared.Back() = value;
+            shared.Publish();
+            std::this_thread::yield();
+        }
+    });
+    int previous = 0;
+    int read = 0;
+    bool ordered = true;
+    while (previous != LAST) {
+        if (shared.Update()) {
+            ordered &= shared.Front() > previous;
+            previous = shared.Front();
+            ++read;
+        }
+        std::this_thread::yield();
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK(read + shared.Dropped() == LAST);
+
+    // the presenter delivers a published frame through the palette and scale
+    std::atomic<uint64_t> presented{0};
+    std::vector<uint32_t> seen;
+    {
+        Presenter presenter(2, 0xFFFFFFFF, 0xFF000000,
+                            [&](const uint32_t* rgba, unsigned int width, unsigned int height, uint64_t frame) {
+                                seen.assign(rgba, rgba + width * height);
+                                presented.store(frame, std::memory_order_release);
+                            });
+        uint32_t video[VIDEO_WIDTH * VIDEO_HEIGHT]{};
+        video[1 * VIDEO_WIDTH + 3] = 1;
+        presenter.Publish(video, 7);
+        for (int spin = 0; spin < 100000 && presented.load(std::memory_order_acquire) != 7; ++spin) {
+            std::this_thread::yield();
+        }
+    }
+    CHECK(presented.load() == 7);
+    CHECK(seen.size() == VIDEO_WIDTH * 2 * VIDEO_HEIGHT * 2);
+    if (seen.size() == VIDEO_WIDTH * 2 * VIDEO_HEIGHT * 2) {
+        const std::size_t stride = VIDEO_WIDTH * 2;
+        CHECK(seen[2 * stride + 6] == 0xFFFFFFFF && seen[3 * stride + 7] == 0xFFFFFFFF);
+        CHECK(seen[2 * stride + 5] == 0xFF000000 && seen[4 * stride + 6] == 0xFF000000);
+    }
+}
+
+void TestWavSoundTimer() {
+    // ST = 3, then spin; the timer reads 2, 1, 0 after frames 0, 1, 2
+    constexpr uint8_t ROM[] = {0x60, 0x03, 0xF0, 0x18, 0x12, 0x04};
+    constexpr unsigned int RATE = 6000;
+    constexpr unsigned int PER_FRAME = RATE / 60;
+    constexpr unsigned int FRAMES = 6;
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "chip8_tests_sound.wav";
+
+    Chip8 chip8;
+    chip8.LoadROM(ROM, sizeof(ROM));
+    {
+        AudioPipeline audio(RATE, std::make_unique<WavAudioSink>(path.c_str(), RATE), true);
+        for (unsigned int frame = 0; frame < FRAMES; ++frame) {
+            chip8.RunFrame(11);
+            audio.Frame(chip8.Audio());
+        }
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<uint8_t> wav((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::filesystem::remove(path);
+    auto u32 = [&](std::size_t at) { return wav[at] | wav[at + 1] << 8 | wav[at + 2] << 16 | uint32_t{wav[at + 3]} << 24; };
+
+    CHECK(wav.size() == 44 + FRAMES * PER_FRAME * 2);
+    if (wav.size() != 44 + FRAMES * PER_FRAME * 2) {
+        return;
+    }
+    CHECK(std::memcmp(wav.data(), "RIFF", 4) == 0 && std::memcmp(wav.data() + 8, "WAVEfmt ", 8) == 0);
+    CHECK(u32(24) == RATE);
+    CHECK(u32(40) == FRAMES * PER_FRAME * 2);
+
+    // two frames of 440 Hz square wave at full amplitude, then silence
+    std::vector<int16_t> samples(FRAMES * PER_FRAME);
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<int16_t>(wav[44 + i * 2] | wav[45 + i * 2] << 8);
+    }
+    bool square = true;
+    for (std::size_t i = 0; i < 2 * PER_FRAME; ++i) {
+        const double phase = i * 440.0 / RATE;
+        square &= samples[i] == (phase - static_cast<long>(phase) < 0.5 ? 8000 : -8000);
+    }
+    CHECK(square);
+    CHECK(std::all_of(samples.begin() + 2 * PER_FRAME, samples.end(), [](int16_t v) { return v == 0; }));
+
+    // a pattern frame in between does not disturb the tone's phase
+    Chip8::AudioState tone{true, false, 64, {}};
+    Chip8::AudioState pattern{true, true, 64, {0xF0, 0x0F}};
+    AudioSynth switched(RATE);
+    AudioSynth steady(RATE);
+    AudioBlock a{};
+    AudioBlock b{};
+    switched.RenderFrame(tone, a);
+    switched.RenderFrame(pattern, a);
+    switched.RenderFrame(tone, a);
+    steady.RenderFrame(tone, b);
+    steady.RenderFrame(tone, b);
+    CHECK(a.count == b.count && std::memcmp(a.samples, b.samples, a.count * sizeof(int16_t)) == 0);
+}
+
+void TestUpscaleParity() {
+    // Whichever path Upscaler picked is checked against the nearest-neighbour
+    // mapping written out per pixel, at sizes that leave vector tails, that
+    // shrink, and that are large enough to be split across threads.
+    constexpr Palette PALETTE{0xFF102030, 0xFFE0D0C0};
+    constexpr uint32_t PADDING = 0xDEADBEEF;
+    std::printf("  %s path\n", Upscaler(PALETTE).UsesAvx2() ? "AVX2" : "scalar");
+
+    CounterRng rng{CounterRng::key_for(5, 0), 0};
+    std::vector<uint32_t> video(VIDEO_WIDTH * VIDEO_HEIGHT);
+    for (uint32_t& pixel : video) {
+        pixel = rng.next_byte() & 1u;
+    }
+
+    // Scale2x as its comment defines it, edges repeating the centre pixel
+    auto scale2x = [](const std::vector<uint32_t>& src, unsigned int width, unsigned int height) {
+        std::vector<uint32_t> out(width * 2 * height * 2);
+        auto at = [&](int x, int y) {
+            x = std::clamp(x, 0, static_cast<int>(width) - 1);
+            y = std::clamp(y, 0, static_cast<int>(height) - 1);
+            return src[y * width + x] != 0;
+        };
+        for (int y = 0; y < static_cast<int>(height); ++y) {
+            for (int x = 0; x < static_cast<int>(width); ++x) {
+                const bool e = at(x, y), b = at(x, y - 1), h = at(x, y + 1), d = at(x - 1, y), f = at(x + 1, y);
+                const bool corners[4] = {b != h && d != f && d == b ? d : e, b != h && d != f && b == f ? f : e,
+                                         b != h && d != f && d == h ? d : e, b != h && d != f && h == f ? f : e};
+                for (int c = 0; c < 4; ++c) {
+                    out[(y * 2 + c / 2) * width * 2 + x * 2 + c % 2] = corners[c];
+                }
+            }
+        }
+        return out;
+    };
+
+    struct Size {
+        unsigned int width;
+        unsigned int height;
+    };
+    for (const ScaleFilter filter : {ScaleFilter::Nearest, ScaleFilter::Scale2x}) {
+        const std::vector<uint32_t> source =
+                filter == ScaleFilter::Scale2x ? scale2x(video, VIDEO_WIDTH, VIDEO_HEIGHT) : video;
+        const unsigned int source_width = filter == ScaleFilter::Scale2x ? VIDEO_WIDTH * 2 : VIDEO_WIDTH;
+        const unsigned int source_height = filter == ScaleFilter::Scale2x ? VIDEO_HEIGHT * 2 : VIDEO_HEIGHT;
+
+        for (const Size size : {Size{64, 32}, Size{203, 97}, Size{37, 19}, Size{1920, 1080}}) {
+            for (const unsigned int threads : {1u, 3u}) {
+                Upscaler upscaler(PALETTE, filter, threads);
+                const std::size_t stride = size.width + 5;
+                std::vector<uint32_t> dst(stride * size.height, PADDING);
+                upscaler.Scale(video.data(), VIDEO_WIDTH, VIDEO_HEIGHT, dst.data(), size.width, size.height, stride);
+
+                std::size_t mismatches = 0;
+                for (unsigned int y = 0; y < size.height; ++y) {
+                    const unsigned int sy = static_cast<unsigned int>(uint64_t{y} * source_height / size.height);
+                    for (unsigned int x = 0; x < size.width; ++x) {
+                        const unsigned int sx = static_cast<unsigned int>(uint64_t{x} * source_width / size.width);
+                        const uint32_t expected = source[sy * source_width + sx] ? PALETTE.on : PALETTE.off;
+                        mismatches += dst[y * stride + x] != expected;
+                    }
+                    for (std::size_t x = size.width; x < stride; ++x) {
+                        mismatches += dst[y * stride + x] != PADDING;
+                    }
+                }
+                CHECK(mismatches == 0);
+            }
+        }
+    }
+
+    // an empty destination is left alone rather than divided by
+    Upscaler upscaler(PALETTE, ScaleFilter::Nearest, 3);
+    uint32_t untouched = PADDING;
+    upscaler.Scale(video.data(), VIDEO_WIDTH, VIDEO_HEIGHT, &untouched, 1, 0, 1);
+    upscaler.Scale(video.data(), VIDEO_WIDTH, VIDEO_HEIGHT, &untouched, 0, 1, 1);
+    CHECK(untouched == PADDING);
+}
+
+void TestSharedStateOwner() {
+    const std::string name = "/chip8-tests-" + std::to_string(getpid());
+
+    // a live session keeps its segment; a second one is refused and the
+    // first one's readers are unaffected
+    {
+        SharedStateExport first;
+        CHECK(first.Open(name.c_str()));
+        Chip8 chip8;
+        first.Publish(chip8, 42);
+
+        SharedStateExport second;
+        CHECK(!second.Open(name.c_str()));
+
+        SharedStateView view;
+        CHECK(view.Open(name.c_str()));
+        uint64_t frame = 0;
+        int32_t owner = 0;
+        view.Read([&](const SharedState& state) {
+            frame = state.frame;
+            owner = state.owner_pid;
+        });
+        CHECK(frame == 42 && owner == getpid());
+    }
+
+    // a segment whose writer has exited is replaced
+    const pid_t child = fork();
+    if (child == 0) {
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    CHECK(ftruncate(fd, sizeof(SharedState)) == 0);
+    void* mapping = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK(mapping != MAP_FAILED);
+    if (mapping != MAP_FAILED) {
+        auto* stale = static_cast<SharedState*>(mapping);
+        stale->magic = SharedState::MAGIC;
+        stale->version = SharedState::VERSION;
+        stale->owner_pid = child;
+        munmap(mapping, sizeof(SharedState));
+    }
+
+    SharedStateExport replacement;
+    CHECK(replacement.Open(name.c_str()));
+    replacement.Close();
+    CHECK(shm_unlink(name.c_str()) != 0);
+}
+
+void TestCApiErrors() {
+    // every entry point treats a NULL handle the same way
+    CHECK(!chip8_load_rom(nullptr, nullptr, 0) && chip8_last_error() == CHIP8_ERROR_NULL_ARGUMENT);
+    CHECK(!chip8_framebuffer(nullptr) && chip8_last_error() == CHIP8_ERROR_NULL_ARGUMENT);
+    chip8_set_instructions_per_frame(nullptr, 5);
+    CHECK(chip8_last_error() == CHIP8_ERROR_NULL_ARGUMENT);
+    chip8_vec_env_step(nullptr, nullptr);
+    CHECK(chip8_last_error() == CHIP8_ERROR_NULL_ARGUMENT);
+    CHECK(!chip8_vec_env_observation_size(nullptr) && chip8_last_error() == CHIP8_ERROR_NULL_ARGUMENT);
+
+    chip8_instance* instance = chip8_create();
+    CHECK(instance && chip8_last_error() == CHIP8_OK);
+    CHECK(!chip8_load_rom_file(instance, "/nonexistent/rom.ch8") && chip8_last_error() == CHIP8_ERROR_IO);
+    const uint8_t rom[] = {0x12, 0x00};
+    CHECK(chip8_load_rom(instance, rom, sizeof(rom)) && chip8_last_error() == CHIP8_OK);
+
+    chip8_vec_env_config config;
+    chip8_vec_env_config_init(&config);
+    config.instances = 0;
+    CHECK(!chip8_vec_env_create(&config, instance) && chip8_last_error() == CHIP8_ERROR_INVALID_ARGUMENT);
+    config.instances = 4;
+    chip8_vec_env* env = chip8_vec_env_create(&config, instance);
+    CHECK(env && chip8_last_error() == CHIP8_OK);
+    chip8_vec_env_step(env, nullptr);
+    CHECK(chip8_last_error() == CHIP8_ERROR_NULL_ARGUMENT);
+    const int32_t actions[4] = {};
+    chip8_vec_env_step(env, actions);
+    CHECK(chip8_last_error() == CHIP8_OK);
+
+    chip8_vec_env_destroy(env);
+    chip8_destroy(instance);
+    CHECK(std::strcmp(chip8_error_message(CHIP8_ERROR_IO), "cannot read file") == 0);
+    CHECK(chip8_error_message(static_cast<chip8_error>(99)) != nullptr);
+}
+
+void TestVectorEnvDeterminism() {
+    // draws a random byte as a one-row sprite at a random position, forever
+    constexpr uint8_t ROM[] = {0xA3, 0x00, 0xC0, 0xFF, 0xF0, 0x55, 0xC1, 0x3F, 0xC2, 0x1F, 0xD1, 0x21, 0x12, 0x02};
+    constexpr unsigned int EPISODE_FRAMES = 5;
+    constexpr unsigned int STEPS = 3 * EPISODE_FRAMES;
+
+    Chip8 start;
+    start.LoadROM(ROM, sizeof(ROM));
+    VectorEnvConfig config;
+    config.instances = 8;
+    config.max_episode_frames = EPISODE_FRAMES;
+    config.reward_address = 0x300;
+    config.seed = 9;
+
+    // [step][instance][observation], then the rewards and dones per step
+    auto trajectory = [&](unsigned int threads) {
+        config.threads = threads;
+        VectorEnv env(config, start);
+        const std::vector<int32_t> actions(config.instances, 0);
+        std::vector<uint8_t> out;
+        for (unsigned int step = 0; step < STEPS; ++step) {
+            env.Step(actions.data());
+            out.insert(out.end(), env.Observations(), env.Observations() + env.Instances() * env.ObservationSize());
+            for (std::size_t i = 0; i < env.Instances(); ++i) {
+                const float reward = env.Rewards()[i];
+                out.insert(out.end(), reinterpret_cast<const uint8_t*>(&reward),
+                           reinterpret_cast<const uint8_t*>(&reward) + sizeof(reward));
+                out.push_back(env.Dones()[i]);
+            }
+        }
+        return out;
+    };
+
+    // the same seed gives the same trajectory, however many threads run it
+    const std::vector<uint8_t> single = trajectory(1);
+    CHECK(trajectory(1) == single);
+    CHECK(trajectory(3) == single);
+
+    // different episodes of one instance, and different instances in one
+    // episode, draw different streams
+    const std::size_t observation = VIDEO_PACKED_SIZE;
+    const std::size_t per_step = config.instances * (observation + sizeof(float) + 1);
+    auto frame = [&](unsigned int step, std::size_t instance) {
+        const uint8_t* at = single.data() + step * per_step + instance * observation;
+        return std::vector<uint8_t>(at, at + observation);
+    };
+    bool episodes_differ = false;
+    bool instances_differ = false;
+    for (unsigned int step = 0; step + 1 < EPISODE_FRAMES; ++step) {
+        episodes_differ |= frame(step, 0) != frame(step + EPISODE_FRAMES, 0);
+        instances_differ |= frame(step, 0) != frame(step, 1);
+    }
+    CHECK(episodes_differ);
+    CHECK(instances_differ);
+
+    // episodes end on schedule, with the new episode's first observation
+    CHECK(single[(EPISODE_FRAMES - 1) * per_step + config.instances * observation + sizeof(float)] == 1);
+}
+
+void TestCfgBlocksAndData() {
+    // draws the sprite that follows the code, branches on V0, calls a
+    // subroutine that writes BCD into the bytes after the sprite, then idles
+    constexpr uint8_t ROM[] = {
+        0xA2, 0x10, // 200: LD I, 0x210
+        0xD0, 0x15, // 202: DRW V0, V1, 5
+        0x30, 0x00, // 204: SE V0, 0x00
+        0x22, 0x0A, // 206: CALL 0x20A
+        0x12, 0x08, // 208: JP 0x208
+        0xA2, 0x15, // 20A: LD I, 0x215
+        0xF2, 0x33, // 20C: LD B, V2
+        0x00, 0xEE, // 20E: RET
+        0xF0, 0x90, 0x90, 0x90, 0xF0, // 210: sprite
+        0x00, 0x00, 0x00,             // 215: BCD digits
+    };
+    const ControlFlowGraph cfg = BuildCfg(ROM, sizeof(ROM));
+
+    CHECK(cfg.blocks.size() == 4);
+    if (cfg.blocks.size() == 4) {
+        auto same_edge = [](const CfgEdge& a, const CfgEdge& b) { return a.target == b.target && a.kind == b.kind; };
+        auto is = [&](const BasicBlock& block, uint16_t start, uint16_t end, Terminator terminator,
+                      std::initializer_list<CfgEdge> successors) {
+            return block.start == start && block.end == end && block.terminator == terminator &&
+                   std::equal(block.successors.begin(), block.successors.end(), successors.begin(), successors.end(),
+                              same_edge);
+        };
+        CHECK(is(cfg.blocks[0], 0x200, 0x206, Terminator::Skip,
+                 {{0x206, EdgeKind::SkipNotTaken}, {0x208, EdgeKind::SkipTaken}}));
+        CHECK(is(cfg.blocks[1], 0x206, 0x208, Terminator::Call, {{0x20A, EdgeKind::Call}, {0x208, EdgeKind::Return}}));
+        CHECK(is(cfg.blocks[2], 0x208, 0x20A, Terminator::Jump, {{0x208, EdgeKind::Jump}}));
+        CHECK(is(cfg.blocks[3], 0x20A, 0x210, Terminator::Return, {}));
+    }
+    CHECK(cfg.subroutines == std::vector<uint16_t>{0x20A});
+    CHECK(cfg.self_loops == std::vector<uint16_t>{0x208});
+
+    CHECK(cfg.data.size() == 2);
+    if (cfg.data.size() == 2) {
+        CHECK(cfg.data[0].address == 0x210 && cfg.data[0].length == 5 && cfg.data[0].sprite &&
+              cfg.data[0].referenced_by == 0x202);
+        CHECK(cfg.data[1].address == 0x215 && cfg.data[1].length == 3 && !cfg.data[1].sprite &&
+              cfg.data[1].referenced_by == 0x20C);
+    }
+    // every ROM byte is code or data
+    CHECK(cfg.UnclassifiedBytes() == 0);
+}
+
+void TestDebuggerBlocks() {
+    // the loop runs its body once as is, then on the second pass stores
+    // JP 0x214 over the LD V4 at 0x20E, inside a block already looked at
+    constexpr uint8_t ROM[] = {
+        0x60, 0x12, // 200: LD V0, 0x12
+        0x61, 0x14, // 202: LD V1, 0x14
+        0xA2, 0x0E, // 204: LD I, 0x20E
+        0x72, 0x01, // 206: ADD V2, 1
+        0x42, 0x02, // 208: SNE V2, 2
+        0xF1, 0x55, // 20A: LD [I], V1
+        0x63, 0x00, // 20C: LD V3, 0
+        0x64, 0x00, // 20E: LD V4, 0
+        0x12, 0x06, // 210: JP 0x206
+        0x00, 0x00, // 212
+        0x65, 0x01, // 214: LD V5, 1
+        0x12, 0x16, // 216: JP 0x216
+    };
+    Chip8 start;
+    start.LoadROM(ROM, sizeof(ROM));
+
+    // a breakpoint partway into a straight run of code
+    Chip8 chip8 = start;
+    Debugger debugger;
+    debugger.SetBreakpoint(0x204);
+    CHECK(debugger.RunFrame(chip8, 100) == StopReason::Breakpoint);
+    CHECK(chip8.ProgramCounter() == 0x204 && debugger.InstructionsIntoFrame() == 2);
+
+    // the rewritten code is followed to the breakpoint it now jumps to
+    debugger.ClearBreakpoint(0x204);
+    debugger.SetBreakpoint(0x214);
+    CHECK(debugger.RunFrame(chip8, 100) == StopReason::Breakpoint);
+    CHECK(chip8.ProgramCounter() == 0x214 && chip8.Registers()[2] == 2);
+    CHECK(debugger.RunFrame(chip8, 100) == StopReason::FrameDone);
+    CHECK(chip8.Registers()[5] == 1);
+
+    // a store is caught by a write watchpoint, and a distant one costs nothing
+    chip8 = start;
+    Debugger watcher;
+    watcher.Watch(0x800, 1, true, true);
+    watcher.Watch(0x20F, 1, false, true);
+    CHECK(watcher.RunFrame(chip8, 100) == StopReason::Watchpoint);
+    CHECK(watcher.LastWatchHit().address == 0x20F && watcher.LastWatchHit().write);
+    CHECK(chip8.ProgramCounter() == 0x20C);
+}
+
+void TestConditionParse() {
+    bool ok = false;
+    Debugger::Compile("V3 == 0x10 && [I] > 2", &ok);
+    CHECK(ok);
+
+    // out-of-range numbers are a parse error, not an exception
+    Debugger::Compile("V0 == 99999999999999999999999", &ok);
+    CHECK(!ok);
+    Debugger::Compile("PC == 4294967296", &ok);
+    CHECK(!ok);
+
+    Debugger debugger;
+    CHECK(!debugger.SetBreakpoint(0x200, "V0 == 0x1FFFFFFFFFFFFFFFF"));
+}
+
+void TestRngStreams() {
+    // CXNN into V0-V7, then spin
+    constexpr uint8_t DRAW_EIGHT[] = {0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF, 0xC3, 0xFF, 0xC4, 0xFF,
+                                      0xC5, 0xFF, 0xC6, 0xFF, 0xC7, 0xFF, 0x12, 0x10};
+    auto draws = [&](Chip8& chip8) {
+        chip8.LoadROM(DRAW_EIGHT, sizeof(DRAW_EIGHT));
+        chip8.RunFrame(8);
+        uint64_t bytes = 0;
+        std::memcpy(&bytes, chip8.Registers(), sizeof(bytes));
+        return bytes;
+    };
+
+    // a stream depends only on (seed, instance); Reseed restarts it
+    Chip8 a(7, 3);
+    Chip8 b(7, 3);
+    Chip8 c(1, 1);
+    c.Reseed(7, 3);
+    const uint64_t reference = draws(a);
+    CHECK(draws(b) == reference);
+    CHECK(draws(c) == reference);
+
+    // neighbouring instances and seeds share no draws beyond chance
+    constexpr unsigned int STREAMS = 64;
+    constexpr unsigned int LENGTH = 1024;
+    std::vector<uint8_t> bytes(STREAMS * LENGTH);
+    for (unsigned int s = 0; s < STREAMS; ++s) {
+        CounterRng rng{CounterRng::key_for(s < STREAMS / 2 ? 1 : 2, s % (STREAMS / 2)), 0};
+        for (unsigned int i = 0; i < LENGTH; ++i) {
+            bytes[s * LENGTH + i] = rng.next_byte();
+            CHECK(bytes[s * LENGTH + i] == CounterRng::byte_at(rng.key, i));
+        }
+    }
+    for (unsigned int s = 0; s < STREAMS; ++s) {
+        for (unsigned int t = s + 1; t < STREAMS; ++t) {
+            unsigned int equal = 0;
+            for (unsigned int i = 0; i < LENGTH; ++i) {
+                equal += bytes[s * LENGTH + i] == bytes[t * LENGTH + i];
+            }
+            // about 4 expected
+            CHECK(equal < 20);
+        }
+    }
+
+    // seed + episode is mixed, not added: (s, e + 1) and (s + 1, e) differ
+    CHECK(CounterRng::key_for(5, 2) != CounterRng::key_for(6, 1));
+    CHECK(CounterRng::key_for(CounterRng::key_for(5, 2), 0) != CounterRng::key_for(CounterRng::key_for(6, 1), 0));
+}
+
+void TestSeqlockReadConsistent() {
+    // V0 += 1; V1 = V0 ^ 0xFF, over five instructions, so V1 == ~V0 only
+    // holds between loop iterations. Frames of 5 * k instructions end there.
+    constexpr uint8_t COMPLEMENT[] = {0x70, 0x01, 0x81, 0x00, 0x62, 0xFF, 0x81, 0x23, 0x12, 0x00};
+    Chip8 chip8;
+    chip8.LoadROM(COMPLEMENT, sizeof(COMPLEMENT));
+    chip8.RunFrame(5);
+
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            chip8.RunFrame(5 * 7);
+            // a reader spinning on an odd sequence would otherwise burn whole
+            // time slices on a single core
+            std::this_thread::yield();
+        }
+    });
+
+    // Yield between reads so the writer also moves on with a single core.
+    // Reads only overlap frames in flight with two or more cores.
+    unsigned int torn = 0;
+    unsigned int progress = 0;
+    uint8_t last = 0;
+    for (unsigned int reads = 0; reads < 20000; ++reads) {
+        std::this_thread::yield();
+        chip8.ReadConsistent([&](const Chip8::ArchState& state) {
+            torn += state.registers[1] != static_cast<uint8_t>(state.registers[0] ^ 0xFF) ||
+                    state.program_counter != START_ADDRESS;
+            progress += state.registers[0] != last;
+            last = state.registers[0];
+        });
+    }
+    stop.store(true, std::memory_order_relaxed);
+    writer.join();
+
+    CHECK(torn == 0);
+    CHECK(progress >= 100);
+}
+
+// Decodes the RLE stream format documented in recorder.h.
+bool ReadVarint(const std::vector<uint8_t>& bytes, std::size_t& pos, uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; pos < bytes.size() && shift < 64; shift += 7) {
+        const uint8_t byte = bytes[pos++];
+        value |= uint64_t{byte & 0x7Fu} << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::vector<uint32_t>> DecodeRle(const std::vector<uint8_t>& bytes) {
+    std::vector<std::vector<uint32_t>> frames;
+    if (bytes.size() < 10 || std::memcmp(bytes.data(), "C8RL", 4) != 0 ||
+        (bytes[4] | bytes[5] << 8) != VIDEO_WIDTH || (bytes[6] | bytes[7] << 8) != VIDEO_HEIGHT) {
+        return frames;
+    }
+    for (std::size_t pos = 10; pos < bytes.size();) {
+        const uint8_t tag = bytes[pos++];
+        uint64_t value = 0;
+        if (tag == 'R') {
+            if (!ReadVarint(bytes, pos, value) || frames.empty()) {
+                return {};
+            }
+            frames.insert(frames.end(), value, frames.back());
+            continue;
+        }
+        if (tag != 'F') {
+            return {};
+        }
+        std::vector<uint32_t> frame;
+        bool lit = false;
+        while (frame.size() < VIDEO_WIDTH * VIDEO_HEIGHT && ReadVarint(bytes, pos, value)) {
+            frame.insert(frame.end(), value, lit ? 0xFFFFFFFF : 0);
+            lit = !lit;
+        }
+        if (frame.size() != VIDEO_WIDTH * VIDEO_HEIGHT) {
+            return {};
+        }
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+void TestRecorderRleRoundtrip() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "chip8_tests_recorder.rle";
+
+    // runs of changing and repeated frames, including all-off and all-on
+    std::vector<std::vector<uint32_t>> submitted;
+    std::vector<uint32_t> video(VIDEO_WIDTH * VIDEO_HEIGHT, 0);
+    CounterRng rng{CounterRng::key_for(11, 0), 0};
+    for (unsigned int i = 0; i < 600; ++i) {
+        const uint8_t roll = rng.next_byte();
+        if (roll < 64) {
+            const std::size_t at = (rng.next_byte() << 4u | rng.next_byte()) % video.size();
+            video[at] ^= 0xFFFFFFFF;
+        } else if (roll < 68) {
+            std::fill(video.begin(), video.end(), roll & 1u ? 0xFFFFFFFF : 0);
+        }
+        submitted.push_back(video);
+    }
+
+    Recorder recorder;
+    CHECK(!recorder.Submit(video.data()));
+    CHECK(recorder.Open(path.string().c_str(), RecordFormat::RLE));
+    for (const std::vector<uint32_t>& frame : submitted) {
+        CHECK(recorder.Submit(frame.data()));
+    }
+    recorder.Close();
+    CHECK(recorder.Frames() == submitted.size());
+    CHECK(recorder.Repeats() > 0);
+
+    std::vector<uint8_t> bytes;
+    if (std::FILE* file = std::fopen(path.string().c_str(), "rb")) {
+        uint8_t chunk[4096];
+        for (std::size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) > 0;) {
+            bytes.insert(bytes.end(), chunk, chunk + read);
+        }
+        std::fclose(file);
+    }
+    std::filesystem::remove(path);
+
+    CHECK(DecodeRle(bytes) == submitted);
+}
+
+void TestRamSearchParity() {
+    // Whichever path RamSearch picked is checked against Passes() written
+    // out per byte, over memory images that differ by small steps.
+    auto passes = [](SearchFilter filter, uint8_t now, uint8_t before, uint8_t operand) {
+        switch (filter) {
+            case SearchFilter::EqualTo: return now == operand;
+            case SearchFilter::NotEqualTo: return now != operand;
+            case SearchFilter::Unchanged: return now == before;
+            case SearchFilter::Changed: return now != before;
+            case SearchFilter::Increased: return now > before;
+            case SearchFilter::Decreased: return now < before;
+            case SearchFilter::ChangedBy: return now == static_cast<uint8_t>(before + operand);
+        }
+        return false;
+    };
+    constexpr SearchFilter FILTERS[] = {SearchFilter::EqualTo,   SearchFilter::NotEqualTo, SearchFilter::Unchanged,
+                                        SearchFilter::Changed,   SearchFilter::Increased,  SearchFilter::Decreased,
+                                        SearchFilter::ChangedBy};
+    std::printf("  %s path\n", RamSearch(Chip8()).UsesAvx2() ? "AVX2" : "scalar");
+
+    CounterRng rng{CounterRng::key_for(3, 0), 0};
+    std::vector<uint8_t> image(4096 - START_ADDRESS);
+    for (uint8_t& byte : image) {
+        byte = rng.next_byte() & 0x83u; // few distinct values, so filters keep some
+    }
+
+    for (const SearchFilter filter : FILTERS) {
+        for (const uint8_t operand : {0x00, 0x01, 0x02, 0x80, 0xFF}) {
+            Chip8 chip8;
+            chip8.LoadROM(image.data(), image.size());
+            RamSearch search(chip8);
+            std::vector<bool> expected(RAM_SEARCH_SIZE, true);
+
+            for (unsigned int round = 0; round < 3; ++round) {
+                uint8_t before[RAM_SEARCH_SIZE];
+                std::memcpy(before, chip8.Memory(), RAM_SEARCH_REGISTERS);
+                std::memcpy(before + RAM_SEARCH_REGISTERS, chip8.Registers(), 16);
+                for (uint8_t& byte : image) {
+                    const uint8_t roll = rng.next_byte();
+                    byte = static_cast<uint8_t>(roll < 128 ? byte : roll < 192 ? byte + 1 : roll < 224 ? byte - 1 : roll);
+                }
+                chip8 = Chip8();
+                chip8.LoadROM(image.data(), image.size());
+
+                std::size_t count = 0;
+                for (uint16_t address = 0; address < RAM_SEARCH_SIZE; ++address) {
+                    const uint8_t now = address < RAM_SEARCH_REGISTERS ? chip8.Memory()[address]
+                                                                       : chip8.Registers()[address - RAM_SEARCH_REGISTERS];
+                    expected[address] = expected[address] && passes(filter, now, before[address], operand);
+                    count += expected[address];
+                }
+                CHECK(search.Filter(chip8, filter, operand) == count);
+                bool same = true;
+                for (uint16_t address = 0; address < RAM_SEARCH_SIZE; ++address) {
+                    same &= search.IsCandidate(address) == expected[address];
+                }
+                CHECK(same);
+            }
+        }
+    }
+}
+
+void TestNetplayLoopbackSync() {
+    // player 1 holds key 5, player 2 key 7; CXNN makes every frame's state
+    // depend on the whole history
+    constexpr uint8_t TWO_PLAYERS[] = {0x60, 0x05, 0xE0, 0xA1, 0x71, 0x01, 0x60, 0x07, 0xE0, 0x9E,
+                                       0x72, 0x10, 0xC3, 0xFF, 0x84, 0x34, 0x12, 0x00};
+    Chip8 start;
+    start.LoadROM(TWO_PLAYERS, sizeof(TWO_PLAYERS));
+
+    // no input delay, so the peer's input is always a frame late and
+    // predictions get corrected by rollback
+    RollbackConfig config;
+    config.input_delay = 0;
+    LoopbackLink link;
+    RollbackSession first(start, link.First(), config);
+    RollbackSession second(start, link.Second(), config);
+
+    constexpr unsigned int FRAMES = 600;
+    CounterRng rng{CounterRng::key_for(9, 0), 0};
+    std::vector<uint16_t> combined;
+    uint16_t held[2] = {};
+    for (unsigned int frame = 0; frame < FRAMES; ++frame) {
+        for (unsigned int p = 0; p < 2; ++p) {
+            if (rng.next_byte() < 40) {
+                held[p] ^= static_cast<uint16_t>(1u << (p ? 7 : 5));
+            }
+        }
+        combined.push_back(held[0] | held[1]);
+        CHECK(first.AdvanceFrame(held[0]));
+        CHECK(second.AdvanceFrame(held[1]));
+    }
+    for (unsigned int i = 0; i < 4; ++i) {
+        first.Poll();
+        second.Poll();
+    }
+    CHECK(first.ConfirmedFrame() == FRAMES);
+    CHECK(second.ConfirmedFrame() == FRAMES);
+    CHECK(first.Rollbacks() + second.Rollbacks() > 0);
+
+    // both match a plain run with the combined keys
+    Chip8 reference = start;
+    uint16_t previous = 0;
+    for (const uint16_t keys : combined) {
+        for (uint16_t changed = keys ^ previous; changed; changed &= changed - 1) {
+            const uint8_t key = static_cast<uint8_t>(__builtin_ctz(changed));
+            reference.SetKey(key, (keys >> key) & 1u);
+        }
+        previous = keys;
+        reference.RunFrame(config.instructions_per_frame);
+    }
+    for (const RollbackSession* session : {&first, &second}) {
+        const Chip8& state = session->State();
+        CHECK(std::memcmp(state.Registers(), reference.Registers(), 16) == 0);
+        CHECK(std::memcmp(state.Memory(), reference.Memory(), 4096) == 0);
+        CHECK(state.ProgramCounter() == reference.ProgramCounter());
+    }
+    CHECK(reference.Registers()[1] > 0 && reference.Registers()[2] > 0);
+
+    // peers with different input delays refuse each other's packets and
+    // stall rather than run apart
+    RollbackConfig delayed = config;
+    delayed.input_delay = 2;
+    LoopbackLink mismatched;
+    RollbackSession early(start, mismatched.First(), config);
+    RollbackSession late(start, mismatched.Second(), delayed);
+    for (unsigned int frame = 0; frame < 2 * config.max_rollback; ++frame) {
+        early.AdvanceFrame(1u << 5);
+        late.AdvanceFrame(1u << 7);
+    }
+    CHECK(early.ConfigMismatch() && late.ConfigMismatch());
+    CHECK(early.ConfirmedFrame() == 0 && late.ConfirmedFrame() == delayed.input_delay);
+    CHECK(early.Stalls() > 0 && late.Stalls() > 0);
+}
+
+struct Case {
+    const char* name;
+    void (*run)();
+};
+
+constexpr Case CASES[] = {
+    {"reverse_replay", TestReverseReplay},
+    {"decode_faults", TestDecodeFaults},
+    {"xochip_register_ranges", TestXoChipRegisterRanges},
+    {"scheduler_park_resume", TestSchedulerParkResume},
+    {"key_ring_bounds", TestKeyRingBounds},
+    {"triple_buffer_fresh", TestTripleBufferFresh},
+    {"wav_sound_timer", TestWavSoundTimer},
+    {"upscale_parity", TestUpscaleParity},
+    {"shared_state_owner", TestSharedStateOwner},
+    {"c_api_errors", TestCApiErrors},
+    {"vector_env_determinism", TestVectorEnvDeterminism},
+    {"cfg_blocks_and_data", TestCfgBlocksAndData},
+    {"debugger_blocks", TestDebuggerBlocks},
+    {"condition_parse", TestConditionParse},
+    {"rng_streams", TestRngStreams},
+    {"seqlock_read_consistent", TestSeqlockReadConsistent},
+    {"recorder_rle_roundtrip", TestRecorderRleRoundtrip},
+    {"ram_search_parity", TestRamSearchParity},
+    {"netplay_loopback_sync", TestNetplayLoopbackSync},
+};
+
+}
+
+int main(int argc, char** argv) {
+    for (const Case& test : CASES) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected |= std::strcmp(argv[i], test.name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        const int before = failures;
+        test.run();
+        std::printf("%s %s\n", failures == before ? "ok  " : "FAIL", test.name);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+#ifndef CHIP_8_TRIPLE_BUFFER_H
+#define CHIP_8_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for one producer and one consumer. The producer
+// fills Back() and publishes it by swapping indices with the middle slot; the
+// consumer swaps the middle slot into Front() when it holds a fresh value.
+// Neither side ever waits on the other. A value published while the previous
+// one is still unread replaces it, and the replaced one counts as dropped.
+template <typename T>
+class TripleBuffer {
+public:
+    // producer side
+    T& Back() { return buffers[back]; }
+
+    void Publish() {
+        const uint8_t previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        if (previous & FRESH) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        back = previous & INDEX_MASK;
+    }
+
+    // consumer side: returns true if Front() now holds a newer value
+    bool Update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& Front() const { return buffers[front]; }
+
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint8_t FRESH = 0x4;
+    static constexpr uint8_t INDEX_MASK = 0x3;
+
+    T buffers[3]{};
+    uint8_t back{0};
+    uint8_t front{2};
+    std::atomic<uint8_t> middle{1};
+    std::atomic<uint64_t> dropped{0};
+};
+
+#endif //CHIP_8_TRIPLE_BUFFER_H
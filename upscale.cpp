@@ -0,0 +1,166 @@
+#include "upscale.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHIP8_HAVE_AVX2 1
+#include <immintrin.h>
+#else
+#define CHIP8_HAVE_AVX2 0
+#endif
+
+namespace {
+
+// below this many destination pixels a second thread costs more than it saves
+constexpr std::size_t MIN_PIXELS_PER_THREAD = 512 * 1024;
+
+// widest source row supported (XO-CHIP/SCHIP hires is 128, Scale2x doubles it)
+constexpr unsigned int MAX_SOURCE_WIDTH = 256;
+
+void PaletteRowScalar(const uint32_t* src, unsigned int width, Palette palette, uint32_t* out) {
+    for (unsigned int x = 0; x < width; ++x) {
+        out[x] = src[x] ? palette.on : palette.off;
+    }
+}
+
+void StretchRowScalar(const uint32_t* colors, const uint32_t* x_map, unsigned int width, uint32_t* dst) {
+    for (unsigned int x = 0; x < width; ++x) {
+        dst[x] = colors[x_map[x]];
+    }
+}
+
+#if CHIP8_HAVE_AVX2
+
+__attribute__((target("avx2")))
+void PaletteRowAvx2(const uint32_t* src, unsigned int width, Palette palette, uint32_t* out) {
+    const __m256i on = _mm256_set1_epi32(static_cast<int>(palette.on));
+    const __m256i off = _mm256_set1_epi32(static_cast<int>(palette.off));
+    const __m256i zero = _mm256_setzero_si256();
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+        const __m256i unlit = _mm256_cmpeq_epi32(pixels, zero);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_blendv_epi8(on, off, unlit));
+    }
+    PaletteRowScalar(src + x, width - x, palette, out + x);
+}
+
+__attribute__((target("avx2")))
+void StretchRowAvx2(const uint32_t* colors, const uint32_t* x_map, unsigned int width, uint32_t* dst) {
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x_map + x));
+        const __m256i pixels = _mm256_i32gather_epi32(reinterpret_cast<const int*>(colors), index, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), pixels);
+    }
+    StretchRowScalar(colors, x_map + x, width - x, dst + x);
+}
+
+bool HostHasAvx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+bool HostHasAvx2() {
+    return false;
+}
+
+#endif
+
+// Scale2x (EPX): each source pixel E with neighbours B (up), D (left),
+// F (right), H (down) becomes a 2x2 block whose corners take the colour of a
+// matching edge pair, rounding off diagonal staircases.
+void Scale2x(const uint32_t* src, unsigned int width, unsigned int height, uint32_t* dst) {
+    const unsigned int out_width = width * 2;
+
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            const bool e = src[y * width + x] != 0;
+            const bool b = y > 0 ? src[(y - 1) * width + x] != 0 : e;
+            const bool h = y + 1 < height ? src[(y + 1) * width + x] != 0 : e;
+            const bool d = x > 0 ? src[y * width + x - 1] != 0 : e;
+            const bool f = x + 1 < width ? src[y * width + x + 1] != 0 : e;
+
+            uint32_t* out = dst + (y * 2) * out_width + x * 2;
+            if (b != h && d != f) {
+                out[0] = d == b ? d : e;
+                out[1] = b == f ? f : e;
+                out[out_width] = d == h ? d : e;
+                out[out_width + 1] = h == f ? f : e;
+            } else {
+                out[0] = out[1] = out[out_width] = out[out_width + 1] = e;
+            }
+        }
+    }
+}
+
+}
+
+Upscaler::Upscaler(Palette palette, ScaleFilter filter, unsigned int threads)
+    : palette(palette), filter(filter), use_avx2(HostHasAvx2()), pool(std::max(1u, threads)) {}
+
+void Upscaler::Scale(const uint32_t* video, unsigned int src_width, unsigned int src_height,
+                     uint32_t* dst, unsigned int dst_width, unsigned int dst_height, std::size_t dst_stride) {
+    if (src_width * (filter == ScaleFilter::Scale2x ? 2 : 1) > MAX_SOURCE_WIDTH) {
+        return;
+    }
+    if (!src_width || !src_height || !dst_width || !dst_height) {
+        return;
+    }
+
+    const uint32_t* src = video;
+    if (filter == ScaleFilter::Scale2x) {
+        smoothed.resize(src_width * 2 * src_height * 2);
+        Scale2x(video, src_width, src_height, smoothed.data());
+        src = smoothed.data();
+        src_width *= 2;
+        src_height *= 2;
+    }
+
+    if (x_map.size() != dst_width || x_map_src_width != src_width) {
+        x_map.resize(dst_width);
+        for (unsigned int x = 0; x < dst_width; ++x) {
+            x_map[x] = static_cast<uint32_t>(uint64_t{x} * src_width / dst_width);
+        }
+        x_map_src_width = src_width;
+    }
+
+    const std::size_t pixels = std::size_t{dst_width} * dst_height;
+    const unsigned int bands = static_cast<unsigned int>(
+        std::clamp<std::size_t>(pixels / MIN_PIXELS_PER_THREAD, 1, std::min(pool.Threads(), dst_height)));
+    const Job job{src, src_width, src_height, dst, dst_width, dst_height, dst_stride};
+
+    pool.Run(bands, [&](std::size_t band) {
+        ScaleBand(job, static_cast<unsigned int>(dst_height * band / bands),
+                  static_cast<unsigned int>(dst_height * (band + 1) / bands));
+    });
+}
+
+void Upscaler::ScaleBand(const Job& job, unsigned int y_begin, unsigned int y_end) const {
+    uint32_t colors[MAX_SOURCE_WIDTH];
+    unsigned int previous_sy = job.src_height;
+
+    for (unsigned int y = y_begin; y < y_end; ++y) {
+        const unsigned int sy = static_cast<unsigned int>(uint64_t{y} * job.src_height / job.dst_height);
+        uint32_t* row = job.dst + y * job.dst_stride;
+
+        if (sy == previous_sy) {
+            std::memcpy(row, row - job.dst_stride, job.dst_width * sizeof(uint32_t));
+            continue;
+        }
+        previous_sy = sy;
+
+#if CHIP8_HAVE_AVX2
+        if (use_avx2) {
+            PaletteRowAvx2(job.src + sy * job.src_width, job.src_width, palette, colors);
+            StretchRowAvx2(colors, x_map.data(), job.dst_width, row);
+            continue;
+        }
+#endif
+        PaletteRowScalar(job.src + sy * job.src_width, job.src_width, palette, colors);
+        StretchRowScalar(colors, x_map.data(), job.dst_width, row);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef CHIP_8_UPSCALE_H
+#define CHIP_8_UPSCALE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "worker_pool.h"
+
+struct Palette {
+    uint32_t off;
+    uint32_t on;
+};
+
+enum class ScaleFilter {
+    Nearest,
+    // Scale2x/EPX on the source image before the nearest-neighbour stretch
+    Scale2x,
+};
+
+// Expands a `video` image (any non-zero pixel is lit) into an RGBA target of
+// arbitrary size. Each distinct source row is palette-converted and stretched
+// once, with AVX2 when the host supports it, and the destination rows that
+// map to the same source row are copied from it. Large targets are split into
+// horizontal bands across a pool of `threads` workers, which are started once
+// and sleep between calls.
+class Upscaler {
+public:
+    explicit Upscaler(Palette palette, ScaleFilter filter = ScaleFilter::Nearest, unsigned int threads = 1);
+
+    Upscaler(const Upscaler&) = delete;
+    Upscaler& operator=(const Upscaler&) = delete;
+
+    // `dst_stride` is in pixels. Sources wider than 256 pixels, or 128 with
+    // Scale2x, are not supported and leave `dst` untouched, as does an empty
+    // source or destination.
+    void Scale(const uint32_t* video, unsigned int src_width, unsigned int src_height,
+               uint32_t* dst, unsigned int dst_width, unsigned int dst_height, std::size_t dst_stride);
+
+    bool UsesAvx2() const { return use_avx2; }
+
+private:
+    struct Job {
+        const uint32_t* src;
+        unsigned int src_width;
+        unsigned int src_height;
+        uint32_t* dst;
+        unsigned int dst_width;
+        unsigned int dst_height;
+        std::size_t dst_stride;
+    };
+
+    void ScaleBand(const Job& job, unsigned int y_begin, unsigned int y_end) const;
+
+    Palette palette;
+    ScaleFilter filter;
+    bool use_avx2;
+    WorkerPool pool;
+
+    // cached between calls while the geometry stays the same
+    std::vector<uint32_t> x_map;
+    unsigned int x_map_src_width{};
+    std::vector<uint32_t> smoothed;
+};
+
+#endif //CHIP_8_UPSCALE_H
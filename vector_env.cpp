@@ -0,0 +1,127 @@
+#include "vector_env.h"
+
+#include <algorithm>
+
+namespace {
+
+// small enough to balance uneven episodes, large enough to keep the shared
+// counter off the profile
+constexpr std::size_t CHUNKS_PER_THREAD = 8;
+
+}
+
+VectorEnv::VectorEnv(const VectorEnvConfig& config, const Chip8& start)
+    : config(config), start(start),
+      observation_size(config.format == ObservationFormat::Packed ? VIDEO_PACKED_SIZE : VIDEO_WIDTH * VIDEO_HEIGHT),
+      chunk_size(std::max<std::size_t>(1, config.instances / (std::max(1u, config.threads) * CHUNKS_PER_THREAD))),
+      envs(config.instances), observations(config.instances * observation_size), rewards(config.instances),
+      dones(config.instances), pool(std::max(1u, config.threads)) {
+    this->config.frame_skip = std::max(1u, config.frame_skip);
+    this->config.reward_bytes = std::clamp(config.reward_bytes, 1u, 4u);
+
+    Reset();
+}
+
+void VectorEnv::Reset() {
+    for (Env& env : envs) {
+        env.episode = 0;
+    }
+    Run(Job::Reset, nullptr);
+}
+
+void VectorEnv::Step(const int32_t* actions) {
+    Run(Job::Step, actions);
+}
+
+void VectorEnv::ResetEnv(std::size_t i) {
+    Env& env = envs[i];
+    env.chip8.Restore(start);
+    // mixed rather than added, so seed s, episode e + 1 and seed s + 1,
+    // episode e get unrelated streams
+    env.chip8.Reseed(CounterRng::key_for(config.seed, env.episode++), i);
+    env.episode_frames = 0;
+    env.score = Score(env.chip8);
+    env.held = 0;
+}
+
+void VectorEnv::StepEnv(std::size_t i, int32_t action) {
+    Env& env = envs[i];
+
+    // keypad changes go through SetKey so that a press completes Fx0A
+    const uint16_t keys = action >= 0 && static_cast<std::size_t>(action) < config.action_keys.size()
+                                  ? config.action_keys[action]
+                                  : 0;
+    for (uint16_t changed = keys ^ env.held; changed; changed &= changed - 1) {
+        const uint8_t key = static_cast<uint8_t>(__builtin_ctz(changed));
+        env.chip8.SetKey(key, (keys >> key) & 1u);
+    }
+    env.held = keys;
+
+    float reward = 0;
+    bool done = false;
+    for (unsigned int frame = 0; frame < config.frame_skip && !done; ++frame) {
+        env.chip8.RunFrame(config.instructions_per_frame);
+        ++env.episode_frames;
+
+        const uint32_t score = Score(env.chip8);
+        reward += static_cast<float>(static_cast<int64_t>(score) - static_cast<int64_t>(env.score));
+        env.score = score;
+        done = Done(env);
+    }
+
+    rewards[i] = reward;
+    dones[i] = done;
+    if (done) {
+        ResetEnv(i);
+    }
+    WriteObservation(i);
+}
+
+void VectorEnv::WriteObservation(std::size_t i) {
+    const uint32_t* video = envs[i].chip8.Video();
+    uint8_t* out = observations.data() + i * observation_size;
+
+    if (config.format == ObservationFormat::Expanded) {
+        for (std::size_t p = 0; p < VIDEO_WIDTH * VIDEO_HEIGHT; ++p) {
+            out[p] = video[p] ? 0xFF : 0;
+        }
+        return;
+    }
+    pack_video_bits(video, out);
+}
+
+uint32_t VectorEnv::Score(const Chip8& chip8) const {
+    if (config.reward_address == VectorEnvConfig::NO_ADDRESS) {
+        return 0;
+    }
+    uint32_t score = 0;
+    for (unsigned int b = 0; b < config.reward_bytes; ++b) {
+        score = (score << 8u) | chip8.Memory()[(config.reward_address + b) & 0xFFFu];
+    }
+    return score;
+}
+
+bool VectorEnv::Done(const Env& env) const {
+    if (config.max_episode_frames && env.episode_frames >= config.max_episode_frames) {
+        return true;
+    }
+    return config.done_address != VectorEnvConfig::NO_ADDRESS &&
+           (env.chip8.Memory()[config.done_address & 0xFFF] & config.done_mask) == config.done_value;
+}
+
+void VectorEnv::Run(Job job, const int32_t* actions) {
+    const std::size_t count = envs.size();
+    pool.Run((count + chunk_size - 1) / chunk_size, [&](std::size_t chunk) {
+        const std::size_t end = std::min(count, (chunk + 1) * chunk_size);
+        for (std::size_t i = chunk * chunk_size; i < end; ++i) {
+            if (job == Job::Step) {
+                StepEnv(i, actions[i]);
+            } else {
+                ResetEnv(i);
+                rewards[i] = 0;
+                dones[i] = 0;
+                WriteObservation(i);
+            }
+        }
+    });
+}
@@ -0,0 +1,111 @@
+#ifndef CHIP_8_VECTOR_ENV_H
+#define CHIP_8_VECTOR_ENV_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chip8.h"
+#include "worker_pool.h"
+
+enum class ObservationFormat {
+    // one bit per pixel, most significant bit first: 256 bytes per instance
+    Packed,
+    // one byte per pixel, 0 or 255: 2048 bytes per instance
+    Expanded,
+};
+
+struct VectorEnvConfig {
+    static constexpr int32_t NO_ADDRESS = -1;
+
+    std::size_t instances = 1;
+    // the calling thread counts as one
+    unsigned int threads = 1;
+    unsigned int instructions_per_frame = 11;
+    // frames run per step with the same action; rewards are summed
+    unsigned int frame_skip = 1;
+    ObservationFormat format = ObservationFormat::Packed;
+    // action index -> keypad bitmask (bit k holds key k)
+    std::vector<uint16_t> action_keys;
+
+    // reward is the change of a big-endian counter in memory
+    int32_t reward_address = NO_ADDRESS;
+    unsigned int reward_bytes = 1;
+    // an episode ends when (memory[done_address] & done_mask) == done_value,
+    // or after max_episode_frames frames if that is non-zero
+    int32_t done_address = NO_ADDRESS;
+    uint8_t done_mask = 0xFF;
+    uint8_t done_value = 0;
+    uint64_t max_episode_frames = 0;
+
+    // CXNN streams are derived from (seed, episode, instance)
+    uint64_t seed = 0;
+};
+
+// Steps many instances of one ROM in lockstep for reinforcement learning.
+//
+// Every instance starts from the same snapshot and is restored from it, with
+// a fresh random stream, as soon as its episode ends, so Step() never
+// returns a finished instance. Results go to buffers allocated once in the
+// constructor: an [instances x ObservationSize()] uint8 tensor and the
+// per-instance rewards and done flags. Step() allocates nothing.
+//
+// Instances are split into chunks that a persistent WorkerPool and the caller
+// pull from a shared counter; workers sleep between steps.
+class VectorEnv {
+public:
+    VectorEnv(const VectorEnvConfig& config, const Chip8& start);
+
+    VectorEnv(const VectorEnv&) = delete;
+    VectorEnv& operator=(const VectorEnv&) = delete;
+
+    // restores every instance and writes the first observations
+    void Reset();
+
+    // actions[i] indexes config.action_keys; out-of-range actions hold no key.
+    // dones[i] is set when instance i finished an episode during this step,
+    // in which case its observation is already that of the new episode.
+    void Step(const int32_t* actions);
+
+    std::size_t Instances() const { return envs.size(); }
+    std::size_t ObservationSize() const { return observation_size; }
+
+    const uint8_t* Observations() const { return observations.data(); }
+    const float* Rewards() const { return rewards.data(); }
+    const uint8_t* Dones() const { return dones.data(); }
+
+    const Chip8& Instance(std::size_t i) const { return envs[i].chip8; }
+
+private:
+    struct Env {
+        Chip8 chip8;
+        uint64_t episode{};
+        uint64_t episode_frames{};
+        uint32_t score{};
+        uint16_t held{};
+    };
+
+    enum class Job { Reset, Step };
+
+    void ResetEnv(std::size_t i);
+    void StepEnv(std::size_t i, int32_t action);
+    void WriteObservation(std::size_t i);
+    uint32_t Score(const Chip8& chip8) const;
+    bool Done(const Env& env) const;
+
+    void Run(Job job, const int32_t* actions);
+
+    VectorEnvConfig config;
+    Chip8 start;
+    std::size_t observation_size;
+    std::size_t chunk_size;
+
+    std::vector<Env> envs;
+    std::vector<uint8_t> observations;
+    std::vector<float> rewards;
+    std::vector<uint8_t> dones;
+
+    WorkerPool pool;
+};
+
+#endif //CHIP_8_VECTOR_ENV_H
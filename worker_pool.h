@@ -0,0 +1,108 @@
+#ifndef CHIP_8_WORKER_POOL_H
+#define CHIP_8_WORKER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Persistent threads for fork-join loops. Run(tasks, fn) calls fn(task) once
+// for every task in [0, tasks), spread over the calling thread and
+// `threads - 1` workers that pull indices from a shared counter, and returns
+// once all of them are done. Workers sleep on an atomic between calls, so a
+// Run() costs a wake-up rather than a thread start.
+//
+// One Run() at a time, always from the same thread.
+class WorkerPool {
+public:
+    // the calling thread counts as one
+    explicit WorkerPool(unsigned int threads) {
+        try {
+            for (unsigned int i = 1; i < threads; ++i) {
+                workers.emplace_back(&WorkerPool::WorkerLoop, this);
+            }
+        } catch (...) {
+            // the destructor will not run; stop the workers already started
+            // rather than destroy joinable threads
+            StopWorkers();
+            throw;
+        }
+    }
+
+    ~WorkerPool() { StopWorkers(); }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned int Threads() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    template <typename Fn>
+    void Run(std::size_t tasks, const Fn& fn) {
+        task_count = tasks;
+        task_fn = &fn;
+        invoke = [](const void* f, std::size_t task) { (*static_cast<const Fn*>(f))(task); };
+        next_task.store(0, std::memory_order_relaxed);
+        if (workers.empty() || tasks <= 1) {
+            RunTasks();
+            return;
+        }
+
+        busy_workers.store(static_cast<unsigned int>(workers.size()), std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+
+        RunTasks();
+        for (unsigned int busy = busy_workers.load(std::memory_order_acquire); busy;
+             busy = busy_workers.load(std::memory_order_acquire)) {
+            busy_workers.wait(busy, std::memory_order_acquire);
+        }
+    }
+
+private:
+    void RunTasks() {
+        for (std::size_t task = next_task.fetch_add(1, std::memory_order_relaxed); task < task_count;
+             task = next_task.fetch_add(1, std::memory_order_relaxed)) {
+            invoke(task_fn, task);
+        }
+    }
+
+    void WorkerLoop() {
+        uint32_t seen = 0;
+
+        for (;;) {
+            generation.wait(seen, std::memory_order_acquire);
+            seen = generation.load(std::memory_order_acquire);
+            if (!running.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            RunTasks();
+            if (busy_workers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                busy_workers.notify_one();
+            }
+        }
+    }
+
+    void StopWorkers() {
+        running.store(false, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // current job, published to the workers by bumping generation
+    std::size_t task_count{};
+    const void* task_fn{};
+    void (*invoke)(const void*, std::size_t){};
+    std::atomic<std::size_t> next_task{0};
+    std::atomic<unsigned int> busy_workers{0};
+    std::atomic<uint32_t> generation{0};
+    std::atomic<bool> running{true};
+    std::vector<std::thread> workers;
+};
+
+#endif //CHIP_8_WORKER_POOL_H